@@ -39,6 +39,10 @@
 #include "pipewire/extensions/metadata.h"
 #include "pipewire-jack-extensions.h"
 
+#ifdef HAVE_AUDIOMIXER
+#include <spa/plugins/audiomixer/mix-ops.h>
+#endif
+
 #define JACK_DEFAULT_VIDEO_TYPE	"32 bit float RGBA video"
 
 /* use 512KB stack per thread - the default is way too high to be feasible
@@ -123,7 +127,9 @@ static thread_local float midi_scratch[MIDI_SCRATCH_FRAMES];
 #define OBJECT_CHUNK		8
 #define RECYCLE_THRESHOLD	128
 
+#ifndef HAVE_AUDIOMIXER
 typedef void (*mix_func) (float *dst, float *src[], uint32_t n_src, bool aligned, uint32_t n_samples);
+#endif
 
 struct object {
 	struct spa_list link;
@@ -463,7 +469,11 @@ struct client {
 
 	uint32_t max_frames;
 	uint32_t max_align;
+#ifdef HAVE_AUDIOMIXER
+	struct mix_ops mix_ops;
+#else
 	mix_func mix_function;
+#endif
 
 	jack_position_t jack_position;
 	jack_transport_state_t jack_state;
@@ -899,6 +909,7 @@ static struct object *find_link(struct client *c, uint32_t src, uint32_t dst)
 	return NULL;
 }
 
+#ifndef HAVE_AUDIOMIXER
 #if defined (__SSE__)
 #include <xmmintrin.h>
 static void mix_sse(float *dst, float *src[], uint32_t n_src, bool aligned, uint32_t n_samples)
@@ -936,6 +947,7 @@ static void mix_c(float *dst, float *src[], uint32_t n_src, bool aligned, uint32
 		dst[n] = t;
 	}
 }
+#endif
 
 SPA_EXPORT
 void jack_get_version(int *major_ptr, int *minor_ptr, int *micro_ptr, int *proto_ptr)
@@ -1946,6 +1958,8 @@ static void trigger_link_v1(struct link *l, uint64_t nsec)
 
 			pw_log_trace_fp("%p: signal %p %p", c, l, state);
 
+			if (pw_node_activation_wakeup(a))
+				return;
 			if (SPA_UNLIKELY(write(l->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd)))
 				pw_log_warn("%p: write failed %m", c);
 		}
@@ -1968,6 +1982,8 @@ static void trigger_link_v0(struct link *l, uint64_t nsec)
 
 		pw_log_trace_fp("%p: signal %p %p", c, l, state);
 
+		if (pw_node_activation_wakeup(a))
+			return;
 		if (SPA_UNLIKELY(write(l->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd)))
 			pw_log_warn("%p: write failed %m", c);
 	}
@@ -4107,10 +4123,20 @@ jack_client_t * jack_client_open (const char *client_name,
 
 	support = pw_context_get_support(client->context.context, &n_support);
 
-	client->mix_function = mix_c;
 	cpu_iface = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+#ifdef HAVE_AUDIOMIXER
+	client->mix_ops.fmt = SPA_AUDIO_FORMAT_F32P;
+	client->mix_ops.n_channels = 1;
+	client->mix_ops.cpu_flags = cpu_iface ? spa_cpu_get_flags(cpu_iface) : 0;
+	if (mix_ops_init(&client->mix_ops) < 0) {
+		pw_log_error("%p: can't find mixer function", client);
+		goto no_props;
+	}
+#else
+	client->mix_function = mix_c;
+#endif
 	if (cpu_iface) {
-#if defined (__SSE__)
+#if !defined(HAVE_AUDIOMIXER) && defined (__SSE__)
 		uint32_t flags = spa_cpu_get_flags(cpu_iface);
 		if (flags & SPA_CPU_FLAG_SSE)
 			client->mix_function = mix_sse;
@@ -5490,7 +5516,9 @@ static void *get_buffer_input_float(struct port *p, jack_nframes_t frames)
 	void *ptr = NULL;
 	float *mix_ptr[MAX_MIX], *np;
 	uint32_t n_ptr = 0;
+#ifndef HAVE_AUDIOMIXER
 	bool ptr_aligned = true;
+#endif
 	struct client *c = p->client;
 
 	spa_list_for_each(mix, &p->mix, port_link) {
@@ -5506,9 +5534,10 @@ static void *get_buffer_input_float(struct port *p, jack_nframes_t frames)
 		if ((np = get_buffer_data(b, frames)) == NULL)
 			continue;
 
+#ifndef HAVE_AUDIOMIXER
 		if (!SPA_IS_ALIGNED(np, 16))
 			ptr_aligned = false;
-
+#endif
 		mix_ptr[n_ptr++] = np;
 		if (n_ptr == MAX_MIX)
 			break;
@@ -5517,7 +5546,11 @@ static void *get_buffer_input_float(struct port *p, jack_nframes_t frames)
 		ptr = mix_ptr[0];
 	} else if (n_ptr > 1) {
 		ptr = p->emptyptr;
+#ifdef HAVE_AUDIOMIXER
+		mix_ops_process(&c->mix_ops, ptr, (const void **)mix_ptr, n_ptr, frames);
+#else
 		c->mix_function(ptr, mix_ptr, n_ptr, ptr_aligned, frames);
+#endif
 		p->zeroed = false;
 	}
 	if (ptr == NULL)
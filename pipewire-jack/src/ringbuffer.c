@@ -8,29 +8,53 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 #include <spa/utils/defs.h>
 
 #include <jack/ringbuffer.h>
 
+#define CACHE_LINE_SIZE		64
+#define HUGE_PAGE_SIZE		(2u * 1024 * 1024)
+
+/* The read_ptr is only written by the reader and the write_ptr only by
+ * the writer. Each side loads the other index with acquire and publishes
+ * its own with release so that the data copies are ordered with the
+ * index updates. */
+#define LOAD_OWN(p)		__atomic_load_n(&(p), __ATOMIC_RELAXED)
+#define LOAD_OTHER(p)		__atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define STORE_OWN(p,v)		__atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
 SPA_EXPORT
 jack_ringbuffer_t *jack_ringbuffer_create(size_t sz)
 {
-	size_t power_of_two;
+	size_t power_of_two, align;
 	jack_ringbuffer_t *rb;
 
-	rb = calloc(1, sizeof(jack_ringbuffer_t));
-	if (rb == NULL)
+	/* keep the indexes on a cache line of their own, away from the
+	 * data and from unrelated heap allocations */
+	if (posix_memalign((void**)&rb, CACHE_LINE_SIZE,
+				SPA_ROUND_UP(sizeof(jack_ringbuffer_t), CACHE_LINE_SIZE)) != 0)
 		return NULL;
+	memset(rb, 0, sizeof(*rb));
 
 	for (power_of_two = 1; 1u << power_of_two < sz; power_of_two++);
 
 	rb->size = 1 << power_of_two;
 	rb->size_mask = rb->size - 1;
-	if ((rb->buf = calloc(1, rb->size)) == NULL) {
+
+	/* large buffers are used for disk streaming, try to get them backed
+	 * by huge pages to reduce TLB misses */
+	align = rb->size >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+	if (posix_memalign((void**)&rb->buf, align, rb->size) != 0) {
 		free (rb);
 		return NULL;
 	}
+#ifdef MADV_HUGEPAGE
+	if (align == HUGE_PAGE_SIZE)
+		madvise(rb->buf, rb->size, MADV_HUGEPAGE);
+#endif
+	memset(rb->buf, 0, rb->size);
 	rb->mlocked = 0;
 
 	return rb;
@@ -39,10 +63,8 @@ jack_ringbuffer_t *jack_ringbuffer_create(size_t sz)
 SPA_EXPORT
 void jack_ringbuffer_free(jack_ringbuffer_t *rb)
 {
-#ifdef USE_MLOCK
 	if (rb->mlocked)
 		munlock (rb->buf, rb->size);
-#endif /* USE_MLOCK */
 	free (rb->buf);
 	free (rb);
 }
@@ -55,8 +77,8 @@ void jack_ringbuffer_get_read_vector(const jack_ringbuffer_t *rb,
 	size_t cnt2;
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = LOAD_OTHER(rb->write_ptr);
+	r = LOAD_OWN(rb->read_ptr);
 
 	if (w > r)
 		free_cnt = w - r;
@@ -85,8 +107,8 @@ void jack_ringbuffer_get_write_vector(const jack_ringbuffer_t *rb,
 	size_t cnt2;
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = LOAD_OWN(rb->write_ptr);
+	r = LOAD_OTHER(rb->read_ptr);
 
 	if (w > r)
 		free_cnt = ((r - w + rb->size) & rb->size_mask) - 1;
@@ -116,28 +138,29 @@ size_t jack_ringbuffer_read(jack_ringbuffer_t *rb, char *dest, size_t cnt)
 	size_t cnt2;
 	size_t to_read;
 	size_t n1, n2;
+	size_t r;
 
 	if ((free_cnt = jack_ringbuffer_read_space (rb)) == 0)
 		return 0;
 
 	to_read = cnt > free_cnt ? free_cnt : cnt;
 
-	cnt2 = rb->read_ptr + to_read;
+	r = LOAD_OWN(rb->read_ptr);
+	cnt2 = r + to_read;
 
 	if (cnt2 > rb->size) {
-		n1 = rb->size - rb->read_ptr;
+		n1 = rb->size - r;
 		n2 = cnt2 & rb->size_mask;
 	} else {
 		n1 = to_read;
 		n2 = 0;
 	}
 
-	memcpy (dest, &(rb->buf[rb->read_ptr]), n1);
-	rb->read_ptr = (rb->read_ptr + n1) & rb->size_mask;
-	if (n2) {
-		memcpy (dest + n1, &(rb->buf[rb->read_ptr]), n2);
-		rb->read_ptr = (rb->read_ptr + n2) & rb->size_mask;
-	}
+	memcpy (dest, &(rb->buf[r]), n1);
+	if (n2)
+		memcpy (dest + n1, rb->buf, n2);
+
+	STORE_OWN(rb->read_ptr, cnt2 & rb->size_mask);
 	return to_read;
 }
 
@@ -150,7 +173,7 @@ size_t jack_ringbuffer_peek(jack_ringbuffer_t *rb, char *dest, size_t cnt)
 	size_t n1, n2;
 	size_t tmp_read_ptr;
 
-	tmp_read_ptr = rb->read_ptr;
+	tmp_read_ptr = LOAD_OWN(rb->read_ptr);
 
 	if ((free_cnt = jack_ringbuffer_read_space (rb)) == 0)
 		return 0;
@@ -179,8 +202,8 @@ size_t jack_ringbuffer_peek(jack_ringbuffer_t *rb, char *dest, size_t cnt)
 SPA_EXPORT
 void jack_ringbuffer_read_advance(jack_ringbuffer_t *rb, size_t cnt)
 {
-	size_t tmp = (rb->read_ptr + cnt) & rb->size_mask;
-	rb->read_ptr = tmp;
+	size_t tmp = (LOAD_OWN(rb->read_ptr) + cnt) & rb->size_mask;
+	STORE_OWN(rb->read_ptr, tmp);
 }
 
 SPA_EXPORT
@@ -188,8 +211,8 @@ size_t jack_ringbuffer_read_space(const jack_ringbuffer_t *rb)
 {
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = LOAD_OTHER(rb->write_ptr);
+	r = LOAD_OWN(rb->read_ptr);
 
 	if (w > r)
 		return w - r;
@@ -200,10 +223,8 @@ size_t jack_ringbuffer_read_space(const jack_ringbuffer_t *rb)
 SPA_EXPORT
 int jack_ringbuffer_mlock(jack_ringbuffer_t *rb)
 {
-#ifdef USE_MLOCK
 	if (mlock (rb->buf, rb->size))
                 return -1;
-#endif /* USE_MLOCK */
 	rb->mlocked = 1;
 	return 0;
 }
@@ -233,36 +254,37 @@ size_t jack_ringbuffer_write(jack_ringbuffer_t *rb, const char *src,
 	size_t cnt2;
 	size_t to_write;
 	size_t n1, n2;
+	size_t w;
 
 	if ((free_cnt = jack_ringbuffer_write_space (rb)) == 0)
 		return 0;
 
 	to_write = cnt > free_cnt ? free_cnt : cnt;
 
-	cnt2 = rb->write_ptr + to_write;
+	w = LOAD_OWN(rb->write_ptr);
+	cnt2 = w + to_write;
 
 	if (cnt2 > rb->size) {
-		n1 = rb->size - rb->write_ptr;
+		n1 = rb->size - w;
 		n2 = cnt2 & rb->size_mask;
 	} else {
 		n1 = to_write;
 		n2 = 0;
 	}
 
-	memcpy (&(rb->buf[rb->write_ptr]), src, n1);
-	rb->write_ptr = (rb->write_ptr + n1) & rb->size_mask;
-	if (n2) {
-		memcpy (&(rb->buf[rb->write_ptr]), src + n1, n2);
-		rb->write_ptr = (rb->write_ptr + n2) & rb->size_mask;
-	}
+	memcpy (&(rb->buf[w]), src, n1);
+	if (n2)
+		memcpy (rb->buf, src + n1, n2);
+
+	STORE_OWN(rb->write_ptr, cnt2 & rb->size_mask);
 	return to_write;
 }
 
 SPA_EXPORT
 void jack_ringbuffer_write_advance(jack_ringbuffer_t *rb, size_t cnt)
 {
-	size_t tmp = (rb->write_ptr + cnt) & rb->size_mask;
-	rb->write_ptr = tmp;
+	size_t tmp = (LOAD_OWN(rb->write_ptr) + cnt) & rb->size_mask;
+	STORE_OWN(rb->write_ptr, tmp);
 }
 
 SPA_EXPORT
@@ -270,8 +292,8 @@ size_t jack_ringbuffer_write_space(const jack_ringbuffer_t *rb)
 {
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = LOAD_OWN(rb->write_ptr);
+	r = LOAD_OTHER(rb->read_ptr);
 
 	if (w > r)
 		return ((r - w + rb->size) & rb->size_mask) - 1;
@@ -0,0 +1,138 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+#include <jack/ringbuffer.h>
+
+#define DEFAULT_SIZE	(256 * 1024)
+#define DEFAULT_CHUNK	4096
+#define TOTAL_BYTES	(1024ull * 1024 * 1024)
+
+static jack_ringbuffer_t *rb;
+static size_t chunk;
+static uint64_t total;
+static int errors;
+
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static void *writer_start(void *arg)
+{
+	uint8_t *buf = calloc(1, chunk);
+	uint64_t done = 0;
+
+	while (done < total) {
+		size_t len = SPA_MIN(chunk, total - done);
+
+		/* tag each chunk with its offset so the reader can check it */
+		memcpy(buf, &done, SPA_MIN(len, sizeof(done)));
+		while (jack_ringbuffer_write_space(rb) < len)
+			sched_yield();
+		done += jack_ringbuffer_write(rb, (char*)buf, len);
+	}
+	free(buf);
+	return NULL;
+}
+
+static void *reader_start(void *arg)
+{
+	uint8_t *buf = calloc(1, chunk);
+	uint64_t done = 0, tag;
+
+	while (done < total) {
+		size_t len = SPA_MIN(chunk, total - done);
+
+		while (jack_ringbuffer_read_space(rb) < len)
+			sched_yield();
+		jack_ringbuffer_read(rb, (char*)buf, len);
+
+		tag = 0;
+		memcpy(&tag, buf, SPA_MIN(len, sizeof(tag)));
+		if (len >= sizeof(tag) && tag != done)
+			errors++;
+		done += len;
+	}
+	free(buf);
+	return NULL;
+}
+
+static void run_vector(void)
+{
+	jack_ringbuffer_data_t vec[2];
+	uint64_t done = 0, t1, t2;
+	size_t len;
+
+	t1 = get_time_ns();
+	while (done < total) {
+		jack_ringbuffer_get_write_vector(rb, vec);
+		len = SPA_MIN(vec[0].len, chunk);
+		memset(vec[0].buf, 0, len);
+		jack_ringbuffer_write_advance(rb, len);
+
+		jack_ringbuffer_get_read_vector(rb, vec);
+		jack_ringbuffer_read_advance(rb, vec[0].len);
+		done += len;
+	}
+	t2 = get_time_ns();
+	printf("vector: %"PRIu64" bytes in %f s, %f MB/s\n", total,
+			(t2 - t1) / 1e9, total / 1e6 / ((t2 - t1) / 1e9));
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t reader_thread, writer_thread;
+	size_t size = DEFAULT_SIZE;
+	uint64_t t1, t2;
+
+	chunk = DEFAULT_CHUNK;
+	total = TOTAL_BYTES;
+
+	if (argc > 1)
+		size = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		chunk = strtoul(argv[2], NULL, 0);
+
+	if ((rb = jack_ringbuffer_create(size)) == NULL) {
+		perror("jack_ringbuffer_create");
+		return EXIT_FAILURE;
+	}
+	if (jack_ringbuffer_mlock(rb) < 0)
+		perror("jack_ringbuffer_mlock");
+
+	chunk = SPA_MIN(chunk, rb->size - 1);
+
+	printf("buffer size (bytes): %zd\n", rb->size);
+	printf("chunk size (bytes): %zd\n", chunk);
+
+	t1 = get_time_ns();
+	pthread_create(&reader_thread, NULL, reader_start, NULL);
+	pthread_create(&writer_thread, NULL, writer_start, NULL);
+	pthread_join(writer_thread, NULL);
+	pthread_join(reader_thread, NULL);
+	t2 = get_time_ns();
+
+	printf("threads: %"PRIu64" bytes in %f s, %f MB/s, %d errors\n", total,
+			(t2 - t1) / 1e9, total / 1e6 / ((t2 - t1) / 1e9), errors);
+
+	jack_ringbuffer_reset(rb);
+	run_vector();
+
+	jack_ringbuffer_free(rb);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
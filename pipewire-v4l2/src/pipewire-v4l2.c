@@ -16,6 +16,15 @@
 #include <pthread.h>
 #include <limits.h>
 #include <linux/videodev2.h>
+#ifdef __linux__
+#include <linux/dma-buf.h>
+#endif
+#ifndef DMA_BUF_SYNC_READ
+#define DMA_BUF_SYNC_READ	(1 << 0)
+#define DMA_BUF_SYNC_WRITE	(2 << 0)
+#define DMA_BUF_SYNC_START	(0 << 2)
+#define DMA_BUF_SYNC_END	(1 << 2)
+#endif
 
 #include "pipewire-v4l2.h"
 
@@ -75,6 +84,24 @@ struct buffer {
 	struct v4l2_buffer v4l2;
 	struct pw_buffer *buf;
 	uint32_t id;
+
+	/* our mapping of the PipeWire buffer, for copying into imported
+	 * USERPTR and DMABUF memory */
+	void *map_addr;
+	size_t map_size;
+	uint32_t map_start;
+
+	/* the USERPTR or DMABUF memory queued by the application */
+	void *import_addr;
+	size_t import_size;
+	int import_fd;
+	dev_t import_dev;
+	ino_t import_ino;
+	unsigned int imported:1;
+	unsigned int import_same:1;
+	/* the application has CPU access to the DmaBuf it mmapped, between
+	 * DQBUF and QBUF */
+	unsigned int cpu_access:1;
 };
 
 struct file {
@@ -108,6 +135,7 @@ struct file {
 
 	struct v4l2_format v4l2_format;
 	uint32_t reqbufs;
+	uint32_t memory;
 
 	int reqbufs_fd;
 	struct buffer buffers[MAX_BUFFERS];
@@ -262,6 +290,7 @@ static struct file *make_file(void)
 	file->ref = 1;
 	file->fd = -1;
 	file->reqbufs_fd = -1;
+	file->memory = V4L2_MEMORY_MMAP;
 	file->priority = V4L2_PRIORITY_DEFAULT;
 	spa_list_init(&file->globals);
 	pw_array_init(&file->buffer_maps, sizeof(struct buffer_map) * MAX_BUFFERS);
@@ -1271,7 +1300,7 @@ static void on_stream_param_changed(void *data, uint32_t id, const struct spa_po
 	uint32_t n_params = 0;
 	uint8_t buffer[4096];
 	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
-	uint32_t buffers, size, stride;
+	uint32_t buffers, size, stride, data_types;
 	struct v4l2_format fmt;
 
 	if (param == NULL || id != SPA_PARAM_Format)
@@ -1286,6 +1315,14 @@ static void on_stream_param_changed(void *data, uint32_t id, const struct spa_po
 	size = fmt.fmt.pix.sizeimage;
 	stride = fmt.fmt.pix.bytesperline;
 
+	/* DmaBuf memory can be mmapped by the application, with the CPU access
+	 * synced between DQBUF and QBUF, and exported with VIDIOC_EXPBUF.
+	 * Imported USERPTR and DMABUF memory is filled from any buffer type
+	 * we can map. */
+	data_types = (1<<SPA_DATA_MemFd) | (1<<SPA_DATA_DmaBuf);
+	if (file->memory != V4L2_MEMORY_MMAP)
+		data_types |= (1<<SPA_DATA_MemPtr);
+
 	params[n_params++] = spa_pod_builder_add_object(&b,
 			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
 			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(buffers,
@@ -1293,7 +1330,7 @@ static void on_stream_param_changed(void *data, uint32_t id, const struct spa_po
 			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
 			SPA_PARAM_BUFFERS_size,    SPA_POD_CHOICE_RANGE_Int(size, 0, INT_MAX),
 			SPA_PARAM_BUFFERS_stride,  SPA_POD_CHOICE_RANGE_Int(stride, 0, INT_MAX),
-			SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int((1<<SPA_DATA_MemFd)));
+			SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(data_types));
 
 
 	pw_stream_update_params(file->stream, params, n_params);
@@ -1320,6 +1357,167 @@ static void on_stream_state_changed(void *data, enum pw_stream_state old,
 	pw_thread_loop_signal(file->loop, false);
 }
 
+static void clear_import(struct buffer *buf)
+{
+	if (buf->import_addr != NULL && buf->v4l2.memory == V4L2_MEMORY_DMABUF)
+		globals.old_fops.munmap(buf->import_addr, buf->import_size);
+	if (buf->import_fd >= 0)
+		globals.old_fops.close(buf->import_fd);
+	buf->import_addr = NULL;
+	buf->import_size = 0;
+	buf->import_fd = -1;
+	buf->imported = false;
+	buf->import_same = false;
+}
+
+static void dmabuf_sync(int fd, uint64_t flags)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync = { .flags = flags };
+	if (fd >= 0 && globals.old_fops.ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) < 0)
+		pw_log_debug("fd:%d sync failed: %m", fd);
+#endif
+}
+
+/* Get a pointer to the memory of the PipeWire buffer, mapping it the first
+ * time when the stream did not map it. */
+static void *buffer_get_data(struct buffer *buf)
+{
+	struct spa_data *d = &buf->buf->buffer->datas[0];
+	struct pw_map_range range;
+	void *addr;
+
+	if (d->data != NULL)
+		return d->data;
+	if (buf->map_addr == NULL) {
+		if (d->fd < 0)
+			return NULL;
+		pw_map_range_init(&range, d->mapoffset, d->maxsize, 4096);
+		addr = globals.old_fops.mmap(NULL, range.size, PROT_READ, MAP_SHARED,
+				d->fd, range.offset);
+		if (addr == MAP_FAILED)
+			return NULL;
+		buf->map_addr = addr;
+		buf->map_size = range.size;
+		buf->map_start = range.start;
+	}
+	return SPA_PTROFF(buf->map_addr, buf->map_start, void);
+}
+
+/* Remember the USERPTR or DMABUF memory the application queued. A dmabuf
+ * that is the PipeWire buffer itself, because the application queued
+ * a buffer exported with VIDIOC_EXPBUF, is used without copying. */
+static int buffer_import(struct file *file, struct buffer *buf, const struct v4l2_buffer *arg)
+{
+	struct spa_data *d = &buf->buf->buffer->datas[0];
+	uint32_t min_size = file->v4l2_format.fmt.pix.sizeimage;
+	struct stat st, ours;
+	void *addr;
+	size_t size;
+	off_t end;
+	int fd;
+
+	switch (file->memory) {
+	case V4L2_MEMORY_USERPTR:
+		if (arg->m.userptr == 0 || arg->length < min_size)
+			return -EINVAL;
+		buf->import_addr = (void*)arg->m.userptr;
+		buf->import_size = arg->length;
+		buf->imported = true;
+		buf->v4l2.m.userptr = arg->m.userptr;
+		buf->v4l2.length = arg->length;
+		return 0;
+
+	case V4L2_MEMORY_DMABUF:
+		if (fstat(arg->m.fd, &st) < 0)
+			return -errno;
+
+		if (!buf->imported ||
+		    st.st_dev != buf->import_dev || st.st_ino != buf->import_ino) {
+			clear_import(buf);
+
+			if ((fd = fcntl(arg->m.fd, F_DUPFD_CLOEXEC, 0)) < 0)
+				return -errno;
+			buf->import_fd = fd;
+			buf->import_dev = st.st_dev;
+			buf->import_ino = st.st_ino;
+
+			if (d->type == SPA_DATA_DmaBuf && d->mapoffset == 0 &&
+			    fstat(d->fd, &ours) == 0 &&
+			    ours.st_dev == st.st_dev && ours.st_ino == st.st_ino) {
+				buf->import_same = true;
+			} else {
+				size = arg->length;
+				if (size == 0) {
+					if ((end = lseek(fd, 0, SEEK_END)) < 0)
+						return -errno;
+					size = end;
+				}
+				if (size < min_size)
+					return -EINVAL;
+				addr = globals.old_fops.mmap(NULL, size, PROT_READ | PROT_WRITE,
+						MAP_SHARED, fd, 0);
+				if (addr == MAP_FAILED)
+					return -errno;
+				buf->import_addr = addr;
+				buf->import_size = size;
+			}
+			buf->imported = true;
+
+			pw_log_info("file:%d: id:%d import fd:%d size:%zu copy:%d", file->fd,
+					buf->id, arg->m.fd, buf->import_size, !buf->import_same);
+		}
+		buf->v4l2.m.fd = arg->m.fd;
+		buf->v4l2.length = arg->length;
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+/* Copy the frame into the imported memory, returns the number of bytes
+ * in the buffer */
+static int buffer_copy_out(struct file *file, struct buffer *buf)
+{
+	struct spa_data *d = &buf->buf->buffer->datas[0];
+	uint32_t offset, size;
+	void *src;
+
+	offset = SPA_MIN(d->chunk->offset, d->maxsize);
+	size = SPA_MIN(d->chunk->size, d->maxsize - offset);
+
+	if (file->memory == V4L2_MEMORY_MMAP) {
+		/* the application reads the DmaBuf through its own mapping */
+		if (d->type == SPA_DATA_DmaBuf && !buf->cpu_access) {
+			dmabuf_sync(d->fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+			buf->cpu_access = true;
+		}
+		return size;
+	}
+	if (buf->import_same)
+		return size;
+	if (!buf->imported)
+		return -EINVAL;
+	if ((src = buffer_get_data(buf)) == NULL)
+		return -errno;
+
+	size = SPA_MIN(size, buf->import_size);
+
+	if (d->type == SPA_DATA_DmaBuf)
+		dmabuf_sync(d->fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+	if (file->memory == V4L2_MEMORY_DMABUF)
+		dmabuf_sync(buf->import_fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+
+	memcpy(buf->import_addr, SPA_PTROFF(src, offset, void), size);
+
+	if (file->memory == V4L2_MEMORY_DMABUF)
+		dmabuf_sync(buf->import_fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+	if (d->type == SPA_DATA_DmaBuf)
+		dmabuf_sync(d->fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+
+	return size;
+}
+
 static void on_stream_add_buffer(void *data, struct pw_buffer *b)
 {
 	struct file *file = data;
@@ -1330,28 +1528,49 @@ static void on_stream_add_buffer(void *data, struct pw_buffer *b)
 
 	file->size = d->maxsize;
 
-	pw_log_info("file:%d: id:%d fd:%"PRIi64" size:%u offset:%u", file->fd,
-			id, d->fd, file->size, id * file->size);
+	pw_log_info("file:%d: id:%d type:%u fd:%"PRIi64" size:%u offset:%u", file->fd,
+			id, d->type, d->fd, file->size, id * file->size);
 
 	spa_zero(vb);
 	vb.index = id;
 	vb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	vb.flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
-	vb.memory = V4L2_MEMORY_MMAP;
-	vb.m.offset = id * file->size;
-	vb.length = file->size;
+	vb.memory = file->memory;
+	if (file->memory == V4L2_MEMORY_MMAP) {
+		vb.m.offset = id * file->size;
+		vb.length = file->size;
+	}
 
+	spa_zero(*buf);
 	buf->v4l2 = vb;
 	buf->id = id;
 	buf->buf = b;
+	buf->import_fd = -1;
 	b->user_data = buf;
 
 	file->n_buffers++;
 }
 
+static void buffer_end_cpu_access(struct buffer *buf)
+{
+	if (buf->cpu_access) {
+		dmabuf_sync(buf->buf->buffer->datas[0].fd,
+				DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+		buf->cpu_access = false;
+	}
+}
+
 static void on_stream_remove_buffer(void *data, struct pw_buffer *b)
 {
 	struct file *file = data;
+	struct buffer *buf = b->user_data;
+
+	buffer_end_cpu_access(buf);
+	clear_import(buf);
+	if (buf->map_addr != NULL) {
+		globals.old_fops.munmap(buf->map_addr, buf->map_size);
+		buf->map_addr = NULL;
+	}
 	file->n_buffers--;
 }
 
@@ -1867,8 +2086,14 @@ static int vidioc_reqbufs(struct file *file, int fd, struct v4l2_requestbuffers
 
 	if (arg->type != V4L2_BUF_TYPE_VIDEO_CAPTURE)
 		return -EINVAL;
-	if (arg->memory != V4L2_MEMORY_MMAP)
+	switch (arg->memory) {
+	case V4L2_MEMORY_MMAP:
+	case V4L2_MEMORY_USERPTR:
+	case V4L2_MEMORY_DMABUF:
+		break;
+	default:
 		return -EINVAL;
+	}
 
 	pw_thread_loop_lock(file->loop);
 
@@ -1893,6 +2118,7 @@ static int vidioc_reqbufs(struct file *file, int fd, struct v4l2_requestbuffers
 		file->reqbufs_fd = -1;
 	} else {
 		file->reqbufs = arg->count;
+		file->memory = arg->memory;
 
 		if ((res = connect_stream(file)) < 0)
 			goto exit_unlock;
@@ -1904,7 +2130,9 @@ static int vidioc_reqbufs(struct file *file, int fd, struct v4l2_requestbuffers
 	arg->flags = 0;
 #endif
 #ifdef V4L2_BUF_CAP_SUPPORTS_MMAP
-	arg->capabilities = V4L2_BUF_CAP_SUPPORTS_MMAP;
+	arg->capabilities = V4L2_BUF_CAP_SUPPORTS_MMAP |
+		V4L2_BUF_CAP_SUPPORTS_USERPTR |
+		V4L2_BUF_CAP_SUPPORTS_DMABUF;
 #endif
 	memset(arg->reserved, 0, sizeof(arg->reserved));
 
@@ -1946,11 +2174,10 @@ static int vidioc_qbuf(struct file *file, struct v4l2_buffer *arg)
 
 	if (arg->type != V4L2_BUF_TYPE_VIDEO_CAPTURE)
 		return -EINVAL;
-	if (arg->memory != V4L2_MEMORY_MMAP)
-		return -EINVAL;
 
 	pw_thread_loop_lock(file->loop);
-	if (arg->index >= file->n_buffers) {
+	if (arg->memory != file->memory ||
+	    arg->index >= file->n_buffers) {
 		res = -EINVAL;
 		goto exit;
 	}
@@ -1960,6 +2187,10 @@ static int vidioc_qbuf(struct file *file, struct v4l2_buffer *arg)
 		res = -EINVAL;
 		goto exit;
 	}
+	if ((res = buffer_import(file, buf, arg)) < 0)
+		goto exit;
+
+	buffer_end_cpu_access(buf);
 
 	SPA_FLAG_SET(buf->v4l2.flags, V4L2_BUF_FLAG_QUEUED);
 	arg->flags = buf->v4l2.flags;
@@ -1979,17 +2210,18 @@ static int vidioc_dqbuf(struct file *file, int fd, struct v4l2_buffer *arg)
 	uint64_t val;
 	struct spa_data *d;
 	struct timespec ts;
+	bool corrupted;
+	int size;
 
 	if (arg->type != V4L2_BUF_TYPE_VIDEO_CAPTURE)
 		return -EINVAL;
-	if (arg->memory != V4L2_MEMORY_MMAP)
-		return -EINVAL;
 
 	pw_log_debug("file:%d (%d) %d", file->fd, fd,
 			arg->index);
 
 	pw_thread_loop_lock(file->loop);
-	if (arg->index >= file->n_buffers) {
+	if (arg->memory != file->memory ||
+	    arg->index >= file->n_buffers) {
 		res = -EINVAL;
 		goto exit_unlock;
 	}
@@ -2016,8 +2248,15 @@ static int vidioc_dqbuf(struct file *file, int fd, struct v4l2_buffer *arg)
 	d = &buf->buf->buffer->datas[0];
 	SPA_FLAG_CLEAR(buf->v4l2.flags, V4L2_BUF_FLAG_QUEUED);
 
-	SPA_FLAG_UPDATE(buf->v4l2.flags, V4L2_BUF_FLAG_ERROR,
-		SPA_FLAG_IS_SET(d->chunk->flags, SPA_CHUNK_FLAG_CORRUPTED));
+	if ((size = buffer_copy_out(file, buf)) < 0) {
+		pw_log_warn("file:%d: id:%d copy failed: %s", file->fd,
+				buf->id, spa_strerror(size));
+		corrupted = true;
+		size = 0;
+	} else {
+		corrupted = SPA_FLAG_IS_SET(d->chunk->flags, SPA_CHUNK_FLAG_CORRUPTED);
+	}
+	SPA_FLAG_UPDATE(buf->v4l2.flags, V4L2_BUF_FLAG_ERROR, corrupted);
 
 	SPA_FLAG_SET(buf->v4l2.flags, V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC);
 	clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -2025,7 +2264,7 @@ static int vidioc_dqbuf(struct file *file, int fd, struct v4l2_buffer *arg)
 	buf->v4l2.timestamp.tv_usec = ts.tv_nsec / 1000;
 
 	buf->v4l2.field = V4L2_FIELD_NONE;
-	buf->v4l2.bytesused = d->chunk->size;
+	buf->v4l2.bytesused = size;
 	buf->v4l2.sequence = file->sequence++;
 	*arg = buf->v4l2;
 
@@ -2036,6 +2275,46 @@ exit_unlock:
 	return res;
 }
 
+static int vidioc_expbuf(struct file *file, struct v4l2_exportbuffer *arg)
+{
+	int res;
+	struct spa_data *d;
+
+	if (arg->type != V4L2_BUF_TYPE_VIDEO_CAPTURE)
+		return -EINVAL;
+
+	pw_thread_loop_lock(file->loop);
+	if (file->memory != V4L2_MEMORY_MMAP ||
+	    arg->index >= file->n_buffers || arg->plane > 0) {
+		res = -EINVAL;
+		goto exit_unlock;
+	}
+	d = &file->buffers[arg->index].buf->buffer->datas[0];
+
+	/* only dmabufs can be exported, the importer expects a dmabuf fd and
+	 * would fail on a memfd */
+	if (d->type != SPA_DATA_DmaBuf || d->fd < 0 || d->mapoffset != 0) {
+		res = -EINVAL;
+		goto exit_unlock;
+	}
+	res = fcntl(d->fd, SPA_FLAG_IS_SET(arg->flags, O_CLOEXEC) ?
+			F_DUPFD_CLOEXEC : F_DUPFD, 0);
+	if (res < 0) {
+		res = -errno;
+		goto exit_unlock;
+	}
+	arg->fd = res;
+	memset(arg->reserved, 0, sizeof(arg->reserved));
+	res = 0;
+
+exit_unlock:
+	pw_thread_loop_unlock(file->loop);
+
+	pw_log_info("file:%d index:%u -> %d (%s)", file->fd, arg->index,
+			res < 0 ? res : arg->fd, spa_strerror(res));
+	return res;
+}
+
 static int vidioc_streamon(struct file *file, int *arg)
 {
 	int res;
@@ -2417,6 +2696,9 @@ static int v4l2_ioctl(int fd, unsigned long int request, void *arg)
 	case VIDIOC_DQBUF:
 		res = vidioc_dqbuf(file, fd, (struct v4l2_buffer *)arg);
 		break;
+	case VIDIOC_EXPBUF:
+		res = vidioc_expbuf(file, (struct v4l2_exportbuffer *)arg);
+		break;
 	case VIDIOC_STREAMON:
 		res = vidioc_streamon(file, (int *)arg);
 		break;
@@ -2466,6 +2748,11 @@ static void *v4l2_mmap(void *addr, size_t length, int prot,
 		return globals.old_fops.mmap(addr, length, prot, flags, fd, offset);
 
 	pw_thread_loop_lock(file->loop);
+	if (file->memory != V4L2_MEMORY_MMAP) {
+		errno = EINVAL;
+		res = MAP_FAILED;
+		goto error_unlock;
+	}
 	if (file->size == 0) {
 		errno = EIO;
 		res = MAP_FAILED;
@@ -5,6 +5,12 @@
 #ifndef SPA_UTILS_JSON_H
 #define SPA_UTILS_JSON_H
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #else
@@ -54,6 +60,121 @@ static inline void spa_json_enter(struct spa_json * iter, struct spa_json * sub)
 
 #define SPA_JSON_SAVE(iter) ((struct spa_json) { (iter)->cur, (iter)->end, NULL, (iter)->state, 0 })
 
+/* Skip runs of characters that don't change the tokenizer state. These return
+ * the first character in [cur, end) that needs to go through the state machine. */
+static inline bool _spa_json_is_string_plain(unsigned char c)
+{
+	return c >= 32 && c <= 127 && c != '"' && c != '\\';
+}
+
+static inline bool _spa_json_is_bare_plain(unsigned char c)
+{
+	switch (c) {
+	case '"': case '#': case ':': case ',': case '=': case ']': case '}': case '\\':
+		return false;
+	}
+	return c > 32 && c <= 126;
+}
+
+static inline const char *_spa_json_skip_string(const char *cur, const char *end)
+{
+#if defined(__SSE2__)
+	for (; end - cur >= 16; cur += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)cur);
+		/* signed compare, also catches UTF-8 bytes >= 128 */
+		__m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(32)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+					_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+		int mask = _mm_movemask_epi8(bad);
+		if (mask != 0)
+			return cur + __builtin_ctz(mask);
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	for (; end - cur >= 16; cur += 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t *)cur);
+		uint8x16_t bad = vorrq_u8(vorrq_u8(vcltq_u8(v, vdupq_n_u8(32)),
+					vcgtq_u8(v, vdupq_n_u8(127))),
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')),
+					vceqq_u8(v, vdupq_n_u8('\\'))));
+		if (vmaxvq_u8(bad) != 0)
+			break;
+	}
+#endif
+	while (cur < end && _spa_json_is_string_plain((unsigned char)*cur))
+		cur++;
+	return cur;
+}
+
+static inline const char *_spa_json_skip_bare(const char *cur, const char *end)
+{
+#if defined(__SSE2__)
+	for (; end - cur >= 16; cur += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)cur);
+		__m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(33)),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8(127)));
+		bad = _mm_or_si128(bad, _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+					_mm_cmpeq_epi8(v, _mm_set1_epi8('#'))),
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+					_mm_cmpeq_epi8(v, _mm_set1_epi8(',')))));
+		bad = _mm_or_si128(bad, _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('=')),
+					_mm_cmpeq_epi8(v, _mm_set1_epi8(']'))),
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('}')),
+					_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')))));
+		int mask = _mm_movemask_epi8(bad);
+		if (mask != 0)
+			return cur + __builtin_ctz(mask);
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	for (; end - cur >= 16; cur += 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t *)cur);
+		uint8x16_t bad = vorrq_u8(vcltq_u8(v, vdupq_n_u8(33)),
+				vcgtq_u8(v, vdupq_n_u8(126)));
+		bad = vorrq_u8(bad, vorrq_u8(
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')),
+					vceqq_u8(v, vdupq_n_u8('#'))),
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')),
+					vceqq_u8(v, vdupq_n_u8(',')))));
+		bad = vorrq_u8(bad, vorrq_u8(
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('=')),
+					vceqq_u8(v, vdupq_n_u8(']'))),
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('}')),
+					vceqq_u8(v, vdupq_n_u8('\\')))));
+		if (vmaxvq_u8(bad) != 0)
+			break;
+	}
+#endif
+	while (cur < end && _spa_json_is_bare_plain((unsigned char)*cur))
+		cur++;
+	return cur;
+}
+
+static inline const char *_spa_json_skip_comment(const char *cur, const char *end)
+{
+#if defined(__SSE2__)
+	for (; end - cur >= 16; cur += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)cur);
+		__m128i bad = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+		int mask = _mm_movemask_epi8(bad);
+		if (mask != 0)
+			return cur + __builtin_ctz(mask);
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	for (; end - cur >= 16; cur += 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t *)cur);
+		uint8x16_t bad = vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')),
+				vceqq_u8(v, vdupq_n_u8('\r')));
+		if (vmaxvq_u8(bad) != 0)
+			break;
+	}
+#endif
+	while (cur < end && *cur != '\n' && *cur != '\r')
+		cur++;
+	return cur;
+}
+
 /** Get the next token. \a value points to the token and the return value
  * is the length. Returns -1 on parse error, 0 on end of input. */
 static inline int spa_json_next(struct spa_json * iter, const char **value)
@@ -213,8 +334,10 @@ static inline int spa_json_next(struct spa_json * iter, const char **value)
 				_SPA_ERROR(ESCAPE_NOT_ALLOWED);
 			default:
 				/* allow bare ascii */
-				if (cur >= 32 && cur <= 126)
+				if (cur >= 32 && cur <= 126) {
+					iter->cur = _spa_json_skip_bare(iter->cur + 1, iter->end) - 1;
 					continue;
+				}
 			}
 			_SPA_ERROR(CHARACTERS_NOT_ALLOWED);
 		case __STRING:
@@ -238,8 +361,10 @@ static inline int spa_json_next(struct spa_json * iter, const char **value)
 				iter->state = __UTF8 | flag;
 				continue;
 			default:
-				if (cur >= 32 && cur <= 127)
+				if (cur >= 32 && cur <= 127) {
+					iter->cur = _spa_json_skip_string(iter->cur + 1, iter->end) - 1;
 					continue;
+				}
 			}
 			_SPA_ERROR(CHARACTERS_NOT_ALLOWED);
 		case __UTF8:
@@ -262,6 +387,9 @@ static inline int spa_json_next(struct spa_json * iter, const char **value)
 			switch (cur) {
 			case '\n': case '\r':
 				iter->state = __STRUCT | flag;
+				break;
+			default:
+				iter->cur = _spa_json_skip_comment(iter->cur + 1, iter->end) - 1;
 			}
 			break;
 		default:
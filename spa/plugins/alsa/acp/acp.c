@@ -2,10 +2,15 @@
 /* SPDX-FileCopyrightText: Copyright © 2020 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include "config.h"
+
 #include "acp.h"
 #include "alsa-mixer.h"
 #include "alsa-ucm.h"
 
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
 
@@ -1634,11 +1639,190 @@ static void prune_singleton_availability_groups(pa_hashmap *ports) {
     pa_hashmap_free(group_counts);
 }
 
+/* The probe cache stores which profiles could not be opened for a card,
+ * keyed on the card identity, so that they don't need to be probed again. */
+static char *probe_cache_identity(pa_card *impl, const char *profile_set)
+{
+	snd_ctl_t *ctl;
+	snd_ctl_card_info_t *info;
+	struct utsname uts;
+	struct stat st;
+	char name[32], *fn;
+	const char *s;
+	pa_strbuf *sb;
+	int err;
+
+	snd_ctl_card_info_alloca(&info);
+
+	snprintf(name, sizeof(name), "hw:%u", impl->card.index);
+	if ((err = snd_ctl_open(&ctl, name, 0)) < 0) {
+		pa_log_debug("can't open control %s: %s", name, snd_strerror(err));
+		return NULL;
+	}
+	err = snd_ctl_card_info(ctl, info);
+	snd_ctl_close(ctl);
+	if (err < 0)
+		return NULL;
+
+	sb = pa_strbuf_new();
+	pa_strbuf_printf(sb, "version=1\n");
+	pa_strbuf_printf(sb, "pipewire=%s\n", PACKAGE_VERSION);
+	pa_strbuf_printf(sb, "alsa=%s\n", snd_asoundlib_version());
+	if (uname(&uts) == 0)
+		pa_strbuf_printf(sb, "kernel=%s\n", uts.release);
+	pa_strbuf_printf(sb, "driver=%s\n", snd_ctl_card_info_get_driver(info));
+	pa_strbuf_printf(sb, "name=%s\n", snd_ctl_card_info_get_name(info));
+	pa_strbuf_printf(sb, "mixer=%s\n", snd_ctl_card_info_get_mixername(info));
+	pa_strbuf_printf(sb, "components=%s\n", snd_ctl_card_info_get_components(info));
+	if ((s = pa_proplist_gets(impl->proplist, "device.vendor.id")) != NULL)
+		pa_strbuf_printf(sb, "vendor=%s\n", s);
+	if ((s = pa_proplist_gets(impl->proplist, "device.product.id")) != NULL)
+		pa_strbuf_printf(sb, "product=%s\n", s);
+	pa_strbuf_printf(sb, "profile-set=%s\n", profile_set ? profile_set : "default.conf");
+
+	/* edits to the profile set invalidate the cache, use the same lookup
+	 * as pa_alsa_profile_set_new() */
+	fn = get_data_path(NULL, "profile-sets", profile_set ? profile_set : "default.conf");
+	if (access(fn, R_OK) != 0 && profile_set != NULL) {
+		pa_xfree(fn);
+		fn = get_data_path(NULL, "profile-sets", "default.conf");
+	}
+	if (stat(fn, &st) == 0)
+		pa_strbuf_printf(sb, "profile-set-file=%s %lld.%09ld %lld\n", fn,
+				(long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec,
+				(long long)st.st_size);
+	pa_xfree(fn);
+	pa_strbuf_printf(sb, "rate=%u\n", impl->rate);
+	pa_strbuf_puts(sb, "\n");
+
+	return pa_strbuf_to_string_free(sb);
+}
+
+static int probe_cache_dir(char *path, size_t size)
+{
+	const char *dir;
+	char *p;
+	int len;
+
+	if ((dir = getenv("PIPEWIRE_STATE_DIR")) != NULL)
+		len = snprintf(path, size, "%s/acp", dir);
+	else if ((dir = getenv("XDG_STATE_HOME")) != NULL)
+		len = snprintf(path, size, "%s/pipewire/acp", dir);
+	else if ((dir = getenv("HOME")) != NULL)
+		len = snprintf(path, size, "%s/.local/state/pipewire/acp", dir);
+	else
+		return -ENOENT;
+
+	if (len < 0 || (size_t)len >= size)
+		return -ENAMETOOLONG;
+
+	for (p = path + 1; ; p++) {
+		if (*p != '/' && *p != '\0')
+			continue;
+		if (*p == '/')
+			*p = '\0';
+		if (mkdir(path, 0700) < 0 && errno != EEXIST)
+			return -errno;
+		if (p == path + len)
+			break;
+		*p = '/';
+	}
+	return 0;
+}
+
+static char *probe_cache_path(const char *identity)
+{
+	char dir[PATH_MAX];
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	const char *p;
+
+	if (probe_cache_dir(dir, sizeof(dir)) < 0)
+		return NULL;
+
+	/* FNV-1a, the identity is also stored and compared when loading */
+	for (p = identity; *p; p++)
+		hash = (hash ^ (uint8_t)*p) * 0x100000001b3ULL;
+
+	return pa_sprintf_malloc("%s/probe-%016" PRIx64 ".cache", dir, hash);
+}
+
+static void probe_cache_load(pa_card *impl, const char *path, const char *identity)
+{
+	pa_alsa_profile_set *ps = impl->profile_set;
+	size_t id_len = strlen(identity);
+	char *line = NULL, *val;
+	size_t size = 0;
+	ssize_t len;
+	FILE *f;
+
+	ps->probe_results = pa_hashmap_new_full(pa_idxset_string_hash_func,
+			pa_idxset_string_compare_func, pa_xfree, NULL);
+
+	if ((f = fopen(path, "re")) == NULL)
+		return;
+
+	/* the identity is the first part of the file, up to the empty line */
+	val = malloc(id_len + 1);
+	if (val == NULL || fread(val, 1, id_len, f) != id_len ||
+	    memcmp(val, identity, id_len) != 0) {
+		pa_log_info("ignoring probe cache %s for different card", path);
+		goto done;
+	}
+	while ((len = getline(&line, &size, f)) > 0) {
+		char *sep;
+		int result;
+
+		if (line[len-1] == '\n')
+			line[len-1] = '\0';
+		if ((sep = strrchr(line, ' ')) == NULL)
+			continue;
+		*sep++ = '\0';
+		result = atoi(sep);
+		if (result != PA_ALSA_PROBE_RESULT_UNSUPPORTED &&
+		    result != PA_ALSA_PROBE_RESULT_SUPPORTED)
+			continue;
+		pa_hashmap_remove_and_free(ps->probe_results, line);
+		pa_hashmap_put(ps->probe_results, pa_xstrdup(line), PA_UINT_TO_PTR(result));
+	}
+	pa_log_info("loaded probe cache %s with %u profiles", path,
+			pa_hashmap_size(ps->probe_results));
+done:
+	free(val);
+	free(line);
+	fclose(f);
+}
+
+static void probe_cache_save(pa_card *impl, const char *path, const char *identity)
+{
+	pa_alsa_profile_set *ps = impl->profile_set;
+	char *tmp;
+	const void *key;
+	void *state, *val;
+	FILE *f;
+
+	tmp = pa_sprintf_malloc("%s.tmp.%d", path, (int)getpid());
+	if ((f = fopen(tmp, "we")) == NULL) {
+		pa_log_debug("can't open probe cache %s: %m", tmp);
+		goto done;
+	}
+	fputs(identity, f);
+	PA_HASHMAP_FOREACH_KV(key, val, ps->probe_results, state)
+		fprintf(f, "%s %u\n", (const char*)key, PA_PTR_TO_UINT(val));
+
+	if (fclose(f) != 0 || rename(tmp, path) < 0) {
+		pa_log_warn("can't save probe cache %s: %m", path);
+		unlink(tmp);
+	}
+done:
+	pa_xfree(tmp);
+}
+
 struct acp_card *acp_card_new(uint32_t index, const struct acp_dict *props)
 {
 	pa_card *impl;
 	struct acp_card *card;
 	const char *s, *profile_set = NULL, *profile = NULL;
+	char *cache_identity = NULL, *cache_path = NULL;
 	char device_id[16];
 	uint32_t profile_index;
 	int res;
@@ -1681,6 +1865,8 @@ struct acp_card *acp_card_new(uint32_t index, const struct acp_dict *props)
 			impl->auto_port = spa_atob(s);
 		if ((s = acp_dict_lookup(props, "api.acp.probe-rate")) != NULL)
 			impl->rate = atoi(s);
+		if ((s = acp_dict_lookup(props, "api.acp.probe-cache")) != NULL)
+			impl->probe_cache = spa_atob(s);
 		if ((s = acp_dict_lookup(props, "api.acp.pro-channels")) != NULL)
 			impl->pro_channels = atoi(s);
 	}
@@ -1724,12 +1910,22 @@ struct acp_card *acp_card_new(uint32_t index, const struct acp_dict *props)
 
 	impl->profile_set->ignore_dB = impl->ignore_dB;
 
+	if (impl->probe_cache && !impl->use_ucm &&
+	    (cache_identity = probe_cache_identity(impl, profile_set)) != NULL &&
+	    (cache_path = probe_cache_path(cache_identity)) != NULL)
+		probe_cache_load(impl, cache_path, cache_identity);
+
 	pa_alsa_profile_set_probe(impl->profile_set, impl->ucm.mixers,
 			device_id,
 			&impl->ucm.default_sample_spec,
 			impl->ucm.default_n_fragments,
 			impl->ucm.default_fragment_size_msec);
 
+	if (cache_path != NULL)
+		probe_cache_save(impl, cache_path, cache_identity);
+	pa_xfree(cache_path);
+	free(cache_identity);
+
 	pa_alsa_init_proplist_card(NULL, impl->proplist, impl->card.index);
 	pa_proplist_sets(impl->proplist, PA_PROP_DEVICE_STRING, device_id);
 	pa_alsa_init_description(impl->proplist, NULL);
@@ -2086,3 +2282,8 @@ void acp_set_log_level(int level)
 {
 	_acp_log_level = level;
 }
+
+void acp_set_thread_error_handler(void)
+{
+	pa_alsa_set_thread_error_handler();
+}
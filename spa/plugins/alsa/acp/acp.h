@@ -294,6 +294,10 @@ typedef void (*acp_log_func) (void *data,
 void acp_set_log_func(acp_log_func, void *data);
 void acp_set_log_level(int level);
 
+/** Install the ALSA error handlers in the calling thread, needed when a card
+ * is used from another thread than the one that created it. */
+void acp_set_thread_error_handler(void);
+
 #ifdef __cplusplus
 }
 #endif
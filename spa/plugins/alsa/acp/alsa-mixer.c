@@ -3834,6 +3834,9 @@ void pa_alsa_profile_set_free(pa_alsa_profile_set *ps) {
     if (ps->decibel_fixes)
         pa_hashmap_free(ps->decibel_fixes);
 
+    if (ps->probe_results)
+        pa_hashmap_free(ps->probe_results);
+
     pa_xfree(ps);
 }
 
@@ -5017,6 +5020,17 @@ static int add_profiles_to_probe(
     return i;
 }
 
+static bool open_error_is_transient(int err) {
+    /* The device might be usable later, don't cache the result */
+    return err == EBUSY || err == EAGAIN || err == EINTR || err == ENOMEM;
+}
+
+static void profile_set_store_result(pa_alsa_profile_set *ps, pa_alsa_profile *p) {
+    pa_hashmap_remove_and_free(ps->probe_results, p->name);
+    pa_hashmap_put(ps->probe_results, pa_xstrdup(p->name),
+            PA_UINT_TO_PTR(p->supported ? PA_ALSA_PROBE_RESULT_SUPPORTED : PA_ALSA_PROBE_RESULT_UNSUPPORTED));
+}
+
 static void mapping_query_hw_device(pa_alsa_mapping *mapping, snd_pcm_t *pcm) {
     int r;
     snd_pcm_info_t* pcm_info;
@@ -5071,6 +5085,7 @@ void pa_alsa_profile_set_probe(
 
     for (pp = probe_order; *pp; pp++) {
         uint32_t idx;
+        bool transient = false;
         p = *pp;
 
         /* Skip if fallback and already found something, but still probe already selected fallbacks.
@@ -5087,6 +5102,12 @@ void pa_alsa_profile_set_probe(
         /* Skip if this is already marked that it is supported (i.e. from the config file) */
         if (!p->supported) {
 
+            if (ps->probe_results &&
+                PA_PTR_TO_UINT(pa_hashmap_get(ps->probe_results, p->name)) == PA_ALSA_PROBE_RESULT_UNSUPPORTED) {
+                pa_log_debug("Skipping profile %s - cached as unsupported", p->name);
+                continue;
+            }
+
             profile_finalize_probing(last, p);
             p->supported = true;
 
@@ -5125,6 +5146,7 @@ void pa_alsa_profile_set_probe(
                                                            SND_PCM_STREAM_PLAYBACK,
                                                            default_n_fragments,
                                                            default_fragment_size_msec))) {
+                        transient = open_error_is_transient(errno);
                         p->supported = false;
                         if (pa_idxset_size(p->output_mappings) == 1 &&
                             ((!p->input_mappings) || pa_idxset_size(p->input_mappings) == 0)) {
@@ -5149,6 +5171,7 @@ void pa_alsa_profile_set_probe(
                                                           SND_PCM_STREAM_CAPTURE,
                                                           default_n_fragments,
                                                           default_fragment_size_msec))) {
+                        transient = open_error_is_transient(errno);
                         p->supported = false;
                         if (pa_idxset_size(p->input_mappings) == 1 &&
                             ((!p->output_mappings) || pa_idxset_size(p->output_mappings) == 0)) {
@@ -5164,6 +5187,9 @@ void pa_alsa_profile_set_probe(
 
             last = p;
 
+            if (ps->probe_results && !transient)
+                profile_set_store_result(ps, p);
+
             if (!p->supported)
                 continue;
         }
@@ -415,11 +415,18 @@ struct pa_alsa_profile_set {
     pa_hashmap *input_paths;
     pa_hashmap *output_paths;
 
+    /* Optional, profile name -> PA_ALSA_PROBE_RESULT_*. Profiles cached as
+     * unsupported are not probed and the results of the probe are stored. */
+    pa_hashmap *probe_results;
+
     bool auto_profiles;
     bool ignore_dB:1;
     bool probed:1;
 };
 
+#define PA_ALSA_PROBE_RESULT_UNSUPPORTED	1
+#define PA_ALSA_PROBE_RESULT_SUPPORTED		2
+
 void pa_alsa_mapping_dump(pa_alsa_mapping *m);
 void pa_alsa_profile_dump(pa_alsa_profile *p);
 void pa_alsa_decibel_fix_dump(pa_alsa_decibel_fix *db_fix);
@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include <sys/types.h>
+#include <pthread.h>
 #include <alsa/asoundlib.h>
 
 #include "alsa-util.h"
@@ -769,6 +770,7 @@ snd_pcm_t *pa_alsa_open_by_device_string(
             pa_log("Device %s has %u channels, but PulseAudio supports only %u channels. Unable to use the device.",
                    d, ss->channels, PA_CHANNELS_MAX);
             pa_alsa_close(&pcm_handle);
+            err = -EINVAL;
             goto fail;
         }
 
@@ -785,6 +787,7 @@ snd_pcm_t *pa_alsa_open_by_device_string(
 
 fail:
     pa_xfree(d);
+    errno = -err;
 
     return NULL;
 }
@@ -911,6 +914,7 @@ static PA_PRINTF_FUNC(5,6) void alsa_error_handler(const char *file, int line, c
 }
 
 static int n_error_handler_installed = 0;
+static pthread_mutex_t error_handler_lock = PTHREAD_MUTEX_INITIALIZER;
 
 typedef void (*snd_lib2_error_handler_t)(const char *file, int line, const char *function, int err, const char *fmt, ...) PA_PRINTF_FUNC(5,6) /* __attribute__ ((format (printf, 5, 6))) */;
 typedef void (*snd_lib2_local_handler_t)(const char *file, int line, const char *function, int err, const char *fmt, va_list args) PA_PRINTF_FUNC(5,0) /* __attribute__ ((format (printf, 5, 0))) */;
@@ -919,16 +923,25 @@ extern int snd_lib_error_set_handler(snd_lib2_error_handler_t handler);
 extern snd_local_error_handler_t snd_lib_error_set_local(snd_lib2_local_handler_t handler);
 
 void pa_alsa_refcnt_inc(void) {
-    /* This is not really thread safe, but we do our best */
-   if (n_error_handler_installed++ == 0) {
+    /* Cards can be probed from multiple threads */
+    pthread_mutex_lock(&error_handler_lock);
+    if (n_error_handler_installed++ == 0)
         snd_lib_error_set_handler(alsa_error_handler);
-        snd_lib_error_set_local(alsa_local_handler);
-   }
+    pthread_mutex_unlock(&error_handler_lock);
+
+    pa_alsa_set_thread_error_handler();
+}
+
+/* The local error handler is per thread, install it in every thread
+ * that makes ALSA calls for a card */
+void pa_alsa_set_thread_error_handler(void) {
+    snd_lib_error_set_local(alsa_local_handler);
 }
 
 void pa_alsa_refcnt_dec(void) {
     int r;
 
+    pthread_mutex_lock(&error_handler_lock);
     pa_assert_se((r = n_error_handler_installed--) >= 1);
 
     if (r == 1) {
@@ -936,6 +949,7 @@ void pa_alsa_refcnt_dec(void) {
         snd_lib_error_set_local(NULL);
         snd_config_update_free_global();
     }
+    pthread_mutex_unlock(&error_handler_lock);
 }
 
 bool pa_alsa_init_description(pa_proplist *p, pa_card *card) {
@@ -127,6 +127,7 @@ int pa_alsa_close(snd_pcm_t **pcm);
 
 void pa_alsa_refcnt_inc(void);
 void pa_alsa_refcnt_dec(void);
+void pa_alsa_set_thread_error_handler(void);
 
 void pa_alsa_init_proplist_pcm_info(pa_core *c, pa_proplist *p, snd_pcm_info_t *pcm_info);
 void pa_alsa_init_proplist_card(pa_core *c, pa_proplist *p, int card);
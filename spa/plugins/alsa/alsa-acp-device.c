@@ -8,6 +8,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <pthread.h>
 
 #include <alsa/asoundlib.h>
 
@@ -16,6 +17,7 @@
 #include <spa/utils/type.h>
 #include <spa/utils/keys.h>
 #include <spa/utils/names.h>
+#include <spa/utils/result.h>
 #include <spa/utils/string.h>
 #include <spa/support/log.h>
 #include <spa/support/loop.h>
@@ -62,6 +64,7 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_loop *loop;
+	struct spa_loop_utils *loop_utils;
 
 	uint32_t info_all;
 	struct spa_device_info info;
@@ -81,6 +84,18 @@ struct impl {
 	struct pollfd pfds[MAX_POLL];
 	int n_pfds;
 	struct spa_source sources[MAX_POLL];
+
+	/* the card is probed in a thread with api.acp.probe-async */
+	struct {
+		pthread_t thread;
+		struct spa_source *done;
+		uint32_t index;
+		struct acp_dict_item *items;
+		uint32_t n_items;
+		struct acp_card *card;
+		int res;
+		unsigned int running:1;
+	} probe;
 };
 
 static int emit_info(struct impl *this, bool full);
@@ -226,6 +241,9 @@ static int emit_info(struct impl *this, bool full)
 	uint64_t old = full ? this->info.change_mask : 0;
 	const char *card_id;
 
+	if (card == NULL)
+		return 0;
+
 	if (full)
 		this->info.change_mask = this->info_all;
 	if (this->info.change_mask) {
@@ -278,6 +296,11 @@ static int impl_add_listener(void *object,
 	spa_return_val_if_fail(events != NULL, -EINVAL);
 
 	card = this->card;
+	if (card == NULL) {
+		/* still probing, everything is emitted when the probe completes */
+		spa_hook_list_append(&this->hooks, listener, events, data);
+		return 0;
+	}
 	if (card->active_profile_index < card->n_profiles)
 		profile = card->profiles[card->active_profile_index];
 	else
@@ -524,11 +547,13 @@ static int impl_enum_params(void *object, int seq,
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 	spa_return_val_if_fail(num != 0, -EINVAL);
 
+	card = this->card;
+	if (card == NULL)
+		return 0;
+
 	spa_pod_dynamic_builder_init(&b, buffer, sizeof(buffer), 4096);
 	spa_pod_builder_get_state(&b.b, &state);
 
-	card = this->card;
-
 	result.id = id;
 	result.next = start;
       next:
@@ -763,6 +788,9 @@ static int impl_set_param(void *object,
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
+	if (this->card == NULL)
+		return -EIO;
+
 	switch (id) {
 	case SPA_PARAM_Profile:
 	{
@@ -1067,9 +1095,164 @@ static SPA_PRINTF_FUNC(6,0) void impl_acp_log_func(void *data,
 	spa_log_logv(log, (enum spa_log_level)level, file, line, func, fmt, arg);
 }
 
+static void card_ready(struct impl *this)
+{
+	setup_sources(this);
+
+	acp_card_add_listener(this->card, &card_events, this);
+}
+
+static void free_probe_items(struct impl *this)
+{
+	uint32_t i;
+
+	for (i = 0; i < this->probe.n_items; i++) {
+		free((char*)this->probe.items[i].key);
+		free((char*)this->probe.items[i].value);
+	}
+	free(this->probe.items);
+	this->probe.items = NULL;
+	this->probe.n_items = 0;
+}
+
+static void *probe_thread(void *data)
+{
+	struct impl *this = data;
+
+	this->probe.card = acp_card_new(this->probe.index,
+			&ACP_DICT_INIT(this->probe.items, this->probe.n_items));
+	this->probe.res = this->probe.card ? 0 : (errno ? -errno : -EIO);
+
+	spa_loop_utils_signal_event(this->loop_utils, this->probe.done);
+	return NULL;
+}
+
+static void emit_probe_error(struct impl *this)
+{
+	struct spa_dict_item items[4];
+	uint32_t n_items = 0;
+
+	items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_DEVICE_API, "alsa:acp");
+	items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_MEDIA_CLASS, "Audio/Device");
+	items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_API_ALSA_PATH, this->props.device);
+	items[n_items++] = SPA_DICT_ITEM_INIT("api.acp.probe.error", spa_strerror(this->probe.res));
+
+	this->info.change_mask = SPA_DEVICE_CHANGE_MASK_PROPS;
+	this->info.props = &SPA_DICT_INIT(items, n_items);
+	spa_device_emit_info(&this->hooks, &this->info);
+	this->info.change_mask = 0;
+	this->info.props = NULL;
+
+	/* like a failed init, the device has no card and should be removed */
+	spa_device_emit_result(&this->hooks, 0, this->probe.res, 0, NULL);
+}
+
+static void on_probe_done(void *data, uint64_t count)
+{
+	struct impl *this = data;
+	struct acp_card *card;
+	struct acp_card_profile *profile;
+	uint32_t i;
+
+	if (!this->probe.running)
+		return;
+
+	pthread_join(this->probe.thread, NULL);
+	this->probe.running = false;
+	free_probe_items(this);
+
+	if ((card = this->probe.card) == NULL) {
+		spa_log_error(this->log, "probe card %s failed: %s",
+				this->props.device, spa_strerror(this->probe.res));
+		emit_probe_error(this);
+		return;
+	}
+	this->probe.card = NULL;
+	this->card = card;
+
+	/* the card was created in the probe thread, the main loop also
+	 * needs the ALSA error handler */
+	acp_set_thread_error_handler();
+
+	spa_log_info(this->log, "probed card %s", this->props.device);
+
+	card_ready(this);
+
+	this->params[IDX_EnumProfile].flags = SPA_PARAM_INFO_READ;
+	this->params[IDX_Profile].flags = SPA_PARAM_INFO_READWRITE;
+	this->params[IDX_EnumRoute].flags = SPA_PARAM_INFO_READ;
+	this->params[IDX_Route].flags = SPA_PARAM_INFO_READWRITE;
+	SPA_FOR_EACH_ELEMENT_VAR(this->params, p)
+		p->user++;
+	emit_info(this, true);
+
+	if (card->active_profile_index < card->n_profiles) {
+		profile = card->profiles[card->active_profile_index];
+		for (i = 0; i < profile->n_devices; i++)
+			emit_node(this, profile->devices[i]);
+	}
+}
+
+static int start_probe(struct impl *this, uint32_t index,
+		const struct acp_dict_item *items, uint32_t n_items)
+{
+	uint32_t i;
+	int res;
+
+	this->probe.items = calloc(n_items, sizeof(struct acp_dict_item));
+	if (n_items > 0 && this->probe.items == NULL)
+		return -errno;
+	for (i = 0; i < n_items; i++) {
+		this->probe.items[i].key = strdup(items[i].key);
+		this->probe.items[i].value = items[i].value ? strdup(items[i].value) : NULL;
+		this->probe.n_items++;
+		if (this->probe.items[i].key == NULL ||
+		    (items[i].value != NULL && this->probe.items[i].value == NULL)) {
+			res = -errno;
+			goto error;
+		}
+	}
+	this->probe.index = index;
+
+	this->probe.done = spa_loop_utils_add_event(this->loop_utils, on_probe_done, this);
+	if (this->probe.done == NULL) {
+		res = -errno;
+		goto error;
+	}
+	if ((res = -pthread_create(&this->probe.thread, NULL, probe_thread, this)) < 0)
+		goto error;
+	this->probe.running = true;
+
+	spa_log_debug(this->log, "probing card %s in thread", this->props.device);
+	return 0;
+
+error:
+	if (this->probe.done) {
+		spa_loop_utils_destroy_source(this->loop_utils, this->probe.done);
+		this->probe.done = NULL;
+	}
+	free_probe_items(this);
+	return res;
+}
+
 static int impl_clear(struct spa_handle *handle)
 {
 	struct impl *this = (struct impl *) handle;
+
+	if (this->probe.running) {
+		pthread_join(this->probe.thread, NULL);
+		this->probe.running = false;
+	}
+	if (this->probe.done) {
+		spa_loop_utils_destroy_source(this->loop_utils, this->probe.done);
+		this->probe.done = NULL;
+	}
+	if (this->probe.card) {
+		acp_card_destroy(this->probe.card);
+		this->probe.card = NULL;
+	}
+	free_probe_items(this);
+
 	remove_sources(this);
 	if (this->card) {
 		acp_card_destroy(this->card);
@@ -1097,6 +1280,7 @@ impl_init(const struct spa_handle_factory *factory,
 	struct acp_dict_item *items = NULL;
 	const struct spa_dict_item *it;
 	uint32_t n_items = 0;
+	bool probe_async = false;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -1110,6 +1294,7 @@ impl_init(const struct spa_handle_factory *factory,
 	alsa_log_topic_init(this->log);
 
 	this->loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Loop);
+	this->loop_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_LoopUtils);
 	acp_i18n = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_I18N);
 	if (this->loop == NULL) {
 		spa_log_error(this->log, "a Loop interface is needed");
@@ -1134,6 +1319,8 @@ impl_init(const struct spa_handle_factory *factory,
 			this->props.auto_port = spa_atob(str);
 		if ((str = spa_dict_lookup(info, "api.acp.auto-profile")) != NULL)
 			this->props.auto_profile = spa_atob(str);
+		if ((str = spa_dict_lookup(info, "api.acp.probe-async")) != NULL)
+			probe_async = spa_atob(str);
 
 		items = alloca((info->n_items) * sizeof(*items));
 		spa_dict_for_each(it, info)
@@ -1144,17 +1331,30 @@ impl_init(const struct spa_handle_factory *factory,
 	if ((str = strchr(this->props.device, ':')) == NULL)
 		return -EINVAL;
 
+	this->info = SPA_DEVICE_INFO_INIT();
+	this->info_all = SPA_DEVICE_CHANGE_MASK_PROPS |
+		SPA_DEVICE_CHANGE_MASK_PARAMS;
+
+	if (probe_async && this->loop_utils == NULL) {
+		spa_log_warn(this->log, "a LoopUtils interface is needed for async probing");
+		probe_async = false;
+	}
+	if (probe_async) {
+		this->params[IDX_EnumProfile] = SPA_PARAM_INFO(SPA_PARAM_EnumProfile, 0);
+		this->params[IDX_Profile] = SPA_PARAM_INFO(SPA_PARAM_Profile, 0);
+		this->params[IDX_EnumRoute] = SPA_PARAM_INFO(SPA_PARAM_EnumRoute, 0);
+		this->params[IDX_Route] = SPA_PARAM_INFO(SPA_PARAM_Route, 0);
+		this->info.params = this->params;
+		this->info.n_params = 4;
+
+		return start_probe(this, atoi(str+1), items, n_items);
+	}
+
 	this->card = acp_card_new(atoi(str+1), &ACP_DICT_INIT(items, n_items));
 	if (this->card == NULL)
 		return -errno;
 
-	setup_sources(this);
-
-	acp_card_add_listener(this->card, &card_events, this);
-
-	this->info = SPA_DEVICE_INFO_INIT();
-	this->info_all = SPA_DEVICE_CHANGE_MASK_PROPS |
-		SPA_DEVICE_CHANGE_MASK_PARAMS;
+	card_ready(this);
 
 	this->params[IDX_EnumProfile] = SPA_PARAM_INFO(SPA_PARAM_EnumProfile, SPA_PARAM_INFO_READ);
 	this->params[IDX_Profile] = SPA_PARAM_INFO(SPA_PARAM_Profile, SPA_PARAM_INFO_READWRITE);
@@ -144,6 +144,19 @@ static int alsa_set_param(struct state *state, const char *k, const char *s)
 	} else if (spa_streq(k, "clock.name")) {
 		spa_scnprintf(state->clock_name,
 				sizeof(state->clock_name), "%s", s);
+		state->clock_drifting = false;
+	} else if (spa_streq(k, "clock.max-drift")) {
+		uint32_t val;
+		if (spa_atou32(s, &val, 0) && val <= 1000000)
+			state->clock_max_drift = val;
+		else
+			spa_log_warn(state->log, "%s: invalid clock.max-drift '%s'",
+					state->name, s);
+	} else if (spa_streq(k, "api.alsa.batch-fraction")) {
+		spa_atof(s, &state->batch_fraction);
+		state->batch_fraction = SPA_CLAMP(state->batch_fraction, 0.0f, 1.0f);
+	} else if (spa_streq(k, "api.alsa.batch-min-quantum")) {
+		state->batch_min_quantum = atoi(s);
 	} else
 		return 0;
 
@@ -421,9 +434,33 @@ struct spa_pod *spa_alsa_enum_propinfo(struct state *state,
 			SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Int(state->htimestamp_max_errors, 0, INT32_MAX),
 			SPA_PROP_INFO_params, SPA_POD_Bool(true));
 		break;
+	case 19:
+		param = spa_pod_builder_add_object(b,
+			SPA_TYPE_OBJECT_PropInfo, SPA_PARAM_PropInfo,
+			SPA_PROP_INFO_name, SPA_POD_String("clock.max-drift"),
+			SPA_PROP_INFO_description, SPA_POD_String("Max drift in ppm from a driver with the same clock"),
+			SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Int(state->clock_max_drift, 0, 1000000),
+			SPA_PROP_INFO_params, SPA_POD_Bool(true));
+		break;
+	case 20:
+		param = spa_pod_builder_add_object(b,
+			SPA_TYPE_OBJECT_PropInfo, SPA_PARAM_PropInfo,
+			SPA_PROP_INFO_name, SPA_POD_String("api.alsa.batch-fraction"),
+			SPA_PROP_INFO_description, SPA_POD_String("Fraction of the buffer to fill per wakeup with large quantums"),
+			SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Float(state->batch_fraction, 0.0f, 1.0f),
+			SPA_PROP_INFO_params, SPA_POD_Bool(true));
+		break;
+	case 21:
+		param = spa_pod_builder_add_object(b,
+			SPA_TYPE_OBJECT_PropInfo, SPA_PARAM_PropInfo,
+			SPA_PROP_INFO_name, SPA_POD_String("api.alsa.batch-min-quantum"),
+			SPA_PROP_INFO_description, SPA_POD_String("Minimum quantum to fill more than one quantum per wakeup"),
+			SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Int(state->batch_min_quantum, 0, 65536),
+			SPA_PROP_INFO_params, SPA_POD_Bool(true));
+		break;
 	// While adding params here, update the math in default too
 	default:
-		idx -= 18;
+		idx -= 21;
 		if (idx <= state->num_bind_ctls)
 			param = enum_bind_ctl_propinfo(state, idx - 1, b);
 		else
@@ -573,6 +610,15 @@ int spa_alsa_add_prop_params(struct state *state, struct spa_pod_builder *b)
 	spa_pod_builder_string(b, "clock.name");
 	spa_pod_builder_string(b, state->clock_name);
 
+	spa_pod_builder_string(b, "clock.max-drift");
+	spa_pod_builder_int(b, state->clock_max_drift);
+
+	spa_pod_builder_string(b, "api.alsa.batch-fraction");
+	spa_pod_builder_float(b, state->batch_fraction);
+
+	spa_pod_builder_string(b, "api.alsa.batch-min-quantum");
+	spa_pod_builder_int(b, state->batch_min_quantum);
+
 	add_bind_ctl_params(state, b);
 
 	spa_pod_builder_pop(b, &f[0]);
@@ -614,6 +660,9 @@ int spa_alsa_parse_prop_params(struct state *state, struct spa_pod *params)
 			snprintf(value, sizeof(value), "%s",
 					SPA_POD_VALUE(struct spa_pod_bool, pod) ?
 					"true" : "false");
+		} else if (spa_pod_is_float(pod)) {
+			spa_dtoa(value, sizeof(value),
+					SPA_POD_VALUE(struct spa_pod_float, pod));
 		} else
 			continue;
 
@@ -661,6 +710,113 @@ static void fill_device_name(struct state *state, const char *params, char devic
 			state->props.device, params ? params : "");
 }
 
+/* The names are placed in a quoted string of the generated multi PCM
+ * config, don't allow anything that could end the string. */
+static bool aggregate_name_valid(const char *name)
+{
+	const char *p;
+
+	if (name[0] == '\0')
+		return false;
+	for (p = name; *p; p++) {
+		if ((unsigned char)*p < 0x20 || *p == 0x7f || *p == '"' || *p == '\\')
+			return false;
+	}
+	return true;
+}
+
+static int probe_aggregate_channels(struct state *state, const char *name,
+		unsigned int *channels)
+{
+	snd_pcm_t *hndl;
+	snd_pcm_hw_params_t *params;
+	int err;
+
+	if ((err = snd_pcm_open(&hndl, name, state->stream,
+			SND_PCM_NONBLOCK |
+			SND_PCM_NO_AUTO_RESAMPLE |
+			SND_PCM_NO_AUTO_CHANNELS |
+			SND_PCM_NO_AUTO_FORMAT)) < 0)
+		return err;
+
+	snd_pcm_hw_params_alloca(&params);
+	if ((err = snd_pcm_hw_params_any(hndl, params)) >= 0)
+		err = snd_pcm_hw_params_get_channels_max(params, channels);
+
+	snd_pcm_close(hndl);
+	return err;
+}
+
+/* Open all aggregate members as one ALSA multi PCM. All member areas are
+ * then handled with a single mmap_begin/commit and the node is woken up
+ * by a single timer. The members are started and stopped together but
+ * they are not resampled against each other, they need to share a clock.
+ * The total number of channels is limited to SPA_AUDIO_MAX_CHANNELS. */
+static int open_aggregate(struct state *state, snd_pcm_t **hndl, int mode)
+{
+	snd_config_t *top = NULL, *config = NULL;
+	snd_input_t *input = NULL;
+	unsigned int channels[MAX_AGGREGATE], total = 0;
+	char *str = NULL;
+	size_t size;
+	FILE *f;
+	uint32_t i, j;
+	int err;
+
+	for (i = 0; i < state->n_aggregate; i++) {
+		if ((err = probe_aggregate_channels(state, state->aggregate[i],
+						&channels[i])) < 0) {
+			spa_log_error(state->log, "%p: aggregate member '%s' failed: %s",
+					state, state->aggregate[i], snd_strerror(err));
+			return err;
+		}
+		if (total + channels[i] > SPA_AUDIO_MAX_CHANNELS) {
+			spa_log_error(state->log, "%p: aggregate has more than %u channels",
+					state, SPA_AUDIO_MAX_CHANNELS);
+			return -EINVAL;
+		}
+		total += channels[i];
+	}
+
+	if ((f = open_memstream(&str, &size)) == NULL)
+		return -errno;
+
+	fprintf(f, "pcm.spa_aggregate { type multi ");
+	for (i = 0; i < state->n_aggregate; i++)
+		fprintf(f, "slaves.s%u { pcm \"%s\" channels %u } ",
+				i, state->aggregate[i], channels[i]);
+	for (i = 0, total = 0; i < state->n_aggregate; i++) {
+		for (j = 0; j < channels[i]; j++, total++)
+			fprintf(f, "bindings.%u { slave s%u channel %u } ", total, i, j);
+	}
+	fprintf(f, "master 0 }");
+	fclose(f);
+
+	spa_log_info(state->log, "%p: aggregate of %u devices with %u channels",
+			state, state->n_aggregate, total);
+	spa_log_debug(state->log, "%p: aggregate config: %s", state, str);
+
+	if ((err = snd_config_update_ref(&top)) < 0)
+		goto exit;
+	if ((err = snd_config_copy(&config, top)) < 0)
+		goto exit;
+	if ((err = snd_input_buffer_open(&input, str, size)) < 0)
+		goto exit;
+	if ((err = snd_config_load(config, input)) < 0)
+		goto exit;
+
+	err = snd_pcm_open_lconf(hndl, "spa_aggregate", state->stream, mode, config);
+exit:
+	if (input)
+		snd_input_close(input);
+	if (config)
+		snd_config_delete(config);
+	if (top)
+		snd_config_unref(top);
+	free(str);
+	return err;
+}
+
 static void bind_ctl_event(struct spa_source *source)
 {
 	struct state *state = source->data;
@@ -895,6 +1051,8 @@ int spa_alsa_init(struct state *state, const struct spa_dict *info)
 	state->multi_rate = true;
 	state->htimestamp = false;
 	state->htimestamp_max_errors = MAX_HTIMESTAMP_ERROR;
+	state->clock_max_drift = DEFAULT_CLOCK_MAX_DRIFT;
+	state->batch_min_quantum = DEFAULT_BATCH_MIN_QUANTUM;
 	state->card_index = SPA_ID_INVALID;
 
 	for (i = 0; info && i < info->n_items; i++) {
@@ -929,6 +1087,34 @@ int spa_alsa_init(struct state *state, const struct spa_dict *info)
 			state->num_bind_ctls = i;
 
 			/* We'll do the actual binding after checking the card exists */
+		} else if (spa_streq(k, "api.alsa.aggregate")) {
+			struct spa_json it[2];
+			char v[64];
+			uint32_t n = 0;
+			int res = 0;
+
+			/* Read a list of PCMs that are opened together as one device */
+			spa_json_init(&it[0], s, strlen(s));
+			if (spa_json_enter_array(&it[0], &it[1]) <= 0)
+				spa_json_init(&it[1], s, strlen(s));
+
+			/* the channels of the members follow each other, a skipped
+			 * member would move all later channels, reject the list */
+			while ((res = spa_json_get_string(&it[1], v, sizeof(v))) > 0) {
+				if (n >= SPA_N_ELEMENTS(state->aggregate) ||
+				    !aggregate_name_valid(v)) {
+					res = -1;
+					break;
+				}
+				snprintf(state->aggregate[n], sizeof(state->aggregate[n]), "%s", v);
+				n++;
+			}
+			if (res < 0) {
+				spa_log_error(state->log, "%p: invalid api.alsa.aggregate '%s'",
+						state, s);
+				return -EINVAL;
+			}
+			state->n_aggregate = n;
 		} else {
 			alsa_set_param(state, k, s);
 		}
@@ -936,7 +1122,8 @@ int spa_alsa_init(struct state *state, const struct spa_dict *info)
 
 	if (state->card_index == SPA_ID_INVALID) {
 		/* If we don't have a card index, see if we have a *:<idx> string */
-		sscanf(state->props.device, "%*[^:]:%u", &state->card_index);
+		sscanf(state->n_aggregate > 0 ? state->aggregate[0] : state->props.device,
+				"%*[^:]:%u", &state->card_index);
 		if (state->card_index == SPA_ID_INVALID) {
 			spa_log_error(state->log, "Could not determine card index, maybe set %s",
 					SPA_KEY_API_ALSA_CARD);
@@ -1127,14 +1314,23 @@ int spa_alsa_open(struct state *state, const char *params)
 
 	spa_log_info(state->log, "%p: ALSA device open '%s' %s", state, device_name,
 			state->stream == SND_PCM_STREAM_CAPTURE ? "capture" : "playback");
-	CHECK(snd_pcm_open(&state->hndl,
+	if (state->n_aggregate > 0) {
+		CHECK(open_aggregate(state, &state->hndl,
+			   SND_PCM_NONBLOCK |
+			   SND_PCM_NO_AUTO_RESAMPLE |
+			   SND_PCM_NO_AUTO_CHANNELS | SND_PCM_NO_AUTO_FORMAT), "'%s': aggregate %s open failed",
+				device_name,
+				state->stream == SND_PCM_STREAM_CAPTURE ? "capture" : "playback");
+	} else {
+		CHECK(snd_pcm_open(&state->hndl,
 			   device_name,
 			   state->stream,
 			   SND_PCM_NONBLOCK |
 			   SND_PCM_NO_AUTO_RESAMPLE |
 			   SND_PCM_NO_AUTO_CHANNELS | SND_PCM_NO_AUTO_FORMAT), "'%s': %s open failed",
-			device_name,
-			state->stream == SND_PCM_STREAM_CAPTURE ? "capture" : "playback");
+				device_name,
+				state->stream == SND_PCM_STREAM_CAPTURE ? "capture" : "playback");
+	}
 
 	if (!state->disable_tsched) {
 		if ((err = spa_system_timerfd_create(state->data_system,
@@ -2496,6 +2692,7 @@ static int do_prepare(struct state *state)
 	state->alsa_sync = true;
 	state->alsa_sync_warning = false;
 	state->alsa_started = false;
+	spa_zero(state->batch);
 
 	return 0;
 }
@@ -2713,6 +2910,245 @@ static int get_status(struct state *state, uint64_t current_time, snd_pcm_uframe
 	return 0;
 }
 
+static void reset_drift_check(struct state *state)
+{
+	spa_zero(state->drift);
+}
+
+/* start a new measurement window, keeps the resync strikes */
+static void restart_drift_window(struct state *state)
+{
+	state->drift.base_time = 0;
+	state->drift.sum = 0.0;
+	state->drift.count = 0;
+	state->drift.strikes = 0;
+	state->drift.valid = false;
+}
+
+static void enable_drift_matching(struct state *state)
+{
+	state->clock_drifting = true;
+	state->drift_check = false;
+	state->matching = true;
+	state->resample = !state->pitch_elem &&
+		(((uint32_t)state->rate != state->driver_rate.denom) || state->matching);
+	recalc_headroom(state);
+	spa_dll_init(&state->dll);
+}
+
+/* A follower with the same clock.name as the driver runs without rate
+ * matching. Check that this is really the case by looking at how the
+ * average fill level error moves over time. With a shared clock it stays
+ * put, otherwise it drifts away at the rate difference between the
+ * clocks and we enable rate matching again. */
+static void check_drift(struct state *state, uint64_t current_time, double err)
+{
+	double avg, ppm;
+
+	if (fabs(err) > state->max_resync) {
+		/* Clocks that drift a lot are resynced before a window completes.
+		 * Resyncs in the same direction, without a good window in between,
+		 * are drift as well. */
+		int sign = err > 0 ? 1 : -1;
+
+		if (sign != state->drift.resync_sign) {
+			state->drift.resync_sign = sign;
+			state->drift.resync_strikes = 0;
+		}
+		if (++state->drift.resync_strikes >= CLOCK_DRIFT_STRIKES) {
+			spa_log_warn(state->log, "%s: clock '%s' needs repeated resyncs "
+					"with the driver, enabling rate matching",
+					state->name, state->clock_name);
+			enable_drift_matching(state);
+			return;
+		}
+		restart_drift_window(state);
+		return;
+	}
+	if (state->alsa_sync) {
+		/* quantum change or the resync of the previous cycle, the error
+		 * jumps so start a new window */
+		restart_drift_window(state);
+		return;
+	}
+	if (state->drift.base_time == 0)
+		state->drift.base_time = current_time;
+
+	state->drift.sum += err;
+	state->drift.count++;
+
+	if (current_time - state->drift.base_time < BW_PERIOD)
+		return;
+
+	avg = state->drift.sum / state->drift.count;
+	if (state->drift.valid) {
+		ppm = (avg - state->drift.last_avg) * 1e15 /
+			((double)(current_time - state->drift.last_time) * state->rate);
+
+		spa_log_debug(state->log, "%s: clock '%s' drift %f ppm",
+				state->name, state->clock_name, ppm);
+
+		if (fabs(ppm) > state->clock_max_drift) {
+			if (++state->drift.strikes >= CLOCK_DRIFT_STRIKES) {
+				spa_log_warn(state->log, "%s: clock '%s' drifts %f ppm from "
+						"the driver, enabling rate matching",
+						state->name, state->clock_name, ppm);
+				enable_drift_matching(state);
+				return;
+			}
+		} else {
+			state->drift.strikes = 0;
+			state->drift.resync_strikes = 0;
+		}
+	}
+	state->drift.last_avg = avg;
+	state->drift.last_time = current_time;
+	state->drift.valid = true;
+	state->drift.base_time = current_time;
+	state->drift.sum = 0.0;
+	state->drift.count = 0;
+}
+
+static uint64_t get_time_ns(struct state *state)
+{
+	struct timespec now;
+	if (spa_system_clock_gettime(state->data_system, CLOCK_MONOTONIC, &now) < 0)
+		return 0;
+	return SPA_TIMESPEC_TO_NSEC(&now);
+}
+
+static bool has_other_followers(struct state *state)
+{
+	struct state *follower;
+
+	spa_list_for_each(follower, &state->rt.followers, rt.driver_link) {
+		if (follower != state)
+			return true;
+	}
+	return false;
+}
+
+/* When driving with a large quantum, fill the buffer up to one quantum
+ * below the end and sleep until the fill level drops below the low
+ * watermark. The graph then runs back to back until the buffer is full
+ * again, which saves wakeups. A quantum below batch_min_quantum means a
+ * client wants low latency and we go back to one cycle per wakeup. */
+static bool check_batch(struct state *state, snd_pcm_uframes_t target)
+{
+	snd_pcm_uframes_t frames, low, high;
+
+	if (state->batch_fraction <= 0.0f || state->following || state->disable_tsched ||
+	    !state->alsa_started || state->stream != SND_PCM_STREAM_PLAYBACK ||
+	    state->driver_duration < state->batch_min_quantum ||
+	    state->buffer_frames <= state->threshold ||
+	    has_other_followers(state))
+		return false;
+
+	frames = (snd_pcm_uframes_t)(state->buffer_frames * state->batch_fraction);
+	high = state->buffer_frames - state->threshold;
+	low = high > frames ? high - frames : 0;
+	low = SPA_MAX(low, target);
+
+	/* not worth it when we can't do at least 2 cycles per wakeup */
+	if (high < low + 2 * state->threshold)
+		return false;
+
+	state->batch.low = low;
+	state->batch.high = high;
+	return true;
+}
+
+static void stop_batch(struct state *state, snd_pcm_uframes_t delay,
+		snd_pcm_uframes_t target)
+{
+	snd_pcm_sframes_t rewind;
+
+	spa_log_info(state->log, "%s: stop batching, delay:%lu target:%lu",
+			state->name, delay, target);
+
+	/* throw away what was queued ahead so that latency drops right away */
+	if (delay > target) {
+		rewind = SPA_MIN((snd_pcm_sframes_t)(delay - target),
+				snd_pcm_rewindable(state->hndl));
+		if (rewind > 0)
+			snd_pcm_rewind(state->hndl, rewind);
+	}
+	state->batch.active = false;
+	state->batch.filling = false;
+	spa_dll_init(&state->dll);
+}
+
+static int update_batch(struct state *state, uint64_t current_time,
+		snd_pcm_uframes_t delay, snd_pcm_uframes_t target)
+{
+	snd_pcm_uframes_t wait;
+
+	if (!check_batch(state, target)) {
+		if (SPA_LIKELY(!state->batch.active))
+			return 0;
+		/* the fill level changed, get the status again right away */
+		stop_batch(state, delay, target);
+		state->next_time = current_time;
+		return -EAGAIN;
+	}
+	if (SPA_UNLIKELY(!state->batch.active)) {
+		spa_log_info(state->log, "%s: start batching, low:%lu high:%lu thr:%u",
+				state->name, state->batch.low, state->batch.high,
+				state->threshold);
+		state->batch.active = true;
+		state->batch.filling = false;
+	}
+	if (state->batch.filling && delay + state->threshold > state->batch.high)
+		state->batch.filling = false;
+
+	if (!state->batch.filling) {
+		if (delay > state->batch.low + state->max_error) {
+			wait = SPA_MIN(delay - state->batch.low, (snd_pcm_uframes_t)state->rate / 2);
+			state->next_time = current_time + wait * SPA_NSEC_PER_SEC / state->rate;
+			return -EAGAIN;
+		}
+		state->batch.filling = true;
+	}
+
+	/* the next cycle is started from spa_alsa_write(), this is only a
+	 * fallback when the graph does not complete */
+	state->next_time = current_time + (uint64_t)(state->threshold * 1e9 / state->rate);
+
+	if (SPA_LIKELY(state->clock)) {
+		state->clock->nsec = current_time;
+		state->clock->rate = state->driver_rate;
+		state->clock->position += state->clock->duration;
+		state->clock->duration = state->driver_duration;
+		state->clock->delay = delay + state->delay;
+		state->clock->rate_diff = 1.0;
+		state->clock->next_nsec = state->next_time;
+	}
+	return 1;
+}
+
+static void continue_batch(struct state *state)
+{
+	uint64_t current_time = get_time_ns(state);
+	snd_pcm_uframes_t avail, delay, wait;
+
+	if (get_avail(state, current_time, &avail) < 0) {
+		state->batch.filling = false;
+		return;
+	}
+	delay = state->buffer_frames - SPA_MIN(avail, state->buffer_frames);
+
+	if (delay + state->threshold <= state->batch.high) {
+		/* room for more, run the next cycle right away */
+		state->next_time = current_time;
+	} else {
+		state->batch.filling = false;
+		wait = SPA_MIN(delay - SPA_MIN(delay, state->batch.low),
+				(snd_pcm_uframes_t)state->rate / 2);
+		state->next_time = current_time + wait * SPA_NSEC_PER_SEC / state->rate;
+	}
+	set_timeout(state, state->next_time);
+}
+
 static int update_time(struct state *state, uint64_t current_time, snd_pcm_sframes_t delay,
 		snd_pcm_sframes_t target, bool follower)
 {
@@ -2744,6 +3180,9 @@ static int update_time(struct state *state, uint64_t current_time, snd_pcm_sfram
 		state->alsa_sync = true;
 		state->alsa_sync_warning = false;
 	}
+	if (SPA_UNLIKELY(follower && state->drift_check))
+		check_drift(state, current_time, err);
+
 	if (err > state->max_resync) {
 		state->alsa_sync = true;
 		if (err > state->max_error)
@@ -2813,9 +3252,14 @@ static int setup_matching(struct state *state)
 	spa_log_debug(state->log, "driver clock:'%s' our clock:'%s'",
 			state->position->clock.name, state->clock_name);
 
-	if (spa_streq(state->position->clock.name, state->clock_name))
+	if (spa_streq(state->position->clock.name, state->clock_name) &&
+	    !state->clock_drifting)
 		state->matching = false;
 
+	state->drift_check = state->following && !state->matching &&
+		state->clock_max_drift > 0;
+	reset_drift_check(state);
+
 	state->resample = !state->pitch_elem &&
 		(((uint32_t)state->rate != state->driver_rate.denom) || state->matching);
 	recalc_headroom(state);
@@ -2896,6 +3340,10 @@ static int alsa_write_sync(struct state *state, uint64_t current_time)
 		return res;
 	}
 
+	if (SPA_UNLIKELY(state->batch_fraction > 0.0f || state->batch.active)) {
+		if ((res = update_batch(state, current_time, delay, target)) != 0)
+			return res < 0 ? res : 0;
+	}
 	if (SPA_UNLIKELY(!following && state->alsa_started && delay > target + state->max_error)) {
 		spa_log_trace(state->log, "%p: early wakeup %ld %lu %lu", state,
 				avail, delay, target);
@@ -3050,11 +3498,17 @@ again:
 
 int spa_alsa_write(struct state *state)
 {
+	int res;
+
 	if (state->following && state->rt.driver == NULL) {
 		uint64_t current_time = state->position->clock.nsec;
 		alsa_write_sync(state, current_time);
 	}
-	return alsa_write_frames(state);
+	res = alsa_write_frames(state);
+
+	if (SPA_UNLIKELY(state->batch.filling && !state->following))
+		continue_batch(state);
+	return res;
 }
 
 void spa_alsa_recycle_buffer(struct state *this, uint32_t buffer_id)
@@ -3352,14 +3806,6 @@ static int capture_ready(struct state *state)
 	return 0;
 }
 
-static uint64_t get_time_ns(struct state *state)
-{
-	struct timespec now;
-	if (spa_system_clock_gettime(state->data_system, CLOCK_MONOTONIC, &now) < 0)
-		return 0;
-	return SPA_TIMESPEC_TO_NSEC(&now);
-}
-
 static inline int alsa_do_wakeup_work(struct state *state, uint64_t current_time)
 {
 	struct state *follower;
@@ -3586,6 +4032,12 @@ int spa_alsa_start(struct state *state)
 	else if (!state->opened)
 		return -EIO;
 
+	if (state->clock_drifting) {
+		/* a new stream, check the shared clock again */
+		state->clock_drifting = false;
+		setup_matching(state);
+	}
+
 	spa_alsa_prepare(state);
 
 	if (!state->disable_tsched) {
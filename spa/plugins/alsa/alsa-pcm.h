@@ -36,6 +36,7 @@ extern "C" {
 
 
 #define MAX_RATES	16
+#define MAX_AGGREGATE	16
 
 #define DEFAULT_PERIOD		1024u
 #define DEFAULT_RATE		48000u
@@ -45,6 +46,10 @@ extern "C" {
 
 #define MAX_HTIMESTAMP_ERROR	64
 
+#define DEFAULT_CLOCK_MAX_DRIFT	20u	/* ppm */
+#define DEFAULT_BATCH_MIN_QUANTUM	2048u
+#define CLOCK_DRIFT_STRIKES	3u
+
 struct props {
 	char device[64];
 	char device_name[128];
@@ -153,6 +158,11 @@ struct state {
 	unsigned int disable_batch:1;
 	unsigned int disable_tsched:1;
 	char clock_name[64];
+	uint32_t clock_max_drift;
+	char aggregate[MAX_AGGREGATE][64];
+	uint32_t n_aggregate;
+	float batch_fraction;
+	uint32_t batch_min_quantum;
 	uint32_t quantum_limit;
 
 	snd_pcm_uframes_t buffer_frames;
@@ -229,6 +239,8 @@ struct state {
 	unsigned int linked:1;
 	unsigned int is_batch:1;
 	unsigned int force_rate:1;
+	unsigned int drift_check:1;
+	unsigned int clock_drifting:1;
 
 	uint64_t iec958_codecs;
 
@@ -244,6 +256,28 @@ struct state {
 	double max_error;
 	double max_resync;
 
+	/* verifies that a follower with our clock.name really runs
+	 * from the same clock as the driver */
+	struct {
+		uint64_t base_time;
+		uint64_t last_time;
+		double sum;
+		double last_avg;
+		uint32_t count;
+		uint32_t strikes;
+		bool valid;
+		/* direction and count of resyncs in the same direction */
+		int resync_sign;
+		uint32_t resync_strikes;
+	} drift;
+
+	struct {
+		snd_pcm_uframes_t low;
+		snd_pcm_uframes_t high;
+		unsigned int active:1;
+		unsigned int filling:1;
+	} batch;
+
 	struct spa_latency_info latency[2];
 	struct spa_process_latency_info process_latency;
 
@@ -2747,6 +2747,7 @@ static void handle_wav(struct impl *this, const void **src, uint32_t n_samples)
 		if (this->wav_file == NULL) {
 			struct wav_file_info info;
 
+			spa_zero(info);
 			info.info = this->dir[this->direction].format;
 
 			this->wav_file = wav_file_open(this->props.wav_path,
@@ -25,12 +25,18 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdlib.h>
 
 #include <spa/utils/string.h>
 
 #include "wavfile.h"
 
 #define BLOCK_SIZE	4096
+#define HEADER_SIZE	44
+
+/* alignment of the buffers, sizes and offsets of direct writes */
+#define DIRECT_ALIGN		4096
+#define DIRECT_BLOCK_SIZE	(1024 * 1024)
 
 struct wav_file {
 	struct spa_audio_info info;
@@ -41,11 +47,79 @@ struct wav_file {
 
 	uint32_t stride;
 	uint32_t blocks;
+
+	uint32_t flags;
+	uint32_t header_size;
+	void *header;
+
+	/* WAV_FILE_FLAG_DIRECT: data is collected in block and
+	 * written at offset when full */
+	void *block;
+	uint32_t block_size;
+	uint32_t block_fill;
+	off_t offset;
+
+	unsigned int o_direct:1;
+	unsigned int truncate:1;
 };
 
+static int flush_block(struct wav_file *wf, uint32_t size)
+{
+	ssize_t len;
+
+	len = pwrite(wf->fd, wf->block, size, wf->offset);
+	if (len < 0)
+		return -errno;
+	if (len != (ssize_t)size)
+		return -EIO;
+
+	if (!wf->o_direct) {
+		/* no O_DIRECT on this filesystem, write out and drop the
+		 * pages so that we don't fill the page cache */
+#ifdef __linux__
+		sync_file_range(wf->fd, wf->offset, size,
+				SYNC_FILE_RANGE_WAIT_BEFORE |
+				SYNC_FILE_RANGE_WRITE |
+				SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+#ifdef POSIX_FADV_DONTNEED
+		posix_fadvise(wf->fd, wf->offset, size, POSIX_FADV_DONTNEED);
+#endif
+	}
+	wf->offset += size;
+	return 0;
+}
+
+static ssize_t write_block(struct wav_file *wf, const void *data, size_t size)
+{
+	size_t done = 0;
+	uint32_t n;
+	int res;
+
+	while (done < size) {
+		n = SPA_MIN(size - done, wf->block_size - wf->block_fill);
+		memcpy(SPA_PTROFF(wf->block, wf->block_fill, void),
+				SPA_PTROFF(data, done, void), n);
+		wf->block_fill += n;
+		wf->length += n;
+		done += n;
+
+		if (wf->block_fill == wf->block_size) {
+			if ((res = flush_block(wf, wf->block_size)) < 0)
+				return res;
+			wf->block_fill = 0;
+		}
+	}
+	return done;
+}
+
 static inline ssize_t write_data(struct wav_file *wf, const void *data, size_t size)
 {
 	ssize_t len;
+
+	if (wf->flags & WAV_FILE_FLAG_DIRECT)
+		return write_block(wf, data, size);
+
 	len = write(wf->fd, data, size);
 	if (len > 0)
 		wf->length += len;
@@ -93,16 +167,23 @@ static inline int write_n(int fd, const void *buf, int count)
 	return write(fd, buf, count) == (ssize_t)count ? count : -errno;
 }
 
-static inline int write_le16(int fd, uint16_t val)
+static inline uint8_t *put_str(uint8_t *p, const char *str)
 {
-	uint8_t buf[2] = { val, val >> 8 };
-	return write_n(fd, buf, 2);
+	memcpy(p, str, 4);
+	return p + 4;
 }
 
-static inline int write_le32(int fd, uint32_t val)
+static inline uint8_t *put_le16(uint8_t *p, uint16_t val)
 {
-	uint8_t buf[4] = { val, val >> 8, val >> 16, val >> 24 };
-	return write_n(fd, buf, 4);
+	*p++ = val;
+	*p++ = val >> 8;
+	return p;
+}
+
+static inline uint8_t *put_le32(uint8_t *p, uint32_t val)
+{
+	p = put_le16(p, val);
+	return put_le16(p, val >> 16);
 }
 
 #define MAKE_AUDIO_RAW(format,bits,planar,fmt,...) \
@@ -133,36 +214,41 @@ static struct format_info {
 	MAKE_AUDIO_RAW(SPA_AUDIO_FORMAT_F64_LE,		32, false, 3, writei),
 };
 
-#define CHECK_RES(expr) if ((res = (expr)) < 0) return res
-
 static int write_headers(struct wav_file *wf)
 {
-	int res;
 	uint32_t channels, rate, bps, bits;
 	const struct format_info *fi = wf->fi;
-
-	lseek(wf->fd, 0, SEEK_SET);
+	uint8_t *p = wf->header;
 
 	rate = wf->info.info.raw.rate;
 	channels = wf->info.info.raw.channels;
 	bits = fi->bits;
 	bps = channels * bits / 8;
 
-	CHECK_RES(write_n(wf->fd, "RIFF", 4));
-	CHECK_RES(write_le32(wf->fd, wf->length == 0 ? (uint32_t)-1 : wf->length + 12 + 8 + 16));
-	CHECK_RES(write_n(wf->fd, "WAVE", 4));
-	CHECK_RES(write_n(wf->fd, "fmt ", 4));
-	CHECK_RES(write_le32(wf->fd, 16));
-	CHECK_RES(write_le16(wf->fd, fi->fmt));			/* format */
-	CHECK_RES(write_le16(wf->fd, channels));		/* channels */
-	CHECK_RES(write_le32(wf->fd, rate));			/* rate */
-	CHECK_RES(write_le32(wf->fd, bps * rate));		/* bytes per sec */
-	CHECK_RES(write_le16(wf->fd, bps));			/* bytes per samples */
-	CHECK_RES(write_le16(wf->fd, bits));			/* bits per sample */
-	CHECK_RES(write_n(wf->fd, "data", 4));
-	CHECK_RES(write_le32(wf->fd, wf->length == 0 ? (uint32_t)-1 : wf->length));
+	p = put_str(p, "RIFF");
+	p = put_le32(p, wf->length == 0 ? (uint32_t)-1 : wf->length + wf->header_size - 8);
+	p = put_str(p, "WAVE");
+	p = put_str(p, "fmt ");
+	p = put_le32(p, 16);
+	p = put_le16(p, fi->fmt);			/* format */
+	p = put_le16(p, channels);			/* channels */
+	p = put_le32(p, rate);				/* rate */
+	p = put_le32(p, bps * rate);			/* bytes per sec */
+	p = put_le16(p, bps);				/* bytes per samples */
+	p = put_le16(p, bits);				/* bits per sample */
+	if (wf->header_size > HEADER_SIZE) {
+		/* pad with a JUNK chunk so that the data is aligned */
+		uint32_t junk = wf->header_size - HEADER_SIZE - 8;
+		p = put_str(p, "JUNK");
+		p = put_le32(p, junk);
+		memset(p, 0, junk);
+		p += junk;
+	}
+	p = put_str(p, "data");
+	p = put_le32(p, wf->length == 0 ? (uint32_t)-1 : wf->length);
 
-	return 0;
+	lseek(wf->fd, 0, SEEK_SET);
+	return write_n(wf->fd, wf->header, wf->header_size);
 }
 
 static const struct format_info *find_info(struct wav_file_info *info)
@@ -182,17 +268,47 @@ static const struct format_info *find_info(struct wav_file_info *info)
 
 static int open_write(struct wav_file *wf, const char *filename, struct wav_file_info *info)
 {
-	int res;
+	int res, flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_TRUNC;
 	const struct format_info *fi;
 
 	fi = find_info(info);
 	if (fi == NULL)
 		return -ENOTSUP;
 
-	if ((wf->fd = open(filename, O_WRONLY | O_CREAT | O_CLOEXEC | O_TRUNC, 0660)) < 0) {
+	wf->flags = info->flags;
+	if (wf->flags & WAV_FILE_FLAG_DIRECT) {
+		wf->header_size = DIRECT_ALIGN;
+		wf->block_size = info->block_size ?
+			SPA_ROUND_UP_N(info->block_size, DIRECT_ALIGN) : DIRECT_BLOCK_SIZE;
+		wf->offset = wf->header_size;
+		if (posix_memalign(&wf->header, DIRECT_ALIGN, wf->header_size) != 0 ||
+		    posix_memalign(&wf->block, DIRECT_ALIGN, wf->block_size) != 0)
+			return -ENOMEM;
+
+		/* not all filesystems can do O_DIRECT, we then still do
+		 * large writes but drop the pages after writing */
+#ifdef O_DIRECT
+		if ((wf->fd = open(filename, flags | O_DIRECT, 0660)) >= 0)
+			wf->o_direct = true;
+		else if (errno != EINVAL)
+			return -errno;
+#endif
+		wf->truncate = true;
+	} else {
+		wf->header_size = HEADER_SIZE;
+		if ((wf->header = malloc(wf->header_size)) == NULL)
+			return -errno;
+	}
+	if (wf->fd < 0 && (wf->fd = open(filename, flags, 0660)) < 0) {
 		res = -errno;
 		goto exit;
 	}
+#ifdef __linux__
+	if (info->preallocate > 0 &&
+	    fallocate(wf->fd, 0, 0, info->preallocate) == 0)
+		wf->truncate = true;
+#endif
+
 	wf->info = info->info;
 	wf->fi = fi;
 	if (fi->planar) {
@@ -217,6 +333,7 @@ wav_file_open(const char *filename, const char *mode, struct wav_file_info *info
 	wf = calloc(1, sizeof(struct wav_file));
 	if (wf == NULL)
 		return NULL;
+	wf->fd = -1;
 
 	if (spa_streq(mode, "w")) {
 		if ((res = open_write(wf, filename, info)) < 0)
@@ -228,6 +345,10 @@ wav_file_open(const char *filename, const char *mode, struct wav_file_info *info
 	return wf;
 
 exit_free:
+	if (wf->fd >= 0)
+		close(wf->fd);
+	free(wf->header);
+	free(wf->block);
 	free(wf);
 	errno = -res;
 	return NULL;
@@ -235,13 +356,26 @@ exit_free:
 
 int wav_file_close(struct wav_file *wf)
 {
-	int res;
-
-	CHECK_RES(write_headers(wf));
+	int res = 0, r;
+
+	if (wf->block_fill > 0) {
+		/* direct writes need to be aligned, pad the last block
+		 * and truncate the file below */
+		uint32_t size = SPA_ROUND_UP_N(wf->block_fill, DIRECT_ALIGN);
+		memset(SPA_PTROFF(wf->block, wf->block_fill, void), 0, size - wf->block_fill);
+		res = flush_block(wf, size);
+	}
+	if (wf->truncate &&
+	    ftruncate(wf->fd, (off_t)wf->header_size + wf->length) < 0 && res == 0)
+		res = -errno;
+	if ((r = write_headers(wf)) < 0 && res == 0)
+		res = r;
 
 	close(wf->fd);
+	free(wf->header);
+	free(wf->block);
 	free(wf);
-	return 0;
+	return res;
 }
 
 ssize_t wav_file_write(struct wav_file *wf, const void **data, size_t samples)
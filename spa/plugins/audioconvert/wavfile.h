@@ -29,6 +29,11 @@ struct wav_file;
 
 struct wav_file_info {
 	struct spa_audio_info info;
+#define WAV_FILE_FLAG_DIRECT	(1<<0)	/**< batch writes into aligned blocks and
+					  *  bypass the page cache */
+	uint32_t flags;
+	uint32_t block_size;		/**< size of the direct writes, 0 for default */
+	uint64_t preallocate;		/**< bytes to allocate when opening, 0 for none, Linux only */
 };
 
 struct wav_file *
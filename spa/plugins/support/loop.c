@@ -33,6 +33,7 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.loop");
 
 #define MAX_ALIGN	8
 #define ITEM_ALIGN	8
+#define CACHE_LINE	64
 #define DATAS_SIZE	(4096*8)
 #define MAX_EP		32
 
@@ -74,10 +75,15 @@ struct impl {
 
 	tss_t queue_tss_id;
 	pthread_mutex_t queue_lock;
-	uint32_t count;
 	uint32_t flush_count;
 
 	unsigned int polling:1;
+
+	/* written by all invoking threads, keep away from the fields above */
+	uint8_t pad[CACHE_LINE];
+	uint32_t count;
+	uint32_t wakeup_pending;	/* the wakeup event was signaled and the
+					 * queues were not flushed yet */
 };
 
 struct queue {
@@ -92,9 +98,13 @@ struct queue {
 	int ack_fd;
 	struct spa_ratelimit rate_limit;
 
+	/* the indexes are shared between the invoking thread and the loop,
+	 * give them their own cache line */
+	uint8_t pad1[CACHE_LINE];
 	struct spa_ringbuffer buffer;
+	uint8_t pad2[CACHE_LINE - sizeof(struct spa_ringbuffer)];
 	uint8_t *buffer_data;
-	uint8_t buffer_mem[DATAS_SIZE + MAX_ALIGN];
+	uint8_t buffer_mem[DATAS_SIZE + CACHE_LINE];
 };
 
 struct source_impl {
@@ -191,7 +201,7 @@ static struct queue *loop_create_queue(void *object, uint32_t flags)
 	queue->rate_limit.interval = 2 * SPA_NSEC_PER_SEC;
 	queue->rate_limit.burst = 1;
 
-	queue->buffer_data = SPA_PTR_ALIGN(queue->buffer_mem, MAX_ALIGN, uint8_t);
+	queue->buffer_data = SPA_PTR_ALIGN(queue->buffer_mem, CACHE_LINE, uint8_t);
 	spa_ringbuffer_init(&queue->buffer);
 
 	if (flags & QUEUE_FLAG_ACK_FD) {
@@ -360,7 +370,10 @@ retry:
 		flush_all_queues(impl);
 		res = item->res;
 	} else {
-		loop_signal_event(impl, impl->wakeup);
+		/* batch the wakeups, when the loop was already signaled and did not
+		 * flush the queues yet, it will also see this item */
+		if (SPA_ATOMIC_XCHG(impl->wakeup_pending, 1) == 0)
+			loop_signal_event(impl, impl->wakeup);
 
 		if (block && queue->ack_fd != -1) {
 			uint64_t count = 1;
@@ -403,6 +416,9 @@ xrun:
 static void wakeup_func(void *data, uint64_t count)
 {
 	struct impl *impl = data;
+	/* clear before the flush so that items added after the flush
+	 * started signal the loop again */
+	SPA_ATOMIC_STORE(impl->wakeup_pending, 0);
 	flush_all_queues(impl);
 }
 
@@ -584,6 +584,8 @@ static int impl_node_port_enum_params(void *object, int seq,
 		if (port->max_buffers == 0)
 			return -EIO;
 
+		/* no dataType, consumers that can handle DmaBuf ask for it
+		 * in their Buffers param and then get the exported buffers */
 		param = spa_pod_builder_add_object(&b.b,
 			SPA_TYPE_OBJECT_ParamBuffers, id,
 			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(SPA_MIN(4u, port->max_buffers),
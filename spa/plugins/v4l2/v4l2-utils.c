@@ -1551,6 +1551,8 @@ static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers,
 		}
 		/* some drivers (v4l2loopback) don't support USERPTR
 		 * and so we need to try again with MMAP and memcpy */
+		spa_log_warn(this->log, "'%s' USERPTR not supported, frames will be copied",
+				this->props.device);
 		port->memtype = V4L2_MEMORY_MMAP;
 		spa_zero(reqbuf);
 		reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -1747,9 +1749,24 @@ again:
 				d[0].type = SPA_DATA_MemFd;
 			d[0].flags = SPA_DATA_FLAG_READABLE | SPA_DATA_FLAG_MAPPABLE;
 			d[0].fd = expbuf.fd;
-			d[0].data = NULL;
 			SPA_FLAG_SET(b->flags, BUFFER_FLAG_ALLOCATED);
-			spa_log_debug(this->log, "EXPBUF fd:%d", expbuf.fd);
+			/* also map the driver memory so that consumers in this process
+			 * can read the frames without importing the fd. The driver
+			 * takes care of the cache maintenance on DQBUF. */
+			d[0].data = mmap(NULL,
+					b->v4l2_buffer.length,
+					PROT_READ, MAP_SHARED,
+					dev->fd,
+					b->v4l2_buffer.m.offset);
+			if (d[0].data == MAP_FAILED) {
+				spa_log_debug(this->log, "'%s' mmap: %m", this->props.device);
+				d[0].data = NULL;
+			} else {
+				b->ptr = d[0].data;
+				SPA_FLAG_SET(b->flags, BUFFER_FLAG_MAPPED);
+			}
+			spa_log_debug(this->log, "EXPBUF fd:%d type:%d data:%p",
+					expbuf.fd, d[0].type, d[0].data);
 			use_expbuf = true;
 		} else if (d[0].type & (1u << SPA_DATA_MemPtr)) {
 			d[0].type = SPA_DATA_MemPtr;
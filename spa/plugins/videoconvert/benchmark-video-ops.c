@@ -0,0 +1,196 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "test-helper.h"
+#include "video-ops.h"
+
+static uint32_t cpu_flags;
+
+struct stats {
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_WIDTH	1920
+#define MAX_HEIGHT	1080
+
+#define MAX_COUNT 20
+
+static uint8_t frame_in[MAX_WIDTH * MAX_HEIGHT * 4];
+static uint8_t frame_out[MAX_WIDTH * MAX_HEIGHT * 4];
+
+static const uint32_t frame_sizes[][2] = {
+	{ 320, 240 },
+	{ 640, 480 },
+	{ 1280, 720 },
+	{ 1920, 1080 },
+};
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(frame_sizes) * 40
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void init_frame(struct video_frame *f, uint32_t format, uint32_t width,
+		uint32_t height, void *data)
+{
+	uint32_t i, offsets[VIDEO_MAX_PLANES];
+
+	spa_assert_se(video_format_layout(format, width, height, 0, f->stride, offsets) > 0);
+	f->width = width;
+	f->height = height;
+	for (i = 0; i < VIDEO_MAX_PLANES; i++)
+		f->data[i] = SPA_PTROFF(data, offsets[i], void);
+}
+
+static void run_test1(const char *name, const char *impl, uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t sw, uint32_t sh, uint32_t dw, uint32_t dh, uint32_t method, uint32_t flags)
+{
+	int i;
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct video_convert conv;
+	struct video_frame src, dst;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = sw;
+	conv.src_height = sh;
+	conv.dst_width = dw;
+	conv.dst_height = dh;
+	conv.scale_method = method;
+	conv.cpu_flags = flags;
+	spa_assert_se(video_convert_init(&conv) == 0);
+
+	init_frame(&src, src_fmt, sw, sh, frame_in);
+	init_frame(&dst, dst_fmt, dw, dh, frame_out);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		video_convert_process(&conv, &dst, &src);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	video_convert_free(&conv);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.src_width = sw,
+		.src_height = sh,
+		.dst_width = dw,
+		.dst_height = dh,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, uint32_t src_fmt, uint32_t dst_fmt)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(frame_sizes, s) {
+		run_test1(name, "c", src_fmt, dst_fmt,
+				(*s)[0], (*s)[1], (*s)[0], (*s)[1], 0, 0);
+#if defined (HAVE_SSE2)
+		if (cpu_flags & SPA_CPU_FLAG_SSE2)
+			run_test1(name, "sse2", src_fmt, dst_fmt,
+					(*s)[0], (*s)[1], (*s)[0], (*s)[1], 0, SPA_CPU_FLAG_SSE2);
+#endif
+	}
+}
+
+static void run_test_scale(const char *name, uint32_t method, uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t sw, uint32_t sh)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(frame_sizes, s) {
+		run_test1(name, "c", src_fmt, dst_fmt, sw, sh, (*s)[0], (*s)[1], method, 0);
+#if defined (HAVE_SSE2)
+		if (cpu_flags & SPA_CPU_FLAG_SSE2)
+			run_test1(name, "sse2", src_fmt, dst_fmt, sw, sh,
+					(*s)[0], (*s)[1], method, SPA_CPU_FLAG_SSE2);
+#endif
+	}
+}
+
+static void test_yuv(void)
+{
+	run_test("test_yuy2_i420", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420);
+	run_test("test_uyvy_i420", SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420);
+	run_test("test_yuy2_nv12", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12);
+	run_test("test_nv12_i420", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_I420);
+	run_test("test_i420_nv12", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12);
+	run_test("test_i420_yuy2", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_YUY2);
+}
+
+static void test_rgb(void)
+{
+	run_test("test_yuy2_rgba", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_RGBA);
+	run_test("test_nv12_bgrx", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx);
+	run_test("test_i420_rgba", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBA);
+	run_test("test_bgrx_i420", SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_I420);
+	run_test("test_rgba_nv12", SPA_VIDEO_FORMAT_RGBA, SPA_VIDEO_FORMAT_NV12);
+}
+
+static void test_scale(void)
+{
+	run_test_scale("test_scale_bilinear_i420", VIDEO_SCALE_METHOD_BILINEAR,
+			SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_I420, 1280, 720);
+	run_test_scale("test_scale_area_i420", VIDEO_SCALE_METHOD_AREA,
+			SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_I420, 1280, 720);
+	run_test_scale("test_scale_bilinear_yuy2_rgba", VIDEO_SCALE_METHOD_BILINEAR,
+			SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_RGBA, 1280, 720);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->dst_width - b->dst_width) != 0) return diff;
+	if ((diff = a->dst_height - b->dst_height) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	test_yuv();
+	test_rgb();
+	test_scale();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t %dx%d -> %dx%d\n",
+				s->perf, s->name, s->impl,
+				s->src_width, s->src_height, s->dst_width, s->dst_height);
+	}
+	return 0;
+}
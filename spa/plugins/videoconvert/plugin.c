@@ -8,6 +8,7 @@
 #include <spa/support/log.h>
 
 extern const struct spa_handle_factory spa_videoadapter_factory;
+extern const struct spa_handle_factory spa_videoconvert_factory;
 
 SPA_LOG_TOPIC_ENUM_DEFINE_REGISTERED;
 
@@ -21,6 +22,9 @@ int spa_handle_factory_enum(const struct spa_handle_factory **factory, uint32_t
 	case 0:
 		*factory = &spa_videoadapter_factory;
 		break;
+	case 1:
+		*factory = &spa_videoconvert_factory;
+		break;
 	default:
 		return 0;
 	}
@@ -0,0 +1,254 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <spa/debug/mem.h>
+
+#include "test-helper.h"
+#include "video-ops.h"
+
+#define WIDTH	67
+#define HEIGHT	9
+#define MAX_SIZE	(128 * 16 * 4)
+
+static uint32_t cpu_flags;
+
+static uint8_t frame_in[MAX_SIZE];
+static uint8_t frame_out[MAX_SIZE];
+static uint8_t frame_ref[MAX_SIZE];
+
+static void compare_mem(const char *name, const void *m1, const void *m2, size_t size)
+{
+	int res = memcmp(m1, m2, size);
+	if (res != 0) {
+		fprintf(stderr, "%s %zd:\n", name, size);
+		spa_debug_mem(0, m1, size);
+		spa_debug_mem(0, m2, size);
+	}
+	spa_assert_se(res == 0);
+}
+
+static void init_frame(struct video_frame *f, uint32_t format, uint32_t width,
+		uint32_t height, void *data)
+{
+	uint32_t i, offsets[VIDEO_MAX_PLANES];
+
+	spa_assert_se(video_format_layout(format, width, height, 0, f->stride, offsets) > 0);
+	f->width = width;
+	f->height = height;
+	for (i = 0; i < VIDEO_MAX_PLANES; i++)
+		f->data[i] = SPA_PTROFF(data, offsets[i], void);
+}
+
+static void fill_random(void *data, size_t size)
+{
+	uint8_t *d = data;
+	size_t i;
+	for (i = 0; i < size; i++)
+		d[i] = random();
+}
+
+static void fill_rgba(struct video_frame *f, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+	uint32_t x, y;
+	for (y = 0; y < f->height; y++) {
+		uint8_t *d = VIDEO_ROW(f, 0, y, uint8_t);
+		for (x = 0; x < f->width; x++) {
+			d[x * 4 + 0] = r;
+			d[x * 4 + 1] = g;
+			d[x * 4 + 2] = b;
+			d[x * 4 + 3] = a;
+		}
+	}
+}
+
+static void check_rgba(struct video_frame *f, uint8_t r, uint8_t g, uint8_t b, int tolerance)
+{
+	uint32_t x, y;
+	for (y = 0; y < f->height; y++) {
+		uint8_t *d = VIDEO_ROW(f, 0, y, uint8_t);
+		for (x = 0; x < f->width; x++) {
+			spa_assert_se(abs(d[x * 4 + 0] - r) <= tolerance);
+			spa_assert_se(abs(d[x * 4 + 1] - g) <= tolerance);
+			spa_assert_se(abs(d[x * 4 + 2] - b) <= tolerance);
+		}
+	}
+}
+
+static void run_convert(uint32_t src_fmt, uint32_t sw, uint32_t sh, void *src_data,
+		uint32_t dst_fmt, uint32_t dw, uint32_t dh, void *dst_data,
+		uint32_t method, uint32_t flags)
+{
+	struct video_convert conv;
+	struct video_frame src, dst;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = sw;
+	conv.src_height = sh;
+	conv.dst_width = dw;
+	conv.dst_height = dh;
+	conv.scale_method = method;
+	conv.cpu_flags = flags;
+	spa_assert_se(video_convert_init(&conv) == 0);
+
+	init_frame(&src, src_fmt, sw, sh, src_data);
+	init_frame(&dst, dst_fmt, dw, dh, dst_data);
+	video_convert_process(&conv, &dst, &src);
+	video_convert_free(&conv);
+}
+
+static void test_rgb_yuv(void)
+{
+	static const struct {
+		uint8_t yuv[3];
+		uint8_t rgb[3];
+	} colors[] = {
+		{ {  16, 128, 128 }, {   0,   0,   0 } },
+		{ { 235, 128, 128 }, { 255, 255, 255 } },
+		{ {  81,  90, 240 }, { 255,   0,   0 } },
+		{ { 145,  54,  34 }, {   0, 255,   0 } },
+		{ {  41, 240, 110 }, {   0,   0, 255 } },
+	};
+	struct video_frame f, o;
+	uint32_t i;
+
+	SPA_FOR_EACH_ELEMENT_VAR(colors, c) {
+		init_frame(&f, SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, frame_in);
+		fill_rgba(&f, c->rgb[0], c->rgb[1], c->rgb[2], 0xff);
+
+		run_convert(SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, frame_in,
+				SPA_VIDEO_FORMAT_I420, WIDTH, HEIGHT, frame_out, 0, cpu_flags);
+		init_frame(&o, SPA_VIDEO_FORMAT_I420, WIDTH, HEIGHT, frame_out);
+		for (i = 0; i < WIDTH; i++) {
+			spa_assert_se(abs(VIDEO_ROW(&o, 0, 0, uint8_t)[i] - c->yuv[0]) <= 1);
+			spa_assert_se(abs(VIDEO_ROW(&o, 1, 0, uint8_t)[i / 2] - c->yuv[1]) <= 1);
+			spa_assert_se(abs(VIDEO_ROW(&o, 2, 0, uint8_t)[i / 2] - c->yuv[2]) <= 1);
+		}
+
+		run_convert(SPA_VIDEO_FORMAT_I420, WIDTH, HEIGHT, frame_out,
+				SPA_VIDEO_FORMAT_BGRx, WIDTH, HEIGHT, frame_ref, 0, cpu_flags);
+		run_convert(SPA_VIDEO_FORMAT_BGRx, WIDTH, HEIGHT, frame_ref,
+				SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, frame_in, 0, cpu_flags);
+		check_rgba(&f, c->rgb[0], c->rgb[1], c->rgb[2], 3);
+	}
+}
+
+static void test_scale(void)
+{
+	static const uint32_t sizes[][2] = {
+		{ 1, 1 }, { 13, 3 }, { 33, 9 }, { 67, 9 }, { 128, 16 },
+	};
+	struct video_frame f, o;
+	uint32_t i, j, m;
+
+	init_frame(&f, SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, frame_in);
+	fill_rgba(&f, 10, 100, 200, 0xff);
+
+	for (m = 0; m < 2; m++) {
+		for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+			run_convert(SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, frame_in,
+					SPA_VIDEO_FORMAT_RGBA, sizes[i][0], sizes[i][1], frame_out,
+					m, cpu_flags);
+			init_frame(&o, SPA_VIDEO_FORMAT_RGBA, sizes[i][0], sizes[i][1], frame_out);
+			check_rgba(&o, 10, 100, 200, 0);
+		}
+	}
+	/* a horizontal ramp stays monotonic */
+	for (j = 0; j < HEIGHT; j++)
+		for (i = 0; i < WIDTH; i++)
+			memset(VIDEO_ROW(&f, 0, j, uint8_t) + i * 4, i * 3, 4);
+	run_convert(SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, frame_in,
+			SPA_VIDEO_FORMAT_RGBA, 128, 4, frame_out, 0, cpu_flags);
+	init_frame(&o, SPA_VIDEO_FORMAT_RGBA, 128, 4, frame_out);
+	for (i = 1; i < 128; i++)
+		spa_assert_se(VIDEO_ROW(&o, 0, 2, uint8_t)[i * 4] >= VIDEO_ROW(&o, 0, 2, uint8_t)[(i - 1) * 4]);
+}
+
+static void run_simd(const char *name, uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t sw, uint32_t sh, uint32_t dw, uint32_t dh)
+{
+	fill_random(frame_in, sizeof(frame_in));
+	memset(frame_out, 0, sizeof(frame_out));
+	memset(frame_ref, 0, sizeof(frame_ref));
+
+	run_convert(src_fmt, sw, sh, frame_in, dst_fmt, dw, dh, frame_ref, 0, 0);
+	run_convert(src_fmt, sw, sh, frame_in, dst_fmt, dw, dh, frame_out, 0, cpu_flags);
+	compare_mem(name, frame_out, frame_ref, sizeof(frame_out));
+}
+
+static void test_simd(void)
+{
+	if (cpu_flags == 0)
+		return;
+
+	run_simd("yuy2_to_i420", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420,
+			WIDTH, HEIGHT, WIDTH, HEIGHT);
+	run_simd("uyvy_to_i420", SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420,
+			WIDTH, HEIGHT, WIDTH, HEIGHT);
+	run_simd("nv12_to_i420", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_I420,
+			WIDTH, HEIGHT, WIDTH, HEIGHT);
+	run_simd("i420_to_nv12", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12,
+			WIDTH, HEIGHT, WIDTH, HEIGHT);
+	run_simd("yuy2_to_rgba", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_RGBA,
+			WIDTH, HEIGHT, WIDTH, HEIGHT);
+	run_simd("bgrx_to_nv12", SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_NV12,
+			WIDTH, HEIGHT, WIDTH, HEIGHT);
+	run_simd("i420_scale", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBA,
+			WIDTH, HEIGHT, 41, 7);
+	run_simd("rgba_scale", SPA_VIDEO_FORMAT_RGBA, SPA_VIDEO_FORMAT_I420,
+			33, 5, WIDTH, HEIGHT);
+}
+
+static void test_direct(void)
+{
+	/* the direct conversions must produce the same result as the generic
+	 * unpack and pack functions. With a single line there is no vertical
+	 * chroma averaging and going through YV12 is lossless. */
+	static const uint32_t formats[][2] = {
+		{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420 },
+		{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420 },
+		{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12 },
+		{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_I420 },
+		{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12 },
+		{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_YUY2 },
+	};
+	static uint8_t temp[MAX_SIZE];
+	uint32_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		fill_random(frame_in, sizeof(frame_in));
+		memset(frame_out, 0, sizeof(frame_out));
+		memset(frame_ref, 0, sizeof(frame_ref));
+
+		run_convert(formats[i][0], WIDTH, 1, frame_in,
+				formats[i][1], WIDTH, 1, frame_out, 0, cpu_flags);
+		run_convert(formats[i][0], WIDTH, 1, frame_in,
+				SPA_VIDEO_FORMAT_YV12, WIDTH, 1, temp, 0, 0);
+		run_convert(SPA_VIDEO_FORMAT_YV12, WIDTH, 1, temp,
+				formats[i][1], WIDTH, 1, frame_ref, 0, 0);
+		compare_mem("direct", frame_out, frame_ref, sizeof(frame_out));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+	printf("got CPU flags %d\n", cpu_flags);
+
+	test_rgb_yuv();
+	test_scale();
+	test_simd();
+	test_direct();
+
+	return 0;
+}
@@ -0,0 +1,366 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "video-ops.h"
+
+#define AVG2(a,b)	(uint8_t)(((uint32_t)(a) + (uint32_t)(b) + 1) >> 1)
+
+DEFINE_UNPACK_FUNCTION(planar_420)
+{
+	const struct video_format_info *info = conv->src_info;
+	const uint8_t *sy = VIDEO_ROW(src, 0, y, const uint8_t);
+	const uint8_t *su = VIDEO_ROW(src, info->offset[1], y >> 1, const uint8_t);
+	const uint8_t *sv = VIDEO_ROW(src, info->offset[2], y >> 1, const uint8_t);
+	uint32_t i;
+
+	for (i = 0; i < src->width; i++) {
+		dst[0] = sy[i];
+		dst[1] = su[i >> 1];
+		dst[2] = sv[i >> 1];
+		dst[3] = 0xff;
+		dst += 4;
+	}
+}
+
+DEFINE_UNPACK_FUNCTION(semi_planar_420)
+{
+	const struct video_format_info *info = conv->src_info;
+	const uint8_t *sy = VIDEO_ROW(src, 0, y, const uint8_t);
+	const uint8_t *suv = VIDEO_ROW(src, 1, y >> 1, const uint8_t);
+	uint32_t i;
+
+	for (i = 0; i < src->width; i++) {
+		const uint8_t *c = &suv[(i >> 1) * 2];
+		dst[0] = sy[i];
+		dst[1] = c[info->offset[1]];
+		dst[2] = c[info->offset[2]];
+		dst[3] = 0xff;
+		dst += 4;
+	}
+}
+
+DEFINE_UNPACK_FUNCTION(packed_422)
+{
+	const struct video_format_info *info = conv->src_info;
+	const uint8_t *s = VIDEO_ROW(src, 0, y, const uint8_t);
+	uint32_t i;
+
+	for (i = 0; i < src->width; i++) {
+		const uint8_t *p = &s[(i >> 1) * 4];
+		dst[0] = p[(i & 1) ? info->offset[3] : info->offset[0]];
+		dst[1] = p[info->offset[1]];
+		dst[2] = p[info->offset[2]];
+		dst[3] = 0xff;
+		dst += 4;
+	}
+}
+
+DEFINE_UNPACK_FUNCTION(packed)
+{
+	const struct video_format_info *info = conv->src_info;
+	const uint8_t *s = VIDEO_ROW(src, 0, y, const uint8_t);
+	bool alpha = SPA_FLAG_IS_SET(info->flags, VIDEO_FORMAT_FLAG_ALPHA);
+	uint32_t i;
+
+	if (alpha && info->format == SPA_VIDEO_FORMAT_RGBA) {
+		memcpy(dst, s, src->width * 4);
+		return;
+	}
+	for (i = 0; i < src->width; i++) {
+		dst[0] = s[info->offset[0]];
+		dst[1] = s[info->offset[1]];
+		dst[2] = s[info->offset[2]];
+		dst[3] = alpha ? s[info->offset[3]] : 0xff;
+		s += info->bpp;
+		dst += 4;
+	}
+}
+
+DEFINE_UNPACK_FUNCTION(gray)
+{
+	const uint8_t *s = VIDEO_ROW(src, 0, y, const uint8_t);
+	uint32_t i;
+
+	for (i = 0; i < src->width; i++) {
+		dst[0] = s[i];
+		dst[1] = 128;
+		dst[2] = 128;
+		dst[3] = 0xff;
+		dst += 4;
+	}
+}
+
+DEFINE_UNPACK_FUNCTION(f32)
+{
+	const float *s = VIDEO_ROW(src, 0, y, const float);
+	uint32_t i, n = src->width * 4;
+
+	for (i = 0; i < n; i++)
+		dst[i] = (uint8_t)(SPA_CLAMPF(s[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+DEFINE_PACK_FUNCTION(planar_420)
+{
+	const struct video_format_info *info = conv->dst_info;
+	uint8_t *dy = VIDEO_ROW(dst, 0, y, uint8_t);
+	uint32_t i, w = dst->width;
+
+	for (i = 0; i < w; i++)
+		dy[i] = src[i * 4];
+
+	if ((y & 1) == 0) {
+		uint8_t *du = VIDEO_ROW(dst, info->offset[1], y >> 1, uint8_t);
+		uint8_t *dv = VIDEO_ROW(dst, info->offset[2], y >> 1, uint8_t);
+
+		for (i = 0; i < w; i += 2) {
+			const uint8_t *p0 = &src[i * 4];
+			const uint8_t *p1 = i + 1 < w ? p0 + 4 : p0;
+			du[i >> 1] = AVG2(p0[1], p1[1]);
+			dv[i >> 1] = AVG2(p0[2], p1[2]);
+		}
+	}
+}
+
+DEFINE_PACK_FUNCTION(semi_planar_420)
+{
+	const struct video_format_info *info = conv->dst_info;
+	uint8_t *dy = VIDEO_ROW(dst, 0, y, uint8_t);
+	uint32_t i, w = dst->width;
+
+	for (i = 0; i < w; i++)
+		dy[i] = src[i * 4];
+
+	if ((y & 1) == 0) {
+		uint8_t *duv = VIDEO_ROW(dst, 1, y >> 1, uint8_t);
+
+		for (i = 0; i < w; i += 2) {
+			const uint8_t *p0 = &src[i * 4];
+			const uint8_t *p1 = i + 1 < w ? p0 + 4 : p0;
+			duv[i + info->offset[1]] = AVG2(p0[1], p1[1]);
+			duv[i + info->offset[2]] = AVG2(p0[2], p1[2]);
+		}
+	}
+}
+
+DEFINE_PACK_FUNCTION(packed_422)
+{
+	const struct video_format_info *info = conv->dst_info;
+	uint8_t *d = VIDEO_ROW(dst, 0, y, uint8_t);
+	uint32_t i, w = dst->width;
+
+	for (i = 0; i < w; i += 2) {
+		const uint8_t *p0 = &src[i * 4];
+		const uint8_t *p1 = i + 1 < w ? p0 + 4 : p0;
+		d[info->offset[0]] = p0[0];
+		d[info->offset[1]] = AVG2(p0[1], p1[1]);
+		d[info->offset[2]] = AVG2(p0[2], p1[2]);
+		d[info->offset[3]] = p1[0];
+		d += 4;
+	}
+}
+
+DEFINE_PACK_FUNCTION(packed)
+{
+	const struct video_format_info *info = conv->dst_info;
+	uint8_t *d = VIDEO_ROW(dst, 0, y, uint8_t);
+	uint32_t i;
+
+	if (info->format == SPA_VIDEO_FORMAT_RGBA || info->format == SPA_VIDEO_FORMAT_RGBx) {
+		memcpy(d, src, dst->width * 4);
+		return;
+	}
+	for (i = 0; i < dst->width; i++) {
+		d[info->offset[0]] = src[0];
+		d[info->offset[1]] = src[1];
+		d[info->offset[2]] = src[2];
+		if (info->offset[3] != 0xff)
+			d[info->offset[3]] = src[3];
+		d += info->bpp;
+		src += 4;
+	}
+}
+
+DEFINE_PACK_FUNCTION(gray)
+{
+	uint8_t *d = VIDEO_ROW(dst, 0, y, uint8_t);
+	uint32_t i;
+
+	for (i = 0; i < dst->width; i++)
+		d[i] = src[i * 4];
+}
+
+DEFINE_PACK_FUNCTION(f32)
+{
+	float *d = VIDEO_ROW(dst, 0, y, float);
+	uint32_t i, n = dst->width * 4;
+
+	for (i = 0; i < n; i++)
+		d[i] = src[i] * (1.0f / 255.0f);
+}
+
+/* This mirrors the 16 bits fixed point math of the SIMD versions so that
+ * all implementations produce the same output. */
+static inline int16_t mulhi_s16(int16_t a, int16_t b)
+{
+	return (int16_t)(((int32_t)a * b) >> 16);
+}
+
+DEFINE_MATRIX_FUNCTION(c)
+{
+	const struct video_matrix *m = &conv->mat;
+	int16_t round = 1 << (m->shift - 1);
+	uint32_t i, j;
+
+	for (i = 0; i < width; i++) {
+		int16_t x0 = (src[0] - m->in_offset[0]) * 128;
+		int16_t x1 = (src[1] - m->in_offset[1]) * 128;
+		int16_t x2 = (src[2] - m->in_offset[2]) * 128;
+
+		for (j = 0; j < 3; j++) {
+			int16_t v = mulhi_s16(x0, m->coef[j][0]) +
+				mulhi_s16(x1, m->coef[j][1]) +
+				mulhi_s16(x2, m->coef[j][2]);
+			v = ((v + round) >> m->shift) + m->out_offset[j];
+			dst[j] = SPA_CLAMP(v, 0, 255);
+		}
+		dst[3] = src[3];
+		src += 4;
+		dst += 4;
+	}
+}
+
+DEFINE_VSCALE_FUNCTION(c)
+{
+	uint32_t i, w0 = 256 - weight;
+
+	for (i = 0; i < n_bytes; i++)
+		dst[i] = (s0[i] * w0 + s1[i] * weight + 128) >> 8;
+}
+
+static inline void packed_422_to_i420(struct video_frame *dst, const struct video_frame *src,
+		uint32_t y_ofs, uint32_t u_ofs, uint32_t v_ofs)
+{
+	uint32_t x, y, w = src->width, h = src->height;
+
+	for (y = 0; y < h; y += 2) {
+		const uint8_t *s0 = VIDEO_ROW(src, 0, y, const uint8_t);
+		const uint8_t *s1 = y + 1 < h ? VIDEO_ROW(src, 0, y + 1, const uint8_t) : s0;
+		uint8_t *d0 = VIDEO_ROW(dst, 0, y, uint8_t);
+		uint8_t *d1 = y + 1 < h ? VIDEO_ROW(dst, 0, y + 1, uint8_t) : d0;
+		uint8_t *du = VIDEO_ROW(dst, 1, y >> 1, uint8_t);
+		uint8_t *dv = VIDEO_ROW(dst, 2, y >> 1, uint8_t);
+
+		for (x = 0; x < w; x += 2) {
+			const uint8_t *p0 = &s0[x * 2], *p1 = &s1[x * 2];
+			d0[x] = p0[y_ofs];
+			d1[x] = p1[y_ofs];
+			if (x + 1 < w) {
+				d0[x + 1] = p0[y_ofs + 2];
+				d1[x + 1] = p1[y_ofs + 2];
+			}
+			du[x >> 1] = AVG2(p0[u_ofs], p1[u_ofs]);
+			dv[x >> 1] = AVG2(p0[v_ofs], p1[v_ofs]);
+		}
+	}
+}
+
+DEFINE_FUNCTION(yuy2_to_i420, c)
+{
+	packed_422_to_i420(dst, src, 0, 1, 3);
+}
+
+DEFINE_FUNCTION(uyvy_to_i420, c)
+{
+	packed_422_to_i420(dst, src, 1, 0, 2);
+}
+
+DEFINE_FUNCTION(yuy2_to_nv12, c)
+{
+	uint32_t x, y, w = src->width, h = src->height;
+
+	for (y = 0; y < h; y += 2) {
+		const uint8_t *s0 = VIDEO_ROW(src, 0, y, const uint8_t);
+		const uint8_t *s1 = y + 1 < h ? VIDEO_ROW(src, 0, y + 1, const uint8_t) : s0;
+		uint8_t *d0 = VIDEO_ROW(dst, 0, y, uint8_t);
+		uint8_t *d1 = y + 1 < h ? VIDEO_ROW(dst, 0, y + 1, uint8_t) : d0;
+		uint8_t *duv = VIDEO_ROW(dst, 1, y >> 1, uint8_t);
+
+		for (x = 0; x < w; x += 2) {
+			const uint8_t *p0 = &s0[x * 2], *p1 = &s1[x * 2];
+			d0[x] = p0[0];
+			d1[x] = p1[0];
+			if (x + 1 < w) {
+				d0[x + 1] = p0[2];
+				d1[x + 1] = p1[2];
+			}
+			duv[x + 0] = AVG2(p0[1], p1[1]);
+			duv[x + 1] = AVG2(p0[3], p1[3]);
+		}
+	}
+}
+
+DEFINE_FUNCTION(nv12_to_i420, c)
+{
+	uint32_t x, y, w = src->width, h = src->height;
+	uint32_t cw = (w + 1) >> 1, ch = (h + 1) >> 1;
+
+	for (y = 0; y < h; y++)
+		memcpy(VIDEO_ROW(dst, 0, y, uint8_t), VIDEO_ROW(src, 0, y, const uint8_t), w);
+
+	for (y = 0; y < ch; y++) {
+		const uint8_t *suv = VIDEO_ROW(src, 1, y, const uint8_t);
+		uint8_t *du = VIDEO_ROW(dst, 1, y, uint8_t);
+		uint8_t *dv = VIDEO_ROW(dst, 2, y, uint8_t);
+
+		for (x = 0; x < cw; x++) {
+			du[x] = suv[x * 2 + 0];
+			dv[x] = suv[x * 2 + 1];
+		}
+	}
+}
+
+DEFINE_FUNCTION(i420_to_nv12, c)
+{
+	uint32_t x, y, w = src->width, h = src->height;
+	uint32_t cw = (w + 1) >> 1, ch = (h + 1) >> 1;
+
+	for (y = 0; y < h; y++)
+		memcpy(VIDEO_ROW(dst, 0, y, uint8_t), VIDEO_ROW(src, 0, y, const uint8_t), w);
+
+	for (y = 0; y < ch; y++) {
+		const uint8_t *su = VIDEO_ROW(src, 1, y, const uint8_t);
+		const uint8_t *sv = VIDEO_ROW(src, 2, y, const uint8_t);
+		uint8_t *duv = VIDEO_ROW(dst, 1, y, uint8_t);
+
+		for (x = 0; x < cw; x++) {
+			duv[x * 2 + 0] = su[x];
+			duv[x * 2 + 1] = sv[x];
+		}
+	}
+}
+
+DEFINE_FUNCTION(i420_to_yuy2, c)
+{
+	uint32_t x, y, w = src->width, h = src->height;
+
+	for (y = 0; y < h; y++) {
+		const uint8_t *sy = VIDEO_ROW(src, 0, y, const uint8_t);
+		const uint8_t *su = VIDEO_ROW(src, 1, y >> 1, const uint8_t);
+		const uint8_t *sv = VIDEO_ROW(src, 2, y >> 1, const uint8_t);
+		uint8_t *d = VIDEO_ROW(dst, 0, y, uint8_t);
+
+		for (x = 0; x < w; x += 2) {
+			d[0] = sy[x];
+			d[1] = su[x >> 1];
+			d[2] = x + 1 < w ? sy[x + 1] : sy[x];
+			d[3] = sv[x >> 1];
+			d += 4;
+		}
+	}
+}
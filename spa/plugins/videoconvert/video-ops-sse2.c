@@ -0,0 +1,229 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+#include <emmintrin.h>
+
+#define AVG2(a,b)	(uint8_t)(((uint32_t)(a) + (uint32_t)(b) + 1) >> 1)
+
+static inline void
+packed_422_to_i420_sse2(struct video_frame *dst, const struct video_frame *src,
+		uint32_t y_ofs, uint32_t u_ofs, uint32_t v_ofs)
+{
+	uint32_t x, y, w = src->width, h = src->height, unrolled = w & ~15;
+	const __m128i mask = _mm_set1_epi16(0x00ff);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (y = 0; y < h; y += 2) {
+		const uint8_t *s0 = VIDEO_ROW(src, 0, y, const uint8_t);
+		const uint8_t *s1 = y + 1 < h ? VIDEO_ROW(src, 0, y + 1, const uint8_t) : s0;
+		uint8_t *d0 = VIDEO_ROW(dst, 0, y, uint8_t);
+		uint8_t *d1 = y + 1 < h ? VIDEO_ROW(dst, 0, y + 1, uint8_t) : d0;
+		uint8_t *du = VIDEO_ROW(dst, 1, y >> 1, uint8_t);
+		uint8_t *dv = VIDEO_ROW(dst, 2, y >> 1, uint8_t);
+
+		for (x = 0; x < unrolled; x += 16) {
+			__m128i a0 = _mm_loadu_si128((const __m128i*)&s0[x * 2]);
+			__m128i b0 = _mm_loadu_si128((const __m128i*)&s0[x * 2 + 16]);
+			__m128i a1 = _mm_loadu_si128((const __m128i*)&s1[x * 2]);
+			__m128i b1 = _mm_loadu_si128((const __m128i*)&s1[x * 2 + 16]);
+			__m128i y0, y1, c0, c1, c;
+
+			if (y_ofs == 0) {
+				y0 = _mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(b0, mask));
+				y1 = _mm_packus_epi16(_mm_and_si128(a1, mask), _mm_and_si128(b1, mask));
+				c0 = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(b0, 8));
+				c1 = _mm_packus_epi16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+			} else {
+				y0 = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(b0, 8));
+				y1 = _mm_packus_epi16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+				c0 = _mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(b0, mask));
+				c1 = _mm_packus_epi16(_mm_and_si128(a1, mask), _mm_and_si128(b1, mask));
+			}
+			_mm_storeu_si128((__m128i*)&d0[x], y0);
+			_mm_storeu_si128((__m128i*)&d1[x], y1);
+
+			/* c holds the averaged U0 V0 U1 V1 .. */
+			c = _mm_avg_epu8(c0, c1);
+			_mm_storel_epi64((__m128i*)&du[x >> 1],
+					_mm_packus_epi16(_mm_and_si128(c, mask), zero));
+			_mm_storel_epi64((__m128i*)&dv[x >> 1],
+					_mm_packus_epi16(_mm_srli_epi16(c, 8), zero));
+		}
+		for (; x < w; x += 2) {
+			const uint8_t *p0 = &s0[x * 2], *p1 = &s1[x * 2];
+			d0[x] = p0[y_ofs];
+			d1[x] = p1[y_ofs];
+			if (x + 1 < w) {
+				d0[x + 1] = p0[y_ofs + 2];
+				d1[x + 1] = p1[y_ofs + 2];
+			}
+			du[x >> 1] = AVG2(p0[u_ofs], p1[u_ofs]);
+			dv[x >> 1] = AVG2(p0[v_ofs], p1[v_ofs]);
+		}
+	}
+}
+
+DEFINE_FUNCTION(yuy2_to_i420, sse2)
+{
+	packed_422_to_i420_sse2(dst, src, 0, 1, 3);
+}
+
+DEFINE_FUNCTION(uyvy_to_i420, sse2)
+{
+	packed_422_to_i420_sse2(dst, src, 1, 0, 2);
+}
+
+DEFINE_FUNCTION(nv12_to_i420, sse2)
+{
+	uint32_t x, y, w = src->width, h = src->height;
+	uint32_t cw = (w + 1) >> 1, ch = (h + 1) >> 1, unrolled = cw & ~15;
+	const __m128i mask = _mm_set1_epi16(0x00ff);
+
+	for (y = 0; y < h; y++)
+		memcpy(VIDEO_ROW(dst, 0, y, uint8_t), VIDEO_ROW(src, 0, y, const uint8_t), w);
+
+	for (y = 0; y < ch; y++) {
+		const uint8_t *suv = VIDEO_ROW(src, 1, y, const uint8_t);
+		uint8_t *du = VIDEO_ROW(dst, 1, y, uint8_t);
+		uint8_t *dv = VIDEO_ROW(dst, 2, y, uint8_t);
+
+		for (x = 0; x < unrolled; x += 16) {
+			__m128i a = _mm_loadu_si128((const __m128i*)&suv[x * 2]);
+			__m128i b = _mm_loadu_si128((const __m128i*)&suv[x * 2 + 16]);
+
+			_mm_storeu_si128((__m128i*)&du[x],
+					_mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+			_mm_storeu_si128((__m128i*)&dv[x],
+					_mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+		}
+		for (; x < cw; x++) {
+			du[x] = suv[x * 2 + 0];
+			dv[x] = suv[x * 2 + 1];
+		}
+	}
+}
+
+DEFINE_FUNCTION(i420_to_nv12, sse2)
+{
+	uint32_t x, y, w = src->width, h = src->height;
+	uint32_t cw = (w + 1) >> 1, ch = (h + 1) >> 1, unrolled = cw & ~15;
+
+	for (y = 0; y < h; y++)
+		memcpy(VIDEO_ROW(dst, 0, y, uint8_t), VIDEO_ROW(src, 0, y, const uint8_t), w);
+
+	for (y = 0; y < ch; y++) {
+		const uint8_t *su = VIDEO_ROW(src, 1, y, const uint8_t);
+		const uint8_t *sv = VIDEO_ROW(src, 2, y, const uint8_t);
+		uint8_t *duv = VIDEO_ROW(dst, 1, y, uint8_t);
+
+		for (x = 0; x < unrolled; x += 16) {
+			__m128i u = _mm_loadu_si128((const __m128i*)&su[x]);
+			__m128i v = _mm_loadu_si128((const __m128i*)&sv[x]);
+
+			_mm_storeu_si128((__m128i*)&duv[x * 2], _mm_unpacklo_epi8(u, v));
+			_mm_storeu_si128((__m128i*)&duv[x * 2 + 16], _mm_unpackhi_epi8(u, v));
+		}
+		for (; x < cw; x++) {
+			duv[x * 2 + 0] = su[x];
+			duv[x * 2 + 1] = sv[x];
+		}
+	}
+}
+
+DEFINE_MATRIX_FUNCTION(sse2)
+{
+	const struct video_matrix *m = &conv->mat;
+	uint32_t i, j, unrolled = width & ~7;
+	const __m128i mask = _mm_set1_epi32(0xff);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(1 << (m->shift - 1));
+	__m128i coef[3][3], in_offset[3], out_offset[3];
+	const __m128i shift = _mm_cvtsi32_si128(m->shift);
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++)
+			coef[i][j] = _mm_set1_epi16(m->coef[i][j]);
+		in_offset[i] = _mm_set1_epi16(m->in_offset[i]);
+		out_offset[i] = _mm_set1_epi16(m->out_offset[i]);
+	}
+
+	for (i = 0; i < unrolled; i += 8) {
+		__m128i p0 = _mm_loadu_si128((const __m128i*)&src[i * 4]);
+		__m128i p1 = _mm_loadu_si128((const __m128i*)&src[i * 4 + 16]);
+		__m128i x[3], v[3], a, t0, t1;
+
+		/* split the 8 pixels in 16 bits vectors per component */
+		x[0] = _mm_packs_epi32(_mm_and_si128(p0, mask),
+				_mm_and_si128(p1, mask));
+		x[1] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+				_mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+		x[2] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+				_mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+		for (j = 0; j < 3; j++)
+			x[j] = _mm_slli_epi16(_mm_sub_epi16(x[j], in_offset[j]), 7);
+		for (j = 0; j < 3; j++) {
+			v[j] = _mm_add_epi16(
+				_mm_add_epi16(
+					_mm_mulhi_epi16(x[0], coef[j][0]),
+					_mm_mulhi_epi16(x[1], coef[j][1])),
+				_mm_mulhi_epi16(x[2], coef[j][2]));
+			v[j] = _mm_add_epi16(_mm_sra_epi16(_mm_add_epi16(v[j], round), shift),
+					out_offset[j]);
+			/* saturate to 0..255 and back to 16 bits */
+			v[j] = _mm_unpacklo_epi8(_mm_packus_epi16(v[j], v[j]), zero);
+		}
+		a = _mm_srli_epi32(p0, 24);
+		t0 = _mm_or_si128(
+			_mm_or_si128(_mm_unpacklo_epi16(v[0], zero),
+				_mm_slli_epi32(_mm_unpacklo_epi16(v[1], zero), 8)),
+			_mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(v[2], zero), 16),
+				_mm_slli_epi32(a, 24)));
+		a = _mm_srli_epi32(p1, 24);
+		t1 = _mm_or_si128(
+			_mm_or_si128(_mm_unpackhi_epi16(v[0], zero),
+				_mm_slli_epi32(_mm_unpackhi_epi16(v[1], zero), 8)),
+			_mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(v[2], zero), 16),
+				_mm_slli_epi32(a, 24)));
+
+		_mm_storeu_si128((__m128i*)&dst[i * 4], t0);
+		_mm_storeu_si128((__m128i*)&dst[i * 4 + 16], t1);
+	}
+	if (i < width)
+		video_matrix_c(conv, &dst[i * 4], &src[i * 4], width - i);
+}
+
+DEFINE_VSCALE_FUNCTION(sse2)
+{
+	uint32_t i, unrolled = n_bytes & ~15;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w0 = _mm_set1_epi16(256 - weight);
+	const __m128i w1 = _mm_set1_epi16(weight);
+	const __m128i round = _mm_set1_epi16(128);
+
+	for (i = 0; i < unrolled; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*)&s0[i]);
+		__m128i b = _mm_loadu_si128((const __m128i*)&s1[i]);
+		__m128i lo, hi;
+
+		lo = _mm_add_epi16(
+			_mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+				_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1)),
+			round);
+		hi = _mm_add_epi16(
+			_mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+				_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1)),
+			round);
+
+		_mm_storeu_si128((__m128i*)&dst[i],
+				_mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+	}
+	if (i < n_bytes)
+		video_vscale_c(conv, &dst[i], &s0[i], &s1[i], n_bytes - i, weight);
+}
@@ -0,0 +1,483 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+
+#include "video-ops.h"
+
+#define F_YUV	VIDEO_FORMAT_FLAG_YUV
+#define F_ALPHA	VIDEO_FORMAT_FLAG_ALPHA
+#define F_FLOAT	VIDEO_FORMAT_FLAG_FLOAT
+#define F_GRAY	VIDEO_FORMAT_FLAG_GRAY
+#define NONE	0xff
+
+#define MAKE_FORMAT(fmt,flags,planes,bpp,hs,vs,o0,o1,o2,o3,func)		\
+	{ SPA_VIDEO_FORMAT_ ##fmt, #fmt, flags, planes, bpp, hs, vs,		\
+		{ o0, o1, o2, o3 }, video_unpack_##func##_c, video_pack_##func##_c }
+
+/* for planar formats, offset[] contains the plane of each component,
+ * for semi planar formats the offset of U and V in the chroma plane */
+static const struct video_format_info format_table[] =
+{
+	MAKE_FORMAT(I420, F_YUV, 3, 1, 1, 1, 0, 1, 2, NONE, planar_420),
+	MAKE_FORMAT(YV12, F_YUV, 3, 1, 1, 1, 0, 2, 1, NONE, planar_420),
+	MAKE_FORMAT(NV12, F_YUV, 2, 1, 1, 1, 0, 0, 1, NONE, semi_planar_420),
+	MAKE_FORMAT(NV21, F_YUV, 2, 1, 1, 1, 0, 1, 0, NONE, semi_planar_420),
+	MAKE_FORMAT(YUY2, F_YUV, 1, 2, 1, 0, 0, 1, 3, 2, packed_422),
+	MAKE_FORMAT(UYVY, F_YUV, 1, 2, 1, 0, 1, 0, 2, 3, packed_422),
+	MAKE_FORMAT(YVYU, F_YUV, 1, 2, 1, 0, 0, 3, 1, 2, packed_422),
+	MAKE_FORMAT(RGBA, F_ALPHA, 1, 4, 0, 0, 0, 1, 2, 3, packed),
+	MAKE_FORMAT(BGRA, F_ALPHA, 1, 4, 0, 0, 2, 1, 0, 3, packed),
+	MAKE_FORMAT(ARGB, F_ALPHA, 1, 4, 0, 0, 1, 2, 3, 0, packed),
+	MAKE_FORMAT(ABGR, F_ALPHA, 1, 4, 0, 0, 3, 2, 1, 0, packed),
+	MAKE_FORMAT(RGBx, 0, 1, 4, 0, 0, 0, 1, 2, 3, packed),
+	MAKE_FORMAT(BGRx, 0, 1, 4, 0, 0, 2, 1, 0, 3, packed),
+	MAKE_FORMAT(xRGB, 0, 1, 4, 0, 0, 1, 2, 3, 0, packed),
+	MAKE_FORMAT(xBGR, 0, 1, 4, 0, 0, 3, 2, 1, 0, packed),
+	MAKE_FORMAT(RGB, 0, 1, 3, 0, 0, 0, 1, 2, NONE, packed),
+	MAKE_FORMAT(BGR, 0, 1, 3, 0, 0, 2, 1, 0, NONE, packed),
+	MAKE_FORMAT(GRAY8, F_YUV | F_GRAY, 1, 1, 0, 0, 0, NONE, NONE, NONE, gray),
+	MAKE_FORMAT(RGBA_F32, F_ALPHA | F_FLOAT, 1, 16, 0, 0, 0, 1, 2, 3, f32),
+};
+
+const struct video_format_info *video_format_info_find(uint32_t format)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(format_table, f) {
+		if (f->format == format)
+			return f;
+	}
+	return NULL;
+}
+
+uint32_t video_format_row_bytes(const struct video_format_info *info, uint32_t plane,
+		uint32_t width)
+{
+	if (plane == 0) {
+		/* packed 4:2:2 stores 2 pixels in 4 bytes */
+		if (info->h_sub > 0 && info->n_planes == 1)
+			return ((width + 1) & ~1u) * info->bpp;
+		return width * info->bpp;
+	}
+	width = (width + (1u << info->h_sub) - 1) >> info->h_sub;
+	return info->n_planes == 2 ? width * 2 : width;
+}
+
+uint32_t video_format_rows(const struct video_format_info *info, uint32_t plane,
+		uint32_t height)
+{
+	return plane == 0 ? height : (height + (1u << info->v_sub) - 1) >> info->v_sub;
+}
+
+int video_format_layout(uint32_t format, uint32_t width, uint32_t height,
+		uint32_t stride, uint32_t strides[VIDEO_MAX_PLANES],
+		uint32_t offsets[VIDEO_MAX_PLANES])
+{
+	const struct video_format_info *info;
+	uint32_t i, size = 0;
+
+	if ((info = video_format_info_find(format)) == NULL)
+		return -ENOTSUP;
+
+	if (stride == 0)
+		stride = SPA_ROUND_UP_N(video_format_row_bytes(info, 0, width), VIDEO_OPS_MAX_ALIGN);
+	else if (stride < video_format_row_bytes(info, 0, width))
+		return -EINVAL;
+
+	for (i = 0; i < info->n_planes; i++) {
+		/* chroma strides follow the luma stride like V4L2 does */
+		if (i > 0)
+			strides[i] = info->n_planes == 2 ? stride : stride >> info->h_sub;
+		else
+			strides[i] = stride;
+		offsets[i] = size;
+		size += strides[i] * video_format_rows(info, i, height);
+	}
+	for (; i < VIDEO_MAX_PLANES; i++)
+		strides[i] = offsets[i] = 0;
+
+	return size;
+}
+
+void video_matrix_init(struct video_matrix *mat, uint32_t matrix, bool to_rgb)
+{
+	double kr, kb, kg, m[3][3];
+	uint32_t i, j;
+	int scale;
+
+	switch (matrix) {
+	case VIDEO_MATRIX_BT709:
+		kr = 0.2126;
+		kb = 0.0722;
+		break;
+	default:
+		kr = 0.299;
+		kb = 0.114;
+		break;
+	}
+	kg = 1.0 - kr - kb;
+
+	/* limited range, Y in [16,235], U and V in [16,240] */
+	if (to_rgb) {
+		double ys = 255.0 / 219.0, cs = 255.0 / 224.0;
+		m[0][0] = ys; m[0][1] = 0.0; m[0][2] = cs * 2.0 * (1.0 - kr);
+		m[1][0] = ys; m[1][1] = -cs * 2.0 * (1.0 - kb) * kb / kg;
+		m[1][2] = -cs * 2.0 * (1.0 - kr) * kr / kg;
+		m[2][0] = ys; m[2][1] = cs * 2.0 * (1.0 - kb); m[2][2] = 0.0;
+
+		mat->in_offset[0] = 16;
+		mat->in_offset[1] = mat->in_offset[2] = 128;
+		mat->out_offset[0] = mat->out_offset[1] = mat->out_offset[2] = 0;
+		/* the coefficients go up to 2.1, the result has 4 fractional bits */
+		scale = 1 << 13;
+		mat->shift = 4;
+	} else {
+		double ys = 219.0 / 255.0, cs = 224.0 / 255.0;
+		m[0][0] = kr * ys; m[0][1] = kg * ys; m[0][2] = kb * ys;
+		m[1][0] = -kr / (2.0 * (1.0 - kb)) * cs;
+		m[1][1] = -kg / (2.0 * (1.0 - kb)) * cs;
+		m[1][2] = 0.5 * cs;
+		m[2][0] = 0.5 * cs;
+		m[2][1] = -kg / (2.0 * (1.0 - kr)) * cs;
+		m[2][2] = -kb / (2.0 * (1.0 - kr)) * cs;
+
+		mat->in_offset[0] = mat->in_offset[1] = mat->in_offset[2] = 0;
+		mat->out_offset[0] = 16;
+		mat->out_offset[1] = mat->out_offset[2] = 128;
+		/* the coefficients are below 1.0, the result has 6 fractional bits */
+		scale = 1 << 15;
+		mat->shift = 6;
+	}
+	for (i = 0; i < 3; i++)
+		for (j = 0; j < 3; j++)
+			mat->coef[i][j] = (int16_t)SPA_CLAMP(lrint(m[i][j] * scale), INT16_MIN, INT16_MAX);
+}
+
+typedef void (*convert_func_t) (struct video_convert *conv, struct video_frame *dst,
+		const struct video_frame *src);
+
+struct conv_info {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+
+	convert_func_t process;
+	const char *name;
+
+	uint32_t cpu_flags;
+};
+
+#define MAKE(fmt1,fmt2,func,...) \
+	{  SPA_VIDEO_FORMAT_ ##fmt1, SPA_VIDEO_FORMAT_ ##fmt2, func, #func , __VA_ARGS__ }
+
+/* direct conversions between formats of the same size */
+static struct conv_info conv_table[] =
+{
+#if defined (HAVE_SSE2)
+	MAKE(YUY2, I420, video_convert_yuy2_to_i420_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(YUY2, I420, video_convert_yuy2_to_i420_c),
+#if defined (HAVE_SSE2)
+	MAKE(UYVY, I420, video_convert_uyvy_to_i420_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(UYVY, I420, video_convert_uyvy_to_i420_c),
+	MAKE(YUY2, NV12, video_convert_yuy2_to_nv12_c),
+#if defined (HAVE_SSE2)
+	MAKE(NV12, I420, video_convert_nv12_to_i420_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(NV12, I420, video_convert_nv12_to_i420_c),
+#if defined (HAVE_SSE2)
+	MAKE(I420, NV12, video_convert_i420_to_nv12_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(I420, NV12, video_convert_i420_to_nv12_c),
+	MAKE(I420, YUY2, video_convert_i420_to_yuy2_c),
+};
+#undef MAKE
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct conv_info *find_conv_info(uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t cpu_flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(conv_table, c) {
+		if (c->src_fmt == src_fmt &&
+		    c->dst_fmt == dst_fmt &&
+		    MATCH_CPU_FLAGS(c->cpu_flags, cpu_flags))
+			return c;
+	}
+	return NULL;
+}
+
+static void convert_copy(struct video_convert *conv, struct video_frame *dst,
+		const struct video_frame *src)
+{
+	const struct video_format_info *info = conv->src_info;
+	uint32_t i, y;
+
+	for (i = 0; i < info->n_planes; i++) {
+		uint32_t bytes = video_format_row_bytes(info, i, src->width);
+		uint32_t rows = i == 0 ? src->height :
+			(src->height + (1u << info->v_sub) - 1) >> info->v_sub;
+
+		if (src->stride[i] == dst->stride[i]) {
+			memcpy(dst->data[i], src->data[i], (size_t)src->stride[i] * (rows - 1) + bytes);
+			continue;
+		}
+		for (y = 0; y < rows; y++)
+			memcpy(VIDEO_ROW(dst, i, y, uint8_t), VIDEO_ROW(src, i, y, const uint8_t), bytes);
+	}
+}
+
+static void hscale_line(struct video_convert *conv, uint8_t * SPA_RESTRICT dst,
+		const uint8_t * SPA_RESTRICT src)
+{
+	uint32_t i, j, k;
+
+	if (conv->scale_method == VIDEO_SCALE_METHOD_AREA &&
+	    conv->dst_width < conv->src_width) {
+		for (i = 0; i < conv->dst_width; i++) {
+			uint32_t x0 = conv->hofs0[i], x1 = conv->hofs1[i], n = x1 - x0;
+			for (j = 0; j < 4; j++) {
+				uint32_t sum = 0;
+				for (k = x0; k < x1; k++)
+					sum += src[k * 4 + j];
+				dst[j] = (sum + n / 2) / n;
+			}
+			dst += 4;
+		}
+	} else {
+		for (i = 0; i < conv->dst_width; i++) {
+			const uint8_t *p0 = &src[conv->hofs0[i] * 4];
+			const uint8_t *p1 = &src[conv->hofs1[i] * 4];
+			uint32_t w1 = conv->hweight[i], w0 = 256 - w1;
+			for (j = 0; j < 4; j++)
+				dst[j] = (p0[j] * w0 + p1[j] * w1 + 128) >> 8;
+			dst += 4;
+		}
+	}
+}
+
+/* returns the unpacked and horizontally scaled source line y, the last two
+ * lines are cached for the vertical filter */
+static const uint8_t *get_line(struct video_convert *conv, const struct video_frame *src,
+		uint32_t y)
+{
+	uint32_t slot;
+
+	if (conv->line_y[0] == y)
+		return conv->lines[0];
+	if (conv->line_y[1] == y)
+		return conv->lines[1];
+
+	if (conv->line_y[0] == SPA_ID_INVALID)
+		slot = 0;
+	else if (conv->line_y[1] == SPA_ID_INVALID)
+		slot = 1;
+	else
+		slot = conv->line_y[0] < conv->line_y[1] ? 0 : 1;
+
+	if (conv->src_width == conv->dst_width) {
+		conv->src_info->unpack(conv, conv->lines[slot], src, y);
+	} else {
+		conv->src_info->unpack(conv, conv->unpacked, src, y);
+		hscale_line(conv, conv->lines[slot], conv->unpacked);
+	}
+	conv->line_y[slot] = y;
+	return conv->lines[slot];
+}
+
+static const uint8_t *area_line(struct video_convert *conv, const struct video_frame *src,
+		uint32_t y)
+{
+	uint32_t i, sy, n_bytes = conv->dst_width * 4;
+	uint32_t y0 = (uint64_t)y * conv->src_height / conv->dst_height;
+	uint32_t y1 = (uint64_t)(y + 1) * conv->src_height / conv->dst_height;
+	uint32_t n;
+
+	y1 = SPA_MAX(y1, y0 + 1);
+	n = y1 - y0;
+
+	memset(conv->accum, 0, n_bytes * sizeof(uint32_t));
+	for (sy = y0; sy < y1; sy++) {
+		const uint8_t *l = get_line(conv, src, sy);
+		for (i = 0; i < n_bytes; i++)
+			conv->accum[i] += l[i];
+	}
+	for (i = 0; i < n_bytes; i++)
+		conv->tmp[i] = (conv->accum[i] + n / 2) / n;
+
+	return conv->tmp;
+}
+
+static void convert_generic(struct video_convert *conv, struct video_frame *dst,
+		const struct video_frame *src)
+{
+	uint32_t y, n_bytes = conv->dst_width * 4;
+	bool area = conv->scale_method == VIDEO_SCALE_METHOD_AREA &&
+		conv->dst_height < conv->src_height;
+
+	conv->line_y[0] = conv->line_y[1] = SPA_ID_INVALID;
+
+	for (y = 0; y < conv->dst_height; y++) {
+		const uint8_t *l;
+
+		if (conv->src_height == conv->dst_height) {
+			l = get_line(conv, src, y);
+		} else if (area) {
+			l = area_line(conv, src, y);
+		} else {
+			/* sample at the center of the destination pixel, 16.16 fixed point */
+			int64_t pos = (((int64_t)(2 * y + 1) * conv->src_height) << 16) /
+				(2 * conv->dst_height) - 0x8000;
+			uint32_t y0, y1, weight;
+
+			pos = SPA_MAX(pos, 0);
+			y0 = SPA_MIN((uint32_t)(pos >> 16), conv->src_height - 1);
+			y1 = SPA_MIN(y0 + 1, conv->src_height - 1);
+			weight = (pos >> 8) & 0xff;
+
+			if (weight == 0 || y0 == y1) {
+				l = get_line(conv, src, y0);
+			} else {
+				const uint8_t *l0 = get_line(conv, src, y0);
+				const uint8_t *l1 = get_line(conv, src, y1);
+				conv->vscale(conv, conv->tmp, l0, l1, n_bytes, weight);
+				l = conv->tmp;
+			}
+		}
+		if (conv->convert_matrix) {
+			conv->convert_matrix(conv, conv->out, l, conv->dst_width);
+			l = conv->out;
+		}
+		conv->dst_info->pack(conv, dst, y, l);
+	}
+}
+
+static void init_hscale(struct video_convert *conv)
+{
+	uint32_t i, sw = conv->src_width, dw = conv->dst_width;
+
+	if (conv->scale_method == VIDEO_SCALE_METHOD_AREA && dw < sw) {
+		for (i = 0; i < dw; i++) {
+			uint32_t x0 = (uint64_t)i * sw / dw;
+			uint32_t x1 = (uint64_t)(i + 1) * sw / dw;
+			conv->hofs0[i] = x0;
+			conv->hofs1[i] = SPA_MAX(x1, x0 + 1);
+			conv->hweight[i] = 0;
+		}
+		return;
+	}
+	for (i = 0; i < dw; i++) {
+		int64_t pos = (((int64_t)(2 * i + 1) * sw) << 16) / (2 * dw) - 0x8000;
+		uint32_t x0;
+
+		pos = SPA_MAX(pos, 0);
+		x0 = SPA_MIN((uint32_t)(pos >> 16), sw - 1);
+		conv->hofs0[i] = x0;
+		conv->hofs1[i] = SPA_MIN(x0 + 1, sw - 1);
+		conv->hweight[i] = (pos >> 8) & 0xff;
+	}
+}
+
+static void impl_convert_free(struct video_convert *conv)
+{
+	free(conv->data);
+	conv->data = NULL;
+}
+
+int video_convert_init(struct video_convert *conv)
+{
+	const struct conv_info *info;
+	uint32_t size[6], i, cpu_flags = 0;
+	bool same_size;
+	void *p;
+
+	conv->src_info = video_format_info_find(conv->src_fmt);
+	conv->dst_info = video_format_info_find(conv->dst_fmt);
+	if (conv->src_info == NULL || conv->dst_info == NULL)
+		return -ENOTSUP;
+	if (conv->src_width == 0 || conv->src_height == 0 ||
+	    conv->dst_width == 0 || conv->dst_height == 0)
+		return -EINVAL;
+
+	conv->free = impl_convert_free;
+	conv->data = NULL;
+	conv->convert_matrix = NULL;
+	conv->is_passthrough = false;
+
+	same_size = conv->src_width == conv->dst_width &&
+		conv->src_height == conv->dst_height;
+
+	if (same_size && conv->src_fmt == conv->dst_fmt) {
+		conv->is_passthrough = true;
+		conv->process = convert_copy;
+		conv->func_name = "convert_copy";
+		conv->cpu_flags = 0;
+		return 0;
+	}
+	if (same_size &&
+	    (info = find_conv_info(conv->src_fmt, conv->dst_fmt, conv->cpu_flags)) != NULL) {
+		conv->process = info->process;
+		conv->func_name = info->name;
+		conv->cpu_flags = info->cpu_flags;
+		return 0;
+	}
+
+	conv->vscale = video_vscale_c;
+#if defined (HAVE_SSE2)
+	if (SPA_FLAG_IS_SET(conv->cpu_flags, SPA_CPU_FLAG_SSE2)) {
+		conv->vscale = video_vscale_sse2;
+		cpu_flags |= SPA_CPU_FLAG_SSE2;
+	}
+#endif
+	if (SPA_FLAG_IS_SET(conv->src_info->flags, VIDEO_FORMAT_FLAG_YUV) !=
+	    SPA_FLAG_IS_SET(conv->dst_info->flags, VIDEO_FORMAT_FLAG_YUV)) {
+		video_matrix_init(&conv->mat, conv->matrix,
+				SPA_FLAG_IS_SET(conv->src_info->flags, VIDEO_FORMAT_FLAG_YUV));
+		conv->convert_matrix = video_matrix_c;
+#if defined (HAVE_SSE2)
+		if (SPA_FLAG_IS_SET(conv->cpu_flags, SPA_CPU_FLAG_SSE2))
+			conv->convert_matrix = video_matrix_sse2;
+#endif
+	}
+	conv->cpu_flags = cpu_flags;
+
+	size[0] = SPA_ROUND_UP_N(conv->dst_width * sizeof(uint32_t), VIDEO_OPS_MAX_ALIGN);
+	size[1] = SPA_ROUND_UP_N(conv->dst_width * sizeof(uint32_t), VIDEO_OPS_MAX_ALIGN);
+	size[2] = SPA_ROUND_UP_N(conv->dst_width, VIDEO_OPS_MAX_ALIGN);
+	/* lines[0], lines[1], tmp and out, all RGBA or AYUV */
+	size[3] = SPA_ROUND_UP_N(conv->dst_width * 4, VIDEO_OPS_MAX_ALIGN);
+	size[4] = SPA_ROUND_UP_N(conv->src_width * 4, VIDEO_OPS_MAX_ALIGN);
+	size[5] = SPA_ROUND_UP_N(conv->dst_width * 4 * sizeof(uint32_t), VIDEO_OPS_MAX_ALIGN);
+
+	conv->data = calloc(VIDEO_OPS_MAX_ALIGN + size[0] + size[1] + size[2] +
+			size[3] * 4 + size[4] + size[5], 1);
+	if (conv->data == NULL)
+		return -errno;
+
+	p = SPA_PTR_ALIGN(conv->data, VIDEO_OPS_MAX_ALIGN, void);
+	conv->hofs0 = p;
+	conv->hofs1 = p = SPA_PTROFF(p, size[0], void);
+	conv->hweight = p = SPA_PTROFF(p, size[1], void);
+	p = SPA_PTROFF(p, size[2], void);
+	for (i = 0; i < 2; i++) {
+		conv->lines[i] = p;
+		p = SPA_PTROFF(p, size[3], void);
+	}
+	conv->tmp = p;
+	conv->out = p = SPA_PTROFF(p, size[3], void);
+	conv->unpacked = p = SPA_PTROFF(p, size[3], void);
+	conv->accum = SPA_PTROFF(p, size[4], void);
+
+	init_hscale(conv);
+
+	conv->process = convert_generic;
+	conv->func_name = "convert_generic";
+
+	return 0;
+}
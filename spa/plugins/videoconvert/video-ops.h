@@ -0,0 +1,175 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <spa/utils/defs.h>
+#include <spa/param/video/raw.h>
+
+#define VIDEO_OPS_MAX_ALIGN	32
+#define VIDEO_MAX_PLANES	4
+
+struct video_frame {
+	uint32_t width;
+	uint32_t height;
+	void *data[VIDEO_MAX_PLANES];
+	uint32_t stride[VIDEO_MAX_PLANES];
+};
+
+#define VIDEO_ROW(f,p,y,type)	SPA_PTROFF((f)->data[p], (size_t)(y) * (f)->stride[p], type)
+
+struct video_convert;
+
+typedef void (*video_unpack_func_t) (struct video_convert *conv, uint8_t * SPA_RESTRICT dst,
+		const struct video_frame *src, uint32_t y);
+typedef void (*video_pack_func_t) (struct video_convert *conv, struct video_frame *dst,
+		uint32_t y, const uint8_t * SPA_RESTRICT src);
+
+#define VIDEO_FORMAT_FLAG_YUV		(1<<0)
+#define VIDEO_FORMAT_FLAG_ALPHA		(1<<1)
+#define VIDEO_FORMAT_FLAG_FLOAT		(1<<2)
+#define VIDEO_FORMAT_FLAG_GRAY		(1<<3)
+
+/* Describes the memory layout of a format. Packed formats store their
+ * components at offset[] in a pixel of bpp bytes, subsampled chroma planes
+ * are 1 << h_sub and 1 << v_sub smaller than the luma plane. */
+struct video_format_info {
+	uint32_t format;
+	const char *name;
+	uint32_t flags;
+	uint32_t n_planes;
+	uint32_t bpp;
+	uint32_t h_sub;
+	uint32_t v_sub;
+	uint8_t offset[4];
+	video_unpack_func_t unpack;
+	video_pack_func_t pack;
+};
+
+const struct video_format_info *video_format_info_find(uint32_t format);
+
+/* bytes in a row of pixels and number of rows of a plane */
+uint32_t video_format_row_bytes(const struct video_format_info *info, uint32_t plane,
+		uint32_t width);
+uint32_t video_format_rows(const struct video_format_info *info, uint32_t plane,
+		uint32_t height);
+
+/* Fill in the plane offsets and strides of a frame of the given size.
+ * When stride is 0, an aligned default stride is used. Returns the
+ * size of the frame or a negative error. */
+int video_format_layout(uint32_t format, uint32_t width, uint32_t height,
+		uint32_t stride, uint32_t strides[VIDEO_MAX_PLANES],
+		uint32_t offsets[VIDEO_MAX_PLANES]);
+
+/* fixed point color matrix, see video_matrix_init() */
+struct video_matrix {
+	int16_t coef[3][3];
+	int16_t in_offset[3];
+	int16_t out_offset[3];
+	int16_t shift;
+};
+
+struct video_convert {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+#define VIDEO_MATRIX_BT601	0
+#define VIDEO_MATRIX_BT709	1
+	uint32_t matrix;
+#define VIDEO_SCALE_METHOD_BILINEAR	0
+#define VIDEO_SCALE_METHOD_AREA		1
+	uint32_t scale_method;
+	uint32_t cpu_flags;
+	const char *func_name;
+
+	unsigned int is_passthrough:1;
+
+	const struct video_format_info *src_info;
+	const struct video_format_info *dst_info;
+
+	struct video_matrix mat;
+	void (*convert_matrix) (struct video_convert *conv, uint8_t * SPA_RESTRICT dst,
+			const uint8_t * SPA_RESTRICT src, uint32_t width);
+	void (*vscale) (struct video_convert *conv, uint8_t * SPA_RESTRICT dst,
+			const uint8_t * SPA_RESTRICT s0, const uint8_t * SPA_RESTRICT s1,
+			uint32_t n_bytes, uint32_t weight);
+
+	/* horizontal scaling map, one entry per destination pixel */
+	uint32_t *hofs0;
+	uint32_t *hofs1;
+	uint8_t *hweight;
+	uint8_t *lines[2];
+	uint32_t line_y[2];
+	uint8_t *unpacked;
+	uint8_t *tmp;
+	uint8_t *out;
+	uint32_t *accum;
+
+	void (*process) (struct video_convert *conv, struct video_frame *dst,
+			const struct video_frame *src);
+	void (*free) (struct video_convert *conv);
+
+	void *data;
+};
+
+int video_convert_init(struct video_convert *conv);
+
+#define video_convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
+#define video_convert_free(conv)	(conv)->free(conv)
+
+void video_matrix_init(struct video_matrix *mat, uint32_t matrix, bool to_rgb);
+
+#define DEFINE_FUNCTION(name,arch)						\
+void video_convert_##name##_##arch(struct video_convert *conv,			\
+		struct video_frame *dst, const struct video_frame *src)
+
+#define DEFINE_MATRIX_FUNCTION(arch)						\
+void video_matrix_##arch(struct video_convert *conv,				\
+		uint8_t * SPA_RESTRICT dst, const uint8_t * SPA_RESTRICT src,	\
+		uint32_t width)
+
+#define DEFINE_VSCALE_FUNCTION(arch)						\
+void video_vscale_##arch(struct video_convert *conv,				\
+		uint8_t * SPA_RESTRICT dst, const uint8_t * SPA_RESTRICT s0,	\
+		const uint8_t * SPA_RESTRICT s1, uint32_t n_bytes, uint32_t weight)
+
+#define DEFINE_UNPACK_FUNCTION(name)						\
+void video_unpack_##name##_c(struct video_convert *conv,			\
+		uint8_t * SPA_RESTRICT dst, const struct video_frame *src, uint32_t y)
+
+#define DEFINE_PACK_FUNCTION(name)						\
+void video_pack_##name##_c(struct video_convert *conv,				\
+		struct video_frame *dst, uint32_t y, const uint8_t * SPA_RESTRICT src)
+
+DEFINE_FUNCTION(yuy2_to_i420, c);
+DEFINE_FUNCTION(uyvy_to_i420, c);
+DEFINE_FUNCTION(yuy2_to_nv12, c);
+DEFINE_FUNCTION(nv12_to_i420, c);
+DEFINE_FUNCTION(i420_to_nv12, c);
+DEFINE_FUNCTION(i420_to_yuy2, c);
+DEFINE_MATRIX_FUNCTION(c);
+DEFINE_VSCALE_FUNCTION(c);
+
+DEFINE_UNPACK_FUNCTION(planar_420);
+DEFINE_UNPACK_FUNCTION(semi_planar_420);
+DEFINE_UNPACK_FUNCTION(packed_422);
+DEFINE_UNPACK_FUNCTION(packed);
+DEFINE_UNPACK_FUNCTION(gray);
+DEFINE_UNPACK_FUNCTION(f32);
+DEFINE_PACK_FUNCTION(planar_420);
+DEFINE_PACK_FUNCTION(semi_planar_420);
+DEFINE_PACK_FUNCTION(packed_422);
+DEFINE_PACK_FUNCTION(packed);
+DEFINE_PACK_FUNCTION(gray);
+DEFINE_PACK_FUNCTION(f32);
+
+#if defined(HAVE_SSE2)
+DEFINE_FUNCTION(yuy2_to_i420, sse2);
+DEFINE_FUNCTION(uyvy_to_i420, sse2);
+DEFINE_FUNCTION(nv12_to_i420, sse2);
+DEFINE_FUNCTION(i420_to_nv12, sse2);
+DEFINE_MATRIX_FUNCTION(sse2);
+DEFINE_VSCALE_FUNCTION(sse2);
+#endif
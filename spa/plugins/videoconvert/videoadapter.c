@@ -1721,7 +1721,7 @@ static int load_plugin_from(struct impl *this, const struct spa_dict *info,
 {
 	struct spa_handle *hnd_convert = NULL;
 	void *iface_conv = NULL;
-	hnd_convert = spa_plugin_loader_load(this->ploader, convertname, NULL);
+	hnd_convert = spa_plugin_loader_load(this->ploader, convertname, info);
 	if (!hnd_convert)
 		return -EINVAL;
 
@@ -0,0 +1,1324 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/log.h>
+#include <spa/support/cpu.h>
+#include <spa/utils/list.h>
+#include <spa/utils/keys.h>
+#include <spa/utils/names.h>
+#include <spa/utils/result.h>
+#include <spa/utils/string.h>
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/node/io.h>
+#include <spa/node/keys.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/param/video/type-info.h>
+#include <spa/param/param.h>
+#include <spa/param/port-config.h>
+#include <spa/pod/filter.h>
+#include <spa/debug/types.h>
+
+#include "video-ops.h"
+
+#undef SPA_LOG_TOPIC_DEFAULT
+#define SPA_LOG_TOPIC_DEFAULT &log_topic
+SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.videoconvert");
+
+#define MAX_BUFFERS	32
+#define MAX_ALIGN	VIDEO_OPS_MAX_ALIGN
+#define MAX_SIZE	8192
+
+#define DEFAULT_WIDTH	320
+#define DEFAULT_HEIGHT	240
+
+struct buffer {
+	uint32_t id;
+#define BUFFER_FLAG_OUT	(1<<0)
+	uint32_t flags;
+	struct spa_list link;
+	struct spa_buffer *buf;
+	struct spa_meta_header *h;
+};
+
+struct port {
+	enum spa_direction direction;
+
+	uint64_t info_all;
+	struct spa_port_info info;
+#define IDX_EnumFormat	0
+#define IDX_Meta	1
+#define IDX_IO		2
+#define IDX_Format	3
+#define IDX_Buffers	4
+#define N_PORT_PARAMS	5
+	struct spa_param_info params[N_PORT_PARAMS];
+
+	struct spa_io_buffers *io;
+
+	bool have_format;
+	struct spa_video_info format;
+	/* the layout of the frames, also for dsp formats */
+	uint32_t video_format;
+	struct spa_rectangle size;
+	uint32_t stride;
+	uint32_t frame_size;
+
+	struct buffer buffers[MAX_BUFFERS];
+	uint32_t n_buffers;
+
+	struct spa_list queue;
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_node node;
+
+	struct spa_log *log;
+	struct spa_cpu *cpu;
+
+	uint32_t cpu_flags;
+	uint32_t max_align;
+
+	struct spa_io_position *io_position;
+
+	uint64_t info_all;
+	struct spa_node_info info;
+#define IDX_EnumPortConfig	0
+#define IDX_PortConfig		1
+#define IDX_Props		2
+#define N_NODE_PARAMS		3
+	struct spa_param_info params[N_NODE_PARAMS];
+
+	struct spa_hook_list hooks;
+
+	/* the port facing the graph, the other port faces the follower */
+	enum spa_direction direction;
+	enum spa_param_port_config_mode mode;
+
+	uint32_t scale_method;
+
+	struct port port[2];
+
+	unsigned int started:1;
+	unsigned int setup:1;
+
+	struct video_convert conv;
+};
+
+#define CHECK_PORT(this,d,p)	((p) == 0)
+#define GET_PORT(this,d,p)	(&this->port[d])
+#define GET_OTHER_PORT(this,d)	(&this->port[SPA_DIRECTION_REVERSE(d)])
+
+#define PORT_IS_DSP(this,d)	((d) == (this)->direction && \
+				 (this)->mode == SPA_PARAM_PORT_CONFIG_MODE_dsp)
+
+static const uint32_t video_formats[] = {
+	SPA_VIDEO_FORMAT_I420,
+	SPA_VIDEO_FORMAT_YV12,
+	SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_NV21,
+	SPA_VIDEO_FORMAT_YUY2,
+	SPA_VIDEO_FORMAT_UYVY,
+	SPA_VIDEO_FORMAT_YVYU,
+	SPA_VIDEO_FORMAT_RGBA,
+	SPA_VIDEO_FORMAT_BGRA,
+	SPA_VIDEO_FORMAT_ARGB,
+	SPA_VIDEO_FORMAT_ABGR,
+	SPA_VIDEO_FORMAT_RGBx,
+	SPA_VIDEO_FORMAT_BGRx,
+	SPA_VIDEO_FORMAT_xRGB,
+	SPA_VIDEO_FORMAT_xBGR,
+	SPA_VIDEO_FORMAT_RGB,
+	SPA_VIDEO_FORMAT_BGR,
+	SPA_VIDEO_FORMAT_GRAY8,
+	SPA_VIDEO_FORMAT_RGBA_F32,
+};
+
+static const char *scale_method_name(uint32_t method)
+{
+	return method == VIDEO_SCALE_METHOD_AREA ? "area" : "bilinear";
+}
+
+static int videoconvert_set_param(struct impl *this, const char *k, const char *s)
+{
+	if (spa_streq(k, "scale.method")) {
+		if (spa_streq(s, "area"))
+			this->scale_method = VIDEO_SCALE_METHOD_AREA;
+		else
+			this->scale_method = VIDEO_SCALE_METHOD_BILINEAR;
+	} else
+		return 0;
+	return 1;
+}
+
+static int parse_prop_params(struct impl *this, struct spa_pod *params)
+{
+	struct spa_pod_parser prs;
+	struct spa_pod_frame f;
+	int changed = 0;
+
+	spa_pod_parser_pod(&prs, params);
+	if (spa_pod_parser_push_struct(&prs, &f) < 0)
+		return 0;
+
+	while (true) {
+		const char *name;
+		struct spa_pod *pod;
+		char value[512];
+
+		if (spa_pod_parser_get_string(&prs, &name) < 0)
+			break;
+
+		if (spa_pod_parser_get_pod(&prs, &pod) < 0)
+			break;
+
+		if (!spa_pod_is_string(pod))
+			continue;
+
+		spa_pod_copy_string(pod, sizeof(value), value);
+		spa_log_info(this->log, "key:'%s' val:'%s'", name, value);
+		changed += videoconvert_set_param(this, name, value);
+	}
+	return changed;
+}
+
+static int apply_props(struct impl *this, const struct spa_pod *param)
+{
+	struct spa_pod_prop *prop;
+	struct spa_pod_object *obj = (struct spa_pod_object *) param;
+	int changed = 0;
+
+	SPA_POD_OBJECT_FOREACH(obj, prop) {
+		switch (prop->key) {
+		case SPA_PROP_params:
+			changed += parse_prop_params(this, &prop->value);
+			break;
+		default:
+			break;
+		}
+	}
+	/* the new scale method is used the next time the conversion is
+	 * set up */
+	return changed;
+}
+
+static void emit_node_info(struct impl *this, bool full)
+{
+	uint64_t old = full ? this->info.change_mask : 0;
+	if (full)
+		this->info.change_mask = this->info_all;
+	if (this->info.change_mask) {
+		spa_node_emit_info(&this->hooks, &this->info);
+		this->info.change_mask = old;
+	}
+}
+
+static void emit_port_info(struct impl *this, struct port *port, bool full)
+{
+	uint64_t old = full ? port->info.change_mask : 0;
+	if (full)
+		port->info.change_mask = port->info_all;
+	if (port->info.change_mask) {
+		struct spa_dict_item items[1];
+		uint32_t n_items = 0;
+
+		if (PORT_IS_DSP(this, port->direction))
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_FORMAT_DSP, "32 bit float RGBA video");
+		port->info.props = &SPA_DICT_INIT(items, n_items);
+
+		spa_node_emit_port_info(&this->hooks,
+				port->direction, 0, &port->info);
+		port->info.change_mask = old;
+	}
+}
+
+static int impl_node_enum_params(void *object, int seq,
+				 uint32_t id, uint32_t start, uint32_t num,
+				 const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumPortConfig:
+	{
+		enum spa_param_port_config_mode mode;
+
+		switch (result.index) {
+		case 0:
+			mode = SPA_PARAM_PORT_CONFIG_MODE_convert;
+			break;
+		case 1:
+			mode = SPA_PARAM_PORT_CONFIG_MODE_dsp;
+			break;
+		default:
+			return 0;
+		}
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamPortConfig, id,
+			SPA_PARAM_PORT_CONFIG_direction, SPA_POD_CHOICE_ENUM_Id(3,
+					this->direction, SPA_DIRECTION_INPUT, SPA_DIRECTION_OUTPUT),
+			SPA_PARAM_PORT_CONFIG_mode,      SPA_POD_Id(mode));
+		break;
+	}
+	case SPA_PARAM_PortConfig:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamPortConfig, id,
+				SPA_PARAM_PORT_CONFIG_direction, SPA_POD_Id(this->direction),
+				SPA_PARAM_PORT_CONFIG_mode,      SPA_POD_Id(this->mode));
+			break;
+		default:
+			return 0;
+		}
+		break;
+	case SPA_PARAM_Props:
+	{
+		struct spa_pod_frame f[2];
+
+		switch (result.index) {
+		case 0:
+			spa_pod_builder_push_object(&b, &f[0],
+					SPA_TYPE_OBJECT_Props, id);
+			spa_pod_builder_prop(&b, SPA_PROP_params, 0);
+			spa_pod_builder_push_struct(&b, &f[1]);
+			spa_pod_builder_string(&b, "scale.method");
+			spa_pod_builder_string(&b, scale_method_name(this->scale_method));
+			spa_pod_builder_pop(&b, &f[1]);
+			param = spa_pod_builder_pop(&b, &f[0]);
+			break;
+		default:
+			return 0;
+		}
+		break;
+	}
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	switch (id) {
+	case SPA_IO_Position:
+		if (size > 0 && size < sizeof(struct spa_io_position))
+			return -EINVAL;
+		this->io_position = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static int reconfigure_mode(struct impl *this, enum spa_param_port_config_mode mode,
+		enum spa_direction direction)
+{
+	struct port *port;
+
+	switch (mode) {
+	case SPA_PARAM_PORT_CONFIG_MODE_none:
+	case SPA_PARAM_PORT_CONFIG_MODE_convert:
+	case SPA_PARAM_PORT_CONFIG_MODE_dsp:
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	if (this->mode == mode && this->direction == direction)
+		return 0;
+
+	spa_log_debug(this->log, "%p: port config direction:%d mode:%d",
+			this, direction, mode);
+
+	/* the dsp port changed, the formats of both ports need to be
+	 * enumerated again */
+	port = GET_PORT(this, this->direction, 0);
+	port->params[IDX_EnumFormat].flags ^= SPA_PARAM_INFO_SERIAL;
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS | SPA_PORT_CHANGE_MASK_PROPS;
+
+	this->direction = direction;
+	this->mode = mode;
+
+	port = GET_PORT(this, this->direction, 0);
+	port->params[IDX_EnumFormat].flags ^= SPA_PARAM_INFO_SERIAL;
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS | SPA_PORT_CHANGE_MASK_PROPS;
+
+	this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+	this->params[IDX_PortConfig].flags ^= SPA_PARAM_INFO_SERIAL;
+
+	emit_node_info(this, false);
+	emit_port_info(this, &this->port[SPA_DIRECTION_INPUT], false);
+	emit_port_info(this, &this->port[SPA_DIRECTION_OUTPUT], false);
+
+	return 0;
+}
+
+static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
+			       const struct spa_pod *param)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	if (param == NULL)
+		return 0;
+
+	switch (id) {
+	case SPA_PARAM_PortConfig:
+	{
+		enum spa_direction direction;
+		enum spa_param_port_config_mode mode;
+
+		if (spa_pod_parse_object(param,
+				SPA_TYPE_OBJECT_ParamPortConfig, NULL,
+				SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(&direction),
+				SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(&mode)) < 0)
+			return -EINVAL;
+
+		if (direction > SPA_DIRECTION_OUTPUT)
+			return -EINVAL;
+
+		return reconfigure_mode(this, mode, direction);
+	}
+	case SPA_PARAM_Props:
+		if (apply_props(this, param) > 0) {
+			this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+			this->params[IDX_Props].flags ^= SPA_PARAM_INFO_SERIAL;
+			emit_node_info(this, false);
+		}
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static uint32_t get_color_matrix(struct impl *this)
+{
+	struct port *port;
+	uint32_t i;
+
+	for (i = 0; i < 2; i++) {
+		port = &this->port[i];
+		if (port->format.media_subtype != SPA_MEDIA_SUBTYPE_raw)
+			continue;
+		switch (port->format.info.raw.color_matrix) {
+		case SPA_VIDEO_COLOR_MATRIX_BT709:
+			return VIDEO_MATRIX_BT709;
+		case SPA_VIDEO_COLOR_MATRIX_BT601:
+			return VIDEO_MATRIX_BT601;
+		default:
+			break;
+		}
+	}
+	/* like most other software, assume HD content is BT.709 when the
+	 * matrix is not known */
+	port = &this->port[SPA_DIRECTION_INPUT];
+	return port->size.height >= 720 ? VIDEO_MATRIX_BT709 : VIDEO_MATRIX_BT601;
+}
+
+static int setup_convert(struct impl *this)
+{
+	struct port *in, *out;
+	int res;
+
+	if (this->setup)
+		return 0;
+
+	in = GET_PORT(this, SPA_DIRECTION_INPUT, 0);
+	out = GET_PORT(this, SPA_DIRECTION_OUTPUT, 0);
+
+	if (!in->have_format || !out->have_format)
+		return -EIO;
+
+	spa_zero(this->conv);
+	this->conv.src_fmt = in->video_format;
+	this->conv.src_width = in->size.width;
+	this->conv.src_height = in->size.height;
+	this->conv.dst_fmt = out->video_format;
+	this->conv.dst_width = out->size.width;
+	this->conv.dst_height = out->size.height;
+	this->conv.matrix = get_color_matrix(this);
+	this->conv.scale_method = this->scale_method;
+	this->conv.cpu_flags = this->cpu_flags;
+
+	if ((res = video_convert_init(&this->conv)) < 0) {
+		spa_log_error(this->log, "%p: can't convert %s %dx%d -> %s %dx%d: %s", this,
+				spa_debug_type_find_short_name(spa_type_video_format, in->video_format),
+				in->size.width, in->size.height,
+				spa_debug_type_find_short_name(spa_type_video_format, out->video_format),
+				out->size.width, out->size.height, spa_strerror(res));
+		return res;
+	}
+
+	spa_log_info(this->log, "%p: %s %dx%d -> %s %dx%d scale:%s %08x:%08x passthrough:%d %s", this,
+			spa_debug_type_find_short_name(spa_type_video_format, in->video_format),
+			in->size.width, in->size.height,
+			spa_debug_type_find_short_name(spa_type_video_format, out->video_format),
+			out->size.width, out->size.height,
+			scale_method_name(this->scale_method),
+			this->cpu_flags, this->conv.cpu_flags, this->conv.is_passthrough,
+			this->conv.func_name);
+
+	this->setup = true;
+	return 0;
+}
+
+static void free_convert(struct impl *this)
+{
+	if (this->setup) {
+		video_convert_free(&this->conv);
+		this->setup = false;
+	}
+}
+
+static int impl_node_send_command(void *object, const struct spa_command *command)
+{
+	struct impl *this = object;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(command != NULL, -EINVAL);
+
+	switch (SPA_NODE_COMMAND_ID(command)) {
+	case SPA_NODE_COMMAND_Start:
+		if (this->started)
+			return 0;
+		if ((res = setup_convert(this)) < 0)
+			return res;
+		this->started = true;
+		break;
+	case SPA_NODE_COMMAND_Suspend:
+		free_convert(this);
+		SPA_FALLTHROUGH;
+	case SPA_NODE_COMMAND_Pause:
+		this->started = false;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
+static int
+impl_node_add_listener(void *object,
+		struct spa_hook *listener,
+		const struct spa_node_events *events,
+		void *data)
+{
+	struct impl *this = object;
+	struct spa_hook_list save;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_hook_list_isolate(&this->hooks, &save, listener, events, data);
+
+	emit_node_info(this, true);
+	emit_port_info(this, &this->port[SPA_DIRECTION_INPUT], true);
+	emit_port_info(this, &this->port[SPA_DIRECTION_OUTPUT], true);
+
+	spa_hook_list_join(&this->hooks, &save);
+
+	return 0;
+}
+
+static int
+impl_node_set_callbacks(void *object,
+			const struct spa_node_callbacks *callbacks,
+			void *data)
+{
+	return 0;
+}
+
+static int impl_node_add_port(void *object, enum spa_direction direction, uint32_t port_id,
+		const struct spa_dict *props)
+{
+	return -ENOTSUP;
+}
+
+static int
+impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_id)
+{
+	return -ENOTSUP;
+}
+
+static struct spa_pod *build_raw_enum_format(struct impl *this, struct port *port,
+		struct spa_pod_builder *b)
+{
+	struct port *other = GET_OTHER_PORT(this, port->direction);
+	struct spa_pod_frame f[2];
+	uint32_t i, format = SPA_VIDEO_FORMAT_I420;
+	struct spa_rectangle size = SPA_RECTANGLE(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	struct spa_fraction framerate = SPA_FRACTION(25, 1);
+	bool have_framerate = false;
+
+	/* prefer the format of the other port so that we can copy */
+	if (other->have_format) {
+		format = other->video_format;
+		size = other->size;
+		if (other->format.media_subtype == SPA_MEDIA_SUBTYPE_raw &&
+		    other->format.info.raw.framerate.denom != 0) {
+			framerate = other->format.info.raw.framerate;
+			have_framerate = true;
+		}
+	}
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b,
+		SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+		SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+		0);
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_format, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_id(b, format);
+	for (i = 0; i < SPA_N_ELEMENTS(video_formats); i++)
+		spa_pod_builder_id(b, video_formats[i]);
+	spa_pod_builder_pop(b, &f[1]);
+
+	spa_pod_builder_add(b,
+		SPA_FORMAT_VIDEO_size,		SPA_POD_CHOICE_RANGE_Rectangle(
+							&size,
+							&SPA_RECTANGLE(1, 1),
+							&SPA_RECTANGLE(MAX_SIZE, MAX_SIZE)),
+		0);
+	if (have_framerate) {
+		/* we don't change the framerate */
+		spa_pod_builder_add(b,
+			SPA_FORMAT_VIDEO_framerate,	SPA_POD_Fraction(&framerate),
+			0);
+	} else {
+		spa_pod_builder_add(b,
+			SPA_FORMAT_VIDEO_framerate,	SPA_POD_CHOICE_RANGE_Fraction(
+								&framerate,
+								&SPA_FRACTION(0, 1),
+								&SPA_FRACTION(INT32_MAX, 1)),
+			0);
+	}
+	return spa_pod_builder_pop(b, &f[0]);
+}
+
+static int port_enum_formats(struct impl *this, struct port *port, uint32_t index,
+		struct spa_pod **param, struct spa_pod_builder *b)
+{
+	if (index > 0)
+		return 0;
+
+	if (PORT_IS_DSP(this, port->direction)) {
+		struct spa_video_info_dsp info = {
+			.format = SPA_VIDEO_FORMAT_DSP_F32,
+		};
+		*param = spa_format_video_dsp_build(b, SPA_PARAM_EnumFormat, &info);
+	} else if (port->have_format) {
+		*param = spa_format_video_raw_build(b, SPA_PARAM_EnumFormat,
+				&port->format.info.raw);
+	} else {
+		*param = build_raw_enum_format(this, port, b);
+	}
+	return 1;
+}
+
+static int
+impl_node_port_enum_params(void *object, int seq,
+			enum spa_direction direction, uint32_t port_id,
+			uint32_t id, uint32_t start, uint32_t num,
+			const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct port *port;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[2048];
+	struct spa_pod *param;
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+	port = GET_PORT(this, direction, port_id);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumFormat:
+		if ((res = port_enum_formats(this, port, result.index, &param, &b)) <= 0)
+			return res;
+		break;
+
+	case SPA_PARAM_Format:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		if (port->format.media_subtype == SPA_MEDIA_SUBTYPE_dsp)
+			param = spa_format_video_dsp_build(&b, id, &port->format.info.dsp);
+		else
+			param = spa_format_video_raw_build(&b, id, &port->format.info.raw);
+		break;
+
+	case SPA_PARAM_Buffers:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, id,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_CHOICE_RANGE_Int(
+							port->frame_size, port->frame_size, INT32_MAX),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->stride),
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(this->max_align));
+		break;
+
+	case SPA_PARAM_Meta:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, id,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	case SPA_PARAM_IO:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamIO, id,
+				SPA_PARAM_IO_id,   SPA_POD_Id(SPA_IO_Buffers),
+				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_buffers)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int clear_buffers(struct impl *this, struct port *port)
+{
+	if (port->n_buffers > 0) {
+		spa_log_debug(this->log, "%p: clear buffers %p", this, port);
+		port->n_buffers = 0;
+		spa_list_init(&port->queue);
+	}
+	return 0;
+}
+
+static int port_parse_format(struct impl *this, struct port *port,
+		const struct spa_pod *format, struct spa_video_info *info)
+{
+	int res;
+
+	if ((res = spa_format_parse(format, &info->media_type, &info->media_subtype)) < 0)
+		return res;
+
+	if (info->media_type != SPA_MEDIA_TYPE_video)
+		return -EINVAL;
+
+	if (PORT_IS_DSP(this, port->direction)) {
+		if (info->media_subtype != SPA_MEDIA_SUBTYPE_dsp)
+			return -EINVAL;
+		if (spa_format_video_dsp_parse(format, &info->info.dsp) < 0)
+			return -EINVAL;
+		if (info->info.dsp.format != SPA_VIDEO_FORMAT_DSP_F32 ||
+		    SPA_FLAG_IS_SET(info->info.dsp.flags, SPA_VIDEO_FLAG_MODIFIER))
+			return -EINVAL;
+		if (this->io_position == NULL)
+			return -EIO;
+	} else {
+		if (info->media_subtype != SPA_MEDIA_SUBTYPE_raw)
+			return -EINVAL;
+		if (spa_format_video_raw_parse(format, &info->info.raw) < 0)
+			return -EINVAL;
+		if (SPA_FLAG_IS_SET(info->info.raw.flags, SPA_VIDEO_FLAG_MODIFIER))
+			return -EINVAL;
+		if (video_format_info_find(info->info.raw.format) == NULL)
+			return -ENOTSUP;
+		if (info->info.raw.size.width == 0 || info->info.raw.size.height == 0 ||
+		    info->info.raw.size.width > MAX_SIZE || info->info.raw.size.height > MAX_SIZE)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static int port_set_format(struct impl *this, struct port *port,
+			   uint32_t flags,
+			   const struct spa_pod *format)
+{
+	int res;
+
+	if (format == NULL) {
+		port->have_format = false;
+		clear_buffers(this, port);
+	} else {
+		struct spa_video_info info = { 0 };
+		uint32_t strides[VIDEO_MAX_PLANES], offsets[VIDEO_MAX_PLANES];
+
+		if ((res = port_parse_format(this, port, format, &info)) < 0) {
+			spa_log_error(this->log, "%p: can't parse format: %s",
+					this, spa_strerror(res));
+			return res;
+		}
+
+		if (info.media_subtype == SPA_MEDIA_SUBTYPE_dsp) {
+			port->video_format = SPA_VIDEO_FORMAT_RGBA_F32;
+			port->size = this->io_position->video.size;
+			port->stride = this->io_position->video.stride;
+		} else {
+			port->video_format = info.info.raw.format;
+			port->size = info.info.raw.size;
+			port->stride = 0;
+		}
+		if ((res = video_format_layout(port->video_format,
+				port->size.width, port->size.height,
+				port->stride, strides, offsets)) < 0)
+			return res;
+
+		port->stride = strides[0];
+		port->frame_size = res;
+		port->format = info;
+		port->have_format = true;
+
+		spa_log_debug(this->log, "%p: %d %s %dx%d stride:%d size:%d", this,
+				port->direction,
+				spa_debug_type_find_short_name(spa_type_video_format, port->video_format),
+				port->size.width, port->size.height,
+				port->stride, port->frame_size);
+	}
+	free_convert(this);
+	if (this->started && (res = setup_convert(this)) < 0)
+		return res;
+
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	if (port->have_format) {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
+		port->params[IDX_Buffers] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
+	} else {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+		port->params[IDX_Buffers] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	}
+	emit_port_info(this, port, false);
+
+	return 0;
+}
+
+static int
+impl_node_port_set_param(void *object,
+			 enum spa_direction direction, uint32_t port_id,
+			 uint32_t id, uint32_t flags,
+			 const struct spa_pod *param)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	switch (id) {
+	case SPA_PARAM_Format:
+		return port_set_format(this, port, flags, param);
+	default:
+		return -ENOENT;
+	}
+}
+
+static inline void queue_buffer(struct impl *this, struct port *port, uint32_t id)
+{
+	struct buffer *b = &port->buffers[id];
+
+	if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUT)) {
+		spa_log_trace_fp(this->log, "%p: queue buffer %d", this, id);
+		SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUT);
+		spa_list_append(&port->queue, &b->link);
+	}
+}
+
+static inline struct buffer *dequeue_buffer(struct impl *this, struct port *port)
+{
+	struct buffer *b;
+
+	if (spa_list_is_empty(&port->queue))
+		return NULL;
+
+	b = spa_list_first(&port->queue, struct buffer, link);
+	spa_list_remove(&b->link);
+	SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUT);
+	spa_log_trace_fp(this->log, "%p: dequeue buffer %d", this, b->id);
+	return b;
+}
+
+static int
+impl_node_port_use_buffers(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   struct spa_buffer **buffers,
+			   uint32_t n_buffers)
+{
+	struct impl *this = object;
+	struct port *port;
+	uint32_t i, j;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_log_debug(this->log, "%p: use buffers %d on port %d:%d",
+			this, n_buffers, direction, port_id);
+
+	clear_buffers(this, port);
+
+	if (n_buffers > 0 && !port->have_format)
+		return -EIO;
+	if (n_buffers > MAX_BUFFERS)
+		return -ENOSPC;
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b = &port->buffers[i];
+		struct spa_data *d = buffers[i]->datas;
+
+		b->id = i;
+		b->flags = BUFFER_FLAG_OUT;
+		b->buf = buffers[i];
+		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+
+		if (buffers[i]->n_datas == 0) {
+			spa_log_error(this->log, "%p: no data on buffer %d", this, i);
+			return -EINVAL;
+		}
+		for (j = 0; j < buffers[i]->n_datas; j++) {
+			if (d[j].data == NULL) {
+				spa_log_error(this->log, "%p: invalid memory %d on buffer %d %d %p",
+						this, j, i, d[j].type, d[j].data);
+				return -EINVAL;
+			}
+			if (!SPA_IS_ALIGNED(d[j].data, this->max_align)) {
+				spa_log_warn(this->log, "%p: memory %d on buffer %d not aligned",
+						this, j, i);
+			}
+		}
+		if (direction == SPA_DIRECTION_OUTPUT)
+			queue_buffer(this, port, i);
+	}
+	port->n_buffers = n_buffers;
+
+	return 0;
+}
+
+static int
+impl_node_port_set_io(void *object,
+		      enum spa_direction direction,
+		      uint32_t port_id,
+		      uint32_t id,
+		      void *data, size_t size)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	switch (id) {
+	case SPA_IO_Buffers:
+		if (data && size < sizeof(struct spa_io_buffers))
+			return -EINVAL;
+		port->io = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, SPA_DIRECTION_OUTPUT, port_id), -EINVAL);
+
+	port = GET_PORT(this, SPA_DIRECTION_OUTPUT, port_id);
+	spa_return_val_if_fail(buffer_id < port->n_buffers, -EINVAL);
+
+	queue_buffer(this, port, buffer_id);
+
+	return 0;
+}
+
+/* Map the planes of a buffer to a frame. Input buffers either have one
+ * data block for all planes or a data block per plane, output buffers
+ * always use one block. Returns the size of the frame or a negative error
+ * when the buffer is too small. */
+static int port_map_frame(struct impl *this, struct port *port, struct buffer *b,
+		struct video_frame *f, bool input)
+{
+	struct spa_buffer *buf = b->buf;
+	struct spa_data *d = buf->datas;
+	const struct video_format_info *info;
+	uint32_t i, offset, stride, strides[VIDEO_MAX_PLANES], offsets[VIDEO_MAX_PLANES];
+	int size;
+
+	if ((info = video_format_info_find(port->video_format)) == NULL)
+		return -ENOTSUP;
+
+	f->width = port->size.width;
+	f->height = port->size.height;
+
+	offset = input ? SPA_MIN(d[0].chunk->offset, d[0].maxsize) : 0;
+	stride = input && d[0].chunk->stride > 0 ? (uint32_t)d[0].chunk->stride : port->stride;
+
+	if ((size = video_format_layout(port->video_format, f->width, f->height,
+					stride, strides, offsets)) < 0)
+		return size;
+
+	if (input && info->n_planes > 1 && buf->n_datas >= info->n_planes) {
+		for (i = 0; i < info->n_planes; i++) {
+			uint32_t offs = SPA_MIN(d[i].chunk->offset, d[i].maxsize);
+			uint64_t plane_size;
+
+			/* every plane has its own stride, the size of the plane
+			 * follows from that and not from the layout of plane 0 */
+			if (d[i].chunk->stride > 0)
+				strides[i] = d[i].chunk->stride;
+			if (strides[i] < video_format_row_bytes(info, i, f->width))
+				return -EINVAL;
+			plane_size = (uint64_t)strides[i] * video_format_rows(info, i, f->height);
+			if (plane_size > d[i].maxsize - offs)
+				return -ENOSPC;
+			f->data[i] = SPA_PTROFF(d[i].data, offs, void);
+			f->stride[i] = strides[i];
+		}
+		return size;
+	}
+	if (offset + size > d[0].maxsize)
+		return -ENOSPC;
+
+	for (i = 0; i < VIDEO_MAX_PLANES; i++) {
+		f->data[i] = SPA_PTROFF(d[0].data, offset + offsets[i], void);
+		f->stride[i] = strides[i];
+	}
+	return size;
+}
+
+static int impl_node_process(void *object)
+{
+	struct impl *this = object;
+	struct port *inport, *outport;
+	struct spa_io_buffers *inio, *outio;
+	struct buffer *inb, *outb;
+	struct video_frame src, dst;
+	struct spa_data *d;
+	int size;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	inport = GET_PORT(this, SPA_DIRECTION_INPUT, 0);
+	outport = GET_PORT(this, SPA_DIRECTION_OUTPUT, 0);
+	inio = inport->io;
+	outio = outport->io;
+
+	spa_return_val_if_fail(inio != NULL, -EIO);
+	spa_return_val_if_fail(outio != NULL, -EIO);
+
+	spa_log_trace_fp(this->log, "%p: status %p %d %d -> %p %d %d", this,
+			inio, inio->status, inio->buffer_id,
+			outio, outio->status, outio->buffer_id);
+
+	if (SPA_UNLIKELY(outio->status == SPA_STATUS_HAVE_DATA))
+		return SPA_STATUS_HAVE_DATA;
+
+	/* recycle */
+	if (SPA_LIKELY(outio->buffer_id < outport->n_buffers)) {
+		queue_buffer(this, outport, outio->buffer_id);
+		outio->buffer_id = SPA_ID_INVALID;
+	}
+	if (SPA_UNLIKELY(inio->status != SPA_STATUS_HAVE_DATA))
+		return outio->status = inio->status;
+
+	if (SPA_UNLIKELY(inio->buffer_id >= inport->n_buffers))
+		return inio->status = -EINVAL;
+
+	if (SPA_UNLIKELY(!this->setup))
+		return -EIO;
+
+	if (SPA_UNLIKELY((outb = dequeue_buffer(this, outport)) == NULL)) {
+		spa_log_debug(this->log, "%p: out of buffers", this);
+		return -EPIPE;
+	}
+	inb = &inport->buffers[inio->buffer_id];
+
+	if (SPA_UNLIKELY(port_map_frame(this, inport, inb, &src, true) < 0)) {
+		spa_log_warn(this->log, "%p: input buffer %d too small", this, inb->id);
+		queue_buffer(this, outport, outb->id);
+		inio->status = SPA_STATUS_NEED_DATA;
+		return SPA_STATUS_NEED_DATA;
+	}
+	if (SPA_UNLIKELY((size = port_map_frame(this, outport, outb, &dst, false)) < 0)) {
+		spa_log_warn(this->log, "%p: output buffer %d too small", this, outb->id);
+		queue_buffer(this, outport, outb->id);
+		inio->status = SPA_STATUS_NEED_DATA;
+		return SPA_STATUS_NEED_DATA;
+	}
+
+	video_convert_process(&this->conv, &dst, &src);
+
+	d = outb->buf->datas;
+	d[0].chunk->offset = 0;
+	d[0].chunk->size = size;
+	d[0].chunk->stride = dst.stride[0];
+	d[0].chunk->flags = 0;
+
+	if (inb->h && outb->h)
+		*outb->h = *inb->h;
+
+	inio->status = SPA_STATUS_NEED_DATA;
+	outio->buffer_id = outb->id;
+	outio->status = SPA_STATUS_HAVE_DATA;
+
+	return SPA_STATUS_NEED_DATA | SPA_STATUS_HAVE_DATA;
+}
+
+static const struct spa_node_methods impl_node = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = impl_node_add_listener,
+	.set_callbacks = impl_node_set_callbacks,
+	.enum_params = impl_node_enum_params,
+	.set_param = impl_node_set_param,
+	.set_io = impl_node_set_io,
+	.send_command = impl_node_send_command,
+	.add_port = impl_node_add_port,
+	.remove_port = impl_node_remove_port,
+	.port_enum_params = impl_node_port_enum_params,
+	.port_set_param = impl_node_port_set_param,
+	.port_use_buffers = impl_node_port_use_buffers,
+	.port_set_io = impl_node_port_set_io,
+	.port_reuse_buffer = impl_node_port_reuse_buffer,
+	.process = impl_node_process,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (spa_streq(type, SPA_TYPE_INTERFACE_Node))
+		*interface = &this->node;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	free_convert(this);
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static void init_port(struct impl *this, enum spa_direction direction)
+{
+	struct port *port = GET_PORT(this, direction, 0);
+
+	port->direction = direction;
+	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
+			SPA_PORT_CHANGE_MASK_PARAMS |
+			SPA_PORT_CHANGE_MASK_PROPS;
+	port->info = SPA_PORT_INFO_INIT();
+	port->info.flags = SPA_PORT_FLAG_NO_REF;
+	port->params[IDX_EnumFormat] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port->params[IDX_Meta] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
+	port->params[IDX_IO] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[IDX_Buffers] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->info.params = port->params;
+	port->info.n_params = N_PORT_PARAMS;
+	spa_list_init(&port->queue);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *this;
+	uint32_t i;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	this = (struct impl *) handle;
+
+	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	spa_log_topic_init(this->log, &log_topic);
+
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->max_align = MAX_ALIGN;
+	if (this->cpu) {
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
+		this->max_align = SPA_MIN(MAX_ALIGN, spa_cpu_get_max_align(this->cpu));
+	}
+
+	for (i = 0; info && i < info->n_items; i++) {
+		const char *k = info->items[i].key;
+		const char *s = info->items[i].value;
+		videoconvert_set_param(this, k, s);
+	}
+
+	spa_hook_list_init(&this->hooks);
+
+	this->node.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE,
+			&impl_node, this);
+
+	this->direction = SPA_DIRECTION_OUTPUT;
+	this->mode = SPA_PARAM_PORT_CONFIG_MODE_convert;
+
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS |
+			SPA_NODE_CHANGE_MASK_PARAMS;
+	this->info = SPA_NODE_INFO_INIT();
+	this->info.max_input_ports = 1;
+	this->info.max_output_ports = 1;
+	this->info.flags = SPA_NODE_FLAG_RT;
+	this->params[IDX_EnumPortConfig] = SPA_PARAM_INFO(SPA_PARAM_EnumPortConfig, SPA_PARAM_INFO_READ);
+	this->params[IDX_PortConfig] = SPA_PARAM_INFO(SPA_PARAM_PortConfig, SPA_PARAM_INFO_READWRITE);
+	this->params[IDX_Props] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
+	this->info.params = this->params;
+	this->info.n_params = N_NODE_PARAMS;
+
+	init_port(this, SPA_DIRECTION_INPUT);
+	init_port(this, SPA_DIRECTION_OUTPUT);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_Node,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	switch (*index) {
+	case 0:
+		*info = &impl_interfaces[*index];
+		break;
+	default:
+		return 0;
+	}
+	(*index)++;
+	return 1;
+}
+
+static const struct spa_dict_item info_items[] = {
+	{ SPA_KEY_FACTORY_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
+	{ SPA_KEY_FACTORY_DESCRIPTION, "Convert video pixel formats and sizes" },
+};
+
+static const struct spa_dict info = SPA_DICT_INIT_ARRAY(info_items);
+
+const struct spa_handle_factory spa_videoconvert_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_VIDEO_CONVERT,
+	&info,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info,
+};
@@ -0,0 +1,109 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/json.h>
+
+#define MAX_COUNT 20
+#define N_FRAGMENTS 1024
+
+static const char fragment[] =
+	"# Daemon config fragment, repeated to get a realistic size\n"
+	"context.properties = {\n"
+	"    default.clock.rate          = 48000\n"
+	"    default.clock.allowed-rates = [ 44100 48000 96000 ]\n"
+	"    #default.clock.quantum      = 1024\n"
+	"    core.daemon = true\n"
+	"    core.name   = \"pipewire-0\"\n"
+	"}\n"
+	"context.modules = [\n"
+	"    { name = libpipewire-module-rt\n"
+	"        args = { nice.level = -11 rt.prio = 88 }\n"
+	"        flags = [ ifexists nofail ]\n"
+	"    }\n"
+	"    { name = libpipewire-module-protocol-native\n"
+	"        args = { sockets = [ { name = \"pipewire-0\" } ] }\n"
+	"    }\n"
+	"]\n"
+	"pulse.rules = [\n"
+	"    { matches = [ { application.process.binary = \"~firefox|chromium\" } ]\n"
+	"        actions = { update-props = { pulse.min.quantum = \"1024/48000\" } }\n"
+	"    }\n"
+	"]\n";
+
+static int count_tokens(struct spa_json *iter)
+{
+	struct spa_json sub;
+	const char *value;
+	int len, count = 0;
+
+	while ((len = spa_json_next(iter, &value)) > 0) {
+		count++;
+		if (spa_json_is_container(value, len)) {
+			spa_json_enter(iter, &sub);
+			count += count_tokens(&sub);
+		}
+	}
+	return count;
+}
+
+static void test_parse(const char *data, size_t len, int expected)
+{
+	struct spa_json it;
+	struct timespec ts;
+	uint64_t t1, t2;
+	int i, count = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		spa_json_init(&it, data, len);
+		count += count_tokens(&it);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "%zu bytes: elapsed %"PRIu64" count %u = %f ns/byte %f MB/s\n",
+			len, t2 - t1, MAX_COUNT,
+			(t2 - t1) / ((double)MAX_COUNT * len),
+			((double)MAX_COUNT * len * SPA_NSEC_PER_SEC) / ((t2 - t1) * 1024.0 * 1024.0));
+
+	assert(count == expected * MAX_COUNT);
+}
+
+int main(int argc, char *argv[])
+{
+	struct spa_json it;
+	size_t frag_len = strlen(fragment), len = 0;
+	int i, expected;
+	char *data;
+
+	data = malloc(frag_len * N_FRAGMENTS + 1);
+	assert(data != NULL);
+	for (i = 0; i < N_FRAGMENTS; i++) {
+		memcpy(data + len, fragment, frag_len);
+		len += frag_len;
+	}
+	data[len] = '\0';
+
+	spa_json_init(&it, fragment, frag_len);
+	expected = count_tokens(&it);
+	assert(expected > 0);
+
+	/* warmup */
+	test_parse(data, len, expected * N_FRAGMENTS);
+
+	test_parse(data, len, expected * N_FRAGMENTS);
+
+	free(data);
+	return 0;
+}
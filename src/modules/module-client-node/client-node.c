@@ -949,6 +949,8 @@ static int impl_node_process(void *object)
 	n->rt.target.activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 	n->rt.target.activation->signal_time = SPA_TIMESPEC_TO_NSEC(&ts);
 
+	if (pw_node_activation_wakeup(n->rt.target.activation))
+		return SPA_STATUS_OK;
 	if (SPA_UNLIKELY(spa_system_eventfd_write(n->rt.target.system, n->rt.target.fd, 1) < 0))
 		pw_log_warn("%p: write failed %m", impl);
 
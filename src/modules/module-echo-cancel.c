@@ -92,9 +92,23 @@
  * - `source.props = {}`: properties to be passed to the source stream
  * - `sink.props = {}`: properties to be passed to the sink stream
  * - `playback.props = {}`: properties to be passed to the playback stream
+ * - `capture.groups = [ { capture.props = {} source.props = {} } ... ]`:
+ *                   create a capture and source stream pair for each
+ *                   entry, all cancelled against the same sink. The
+ *                   entries are merged with the top-level `capture.props`
+ *                   and `source.props`. The groups share the sink, the
+ *                   playback stream and the far-end delay buffer. Each
+ *                   group gets its own instance of the aec plugin, which
+ *                   analyses the far-end signal again, so the cost grows
+ *                   with the number of groups. All instances need the
+ *                   same number of far-end channels.
  * - `library.name = <str>`: the echo cancellation library  Currently supported:
  * `aec/libspa-aec-webrtc`. Leave unset to use the default method (`aec/libspa-aec-webrtc`).
  * - `aec.args = <str>`: arguments to pass to the echo cancellation method
+ * - `aec.async = <bool>`: run the echo canceller in a separate realtime worker thread
+ *                   instead of the data thread. This adds one
+ *                   block of latency to the source, which is reported in
+ *                   the latency params. Default false.
  * - `monitor.mode`: Instead of making a sink, make a stream that captures from
  *                   the monitor ports of the default sink.
  *
@@ -160,6 +174,8 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 #define MAX_BUFSIZE_MS 100
 #define DELAY_MS 0
 
+#define MAX_GROUPS 16
+
 static const struct spa_dict_item module_props[] = {
 	{ PW_KEY_MODULE_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
 	{ PW_KEY_MODULE_DESCRIPTION, "Echo Cancellation" },
@@ -172,13 +188,47 @@ static const struct spa_dict_item module_props[] = {
 				"( buffer.play_delay=<delay as fraction> ) "
 				"( library.name =<library name> ) "
 				"( aec.args=<aec arguments> ) "
+				"( aec.async=<run in worker thread> ) "
 				"( capture.props=<properties> ) "
 				"( source.props=<properties> ) "
+				"( capture.groups=<array of capture and source properties> ) "
 				"( sink.props=<properties> ) "
 				"( playback.props=<properties> ) " },
 	{ PW_KEY_MODULE_VERSION, PACKAGE_VERSION },
 };
 
+struct impl;
+
+struct group {
+	struct impl *impl;
+	uint32_t index;
+
+	struct pw_properties *capture_props;
+	struct pw_stream *capture;
+	struct spa_hook capture_listener;
+	struct spa_audio_info_raw capture_info;
+
+	struct pw_properties *source_props;
+	struct pw_stream *source;
+	struct spa_hook source_listener;
+	struct spa_audio_info_raw source_info;
+
+	/* every group has its own canceller, the gain control, noise
+	 * suppression and delay estimation of the groups are independent */
+	struct spa_handle *spa_handle;
+	struct spa_audio_aec *aec;
+
+	/* first channel of the group in the rec and out buffers */
+	uint32_t rec_offset;
+	uint32_t out_offset;
+
+	struct spa_ringbuffer rec_ring;
+	struct spa_ringbuffer out_ring;
+
+	unsigned int capture_ready:1;
+	unsigned int capture_active:1;
+};
+
 struct impl {
 	struct pw_context *context;
 
@@ -193,19 +243,14 @@ struct impl {
 	struct spa_audio_info_raw out_info;
 	struct spa_audio_info_raw play_info;
 
-	struct pw_properties *capture_props;
-	struct pw_stream *capture;
-	struct spa_hook capture_listener;
-	struct spa_audio_info_raw capture_info;
-
-	struct pw_properties *source_props;
-	struct pw_stream *source;
-	struct spa_hook source_listener;
-	struct spa_audio_info_raw source_info;
+	/* capture groups share the sink and the far-end buffer but not the
+	 * far-end analysis, every group has its own canceller. Their channels
+	 * are placed after each other in the rec and out buffers */
+	struct group groups[MAX_GROUPS];
+	uint32_t n_groups;
 
 	void *rec_buffer[SPA_AUDIO_MAX_CHANNELS];
 	uint32_t rec_ringsize;
-	struct spa_ringbuffer rec_ring;
 
 	struct pw_properties *playback_props;
 	struct pw_stream *playback;
@@ -223,21 +268,30 @@ struct impl {
 
 	void *out_buffer[SPA_AUDIO_MAX_CHANNELS];
 	uint32_t out_ringsize;
-	struct spa_ringbuffer out_ring;
 
+	/* the canceller of the first group, for the name, latency and props */
 	struct spa_audio_aec *aec;
 	uint32_t aec_blocksize;
 
-	unsigned int capture_ready:1;
+	/* aec.async: blocks to process are queued to the worker, which
+	 * writes the result to out_ring */
+	struct pw_data_loop *worker;
+	void *work_rec_buffer[SPA_AUDIO_MAX_CHANNELS];
+	void *work_play_buffer[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t work_ringsize;
+	struct spa_ringbuffer work_rec_ring;
+	struct spa_ringbuffer work_play_ring;
+
 	unsigned int sink_ready:1;
 
 	unsigned int do_disconnect:1;
+	unsigned int async:1;
+	unsigned int out_primed:1;
 
 	uint32_t max_buffer_size;
 	uint32_t buffer_delay;
 	uint32_t current_delay;
 
-	struct spa_handle *spa_handle;
 	struct spa_plugin_loader *loader;
 
 	bool monitor_mode;
@@ -249,7 +303,13 @@ struct impl {
 static inline void aec_run(struct impl *impl, const float *rec[], const float *play[],
 		float *out[], uint32_t n_samples)
 {
-	spa_audio_aec_run(impl->aec, rec, play, out, n_samples);
+	uint32_t g;
+
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
+		spa_audio_aec_run(grp->aec, &rec[grp->rec_offset], play,
+				&out[grp->out_offset], n_samples);
+	}
 
 #ifdef HAVE_SPA_PLUGINS
 	if (SPA_UNLIKELY(impl->wav_path[0])) {
@@ -293,6 +353,153 @@ static inline void aec_run(struct impl *impl, const float *rec[], const float *p
 #endif
 }
 
+static void aec_process_block(struct impl *impl, const float *rec[],
+		const float *play_delayed[], float *out[], uint32_t size)
+{
+	uint32_t i;
+
+	if (SPA_UNLIKELY (impl->current_delay < impl->buffer_delay)) {
+		uint32_t delay_left = impl->buffer_delay - impl->current_delay;
+		uint32_t silence_size;
+
+		/* don't run the canceller until play_buffer has been filled,
+		 * copy silence to output in the meantime */
+		silence_size = SPA_MIN(size, delay_left * sizeof(float));
+		for (i = 0; i < impl->out_info.channels; i++)
+			memset(out[i], 0, silence_size);
+		impl->current_delay += silence_size / sizeof(float);
+		pw_log_debug("current_delay %d", impl->current_delay);
+
+		if (silence_size != size) {
+			const float *pd[impl->play_info.channels];
+			float *o[impl->out_info.channels];
+
+			for (i = 0; i < impl->play_info.channels; i++)
+				pd[i] = play_delayed[i] + delay_left;
+			for (i = 0; i < impl->out_info.channels; i++)
+				o[i] = out[i] + delay_left;
+
+			aec_run(impl, rec, pd, o, size / sizeof(float) - delay_left);
+		}
+	} else {
+		/* run the canceller */
+		aec_run(impl, rec, play_delayed, out, size / sizeof(float));
+	}
+}
+
+static void write_out_ring(struct impl *impl, float *out[], uint32_t size)
+{
+	uint32_t g, i, oindex;
+	int32_t avail;
+
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
+
+		avail = spa_ringbuffer_get_write_index(&grp->out_ring, &oindex);
+		if (avail + size > impl->out_ringsize) {
+			uint32_t rindex, drop;
+
+			if (impl->worker != NULL) {
+				/* the reader is in another thread, we can't move
+				 * its index, drop this block instead */
+				pw_log_debug("output ringbuffer xrun %d + %u > %u, dropping block",
+						avail, size, impl->out_ringsize);
+				continue;
+			}
+
+			/* Drop enough so we have size bytes left */
+			drop = avail + size - impl->out_ringsize;
+			pw_log_debug("output ringbuffer xrun %d + %u > %u, dropping %u",
+					avail, size, impl->out_ringsize, drop);
+
+			spa_ringbuffer_get_read_index(&grp->out_ring, &rindex);
+			spa_ringbuffer_read_update(&grp->out_ring, rindex + drop);
+
+			avail += drop;
+		}
+
+		for (i = 0; i < grp->source_info.channels; i++) {
+			uint32_t c = grp->out_offset + i;
+			/* captured samples, with echo from sink */
+			spa_ringbuffer_write_data(&grp->out_ring, impl->out_buffer[c],
+					impl->out_ringsize, oindex % impl->out_ringsize,
+					(void *)out[c], size);
+		}
+
+		spa_ringbuffer_write_update(&grp->out_ring, oindex + size);
+	}
+}
+
+static int do_work(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	uint32_t i, rindex, pindex, bs = impl->aec_blocksize;
+	float rec_buf[impl->rec_info.channels][bs / sizeof(float)];
+	float play_buf[impl->play_info.channels][bs / sizeof(float)];
+	float out_buf[impl->out_info.channels][bs / sizeof(float)];
+	const float *rec[impl->rec_info.channels];
+	const float *play[impl->play_info.channels];
+	float *out[impl->out_info.channels];
+
+	if (bs == 0)
+		return 0;
+
+	for (i = 0; i < impl->rec_info.channels; i++)
+		rec[i] = &rec_buf[i][0];
+	for (i = 0; i < impl->play_info.channels; i++)
+		play[i] = &play_buf[i][0];
+	for (i = 0; i < impl->out_info.channels; i++)
+		out[i] = &out_buf[i][0];
+
+	while (spa_ringbuffer_get_read_index(&impl->work_rec_ring, &rindex) >= (int32_t)bs &&
+	    spa_ringbuffer_get_read_index(&impl->work_play_ring, &pindex) >= (int32_t)bs) {
+		for (i = 0; i < impl->rec_info.channels; i++)
+			spa_ringbuffer_read_data(&impl->work_rec_ring, impl->work_rec_buffer[i],
+					impl->work_ringsize, rindex % impl->work_ringsize,
+					(void *)rec[i], bs);
+		spa_ringbuffer_read_update(&impl->work_rec_ring, rindex + bs);
+
+		for (i = 0; i < impl->play_info.channels; i++)
+			spa_ringbuffer_read_data(&impl->work_play_ring, impl->work_play_buffer[i],
+					impl->work_ringsize, pindex % impl->work_ringsize,
+					(void *)play[i], bs);
+		spa_ringbuffer_read_update(&impl->work_play_ring, pindex + bs);
+
+		aec_process_block(impl, rec, play, out, bs);
+		write_out_ring(impl, out, bs);
+	}
+	return 0;
+}
+
+static void queue_work(struct impl *impl, const float *rec[], const float *play[],
+		uint32_t size)
+{
+	uint32_t i, rindex, pindex;
+	int32_t ravail, pavail;
+
+	ravail = spa_ringbuffer_get_write_index(&impl->work_rec_ring, &rindex);
+	pavail = spa_ringbuffer_get_write_index(&impl->work_play_ring, &pindex);
+
+	if (ravail + size > impl->work_ringsize || pavail + size > impl->work_ringsize) {
+		pw_log_debug("worker ringbuffer xrun %d/%d + %u > %u, dropping block",
+				ravail, pavail, size, impl->work_ringsize);
+	} else {
+		for (i = 0; i < impl->rec_info.channels; i++)
+			spa_ringbuffer_write_data(&impl->work_rec_ring, impl->work_rec_buffer[i],
+					impl->work_ringsize, rindex % impl->work_ringsize,
+					(void *)rec[i], size);
+		spa_ringbuffer_write_update(&impl->work_rec_ring, rindex + size);
+
+		for (i = 0; i < impl->play_info.channels; i++)
+			spa_ringbuffer_write_data(&impl->work_play_ring, impl->work_play_buffer[i],
+					impl->work_ringsize, pindex % impl->work_ringsize,
+					(void *)play[i], size);
+		spa_ringbuffer_write_update(&impl->work_play_ring, pindex + size);
+	}
+	pw_loop_invoke(pw_data_loop_get_loop(impl->worker), do_work, 0, NULL, 0, false, impl);
+}
+
 static void process(struct impl *impl)
 {
 	struct pw_buffer *cout;
@@ -306,7 +513,7 @@ static void process(struct impl *impl)
 	const float *play_delayed[impl->play_info.channels];
 	float *out[impl->out_info.channels];
 	struct spa_data *dd;
-	uint32_t i, size;
+	uint32_t g, i, size;
 	uint32_t rindex, pindex, oindex, pdindex, avail;
 
 	if (impl->playback != NULL && (pout = pw_stream_dequeue_buffer(impl->playback)) == NULL) {
@@ -316,19 +523,28 @@ static void process(struct impl *impl)
 
 	size = impl->aec_blocksize;
 
-	/* First read a block from the playback and capture ring buffers */
-	spa_ringbuffer_get_read_index(&impl->rec_ring, &rindex);
+	/* First read a block from the playback and capture ring buffers,
+	 * groups that did not capture anything are silent */
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
 
-	for (i = 0; i < impl->rec_info.channels; i++) {
-		/* captured samples, with echo from sink */
-		rec[i] = &rec_buf[i][0];
+		avail = spa_ringbuffer_get_read_index(&grp->rec_ring, &rindex);
 
-		spa_ringbuffer_read_data(&impl->rec_ring, impl->rec_buffer[i],
-				impl->rec_ringsize, rindex % impl->rec_ringsize,
-				(void*)rec[i], size);
+		for (i = 0; i < grp->capture_info.channels; i++) {
+			uint32_t c = grp->rec_offset + i;
+			/* captured samples, with echo from sink */
+			rec[c] = &rec_buf[c][0];
 
+			if (avail >= size)
+				spa_ringbuffer_read_data(&grp->rec_ring, impl->rec_buffer[c],
+						impl->rec_ringsize, rindex % impl->rec_ringsize,
+						(void*)rec[c], size);
+			else
+				memset(rec_buf[c], 0, size);
+		}
+		if (avail >= size)
+			spa_ringbuffer_read_update(&grp->rec_ring, rindex + size);
 	}
-	spa_ringbuffer_read_update(&impl->rec_ring, rindex + size);
 
 	for (i = 0; i < impl->out_info.channels; i++) {
 		/* filtered samples, without echo from sink */
@@ -368,107 +584,104 @@ static void process(struct impl *impl)
 	if (impl->playback != NULL)
 		pw_stream_queue_buffer(impl->playback, pout);
 
-	if (SPA_UNLIKELY (impl->current_delay < impl->buffer_delay)) {
-		uint32_t delay_left = impl->buffer_delay - impl->current_delay;
-		uint32_t silence_size;
-
-		/* don't run the canceller until play_buffer has been filled,
-		 * copy silence to output in the meantime */
-		silence_size = SPA_MIN(size, delay_left * sizeof(float));
-		for (i = 0; i < impl->out_info.channels; i++)
-			memset(out[i], 0, silence_size);
-		impl->current_delay += silence_size / sizeof(float);
-		pw_log_debug("current_delay %d", impl->current_delay);
-
-		if (silence_size != size) {
-			const float *pd[impl->play_info.channels];
-			float *o[impl->out_info.channels];
-
-			for (i = 0; i < impl->play_info.channels; i++)
-				pd[i] = play_delayed[i] + delay_left;
+	if (impl->worker != NULL) {
+		/* the worker runs the canceller, we pick up the output of
+		 * the previous blocks from out_ring below */
+		if (SPA_UNLIKELY(!impl->out_primed)) {
 			for (i = 0; i < impl->out_info.channels; i++)
-				o[i] = out[i] + delay_left;
-
-			aec_run(impl, rec, pd, o, size / sizeof(float) - delay_left);
+				memset(out[i], 0, size);
+			write_out_ring(impl, out, size);
+			impl->out_primed = true;
 		}
+		queue_work(impl, rec, play_delayed, size);
 	} else {
-		/* run the canceller */
-		aec_run(impl, rec, play_delayed, out, size / sizeof(float));
+		aec_process_block(impl, rec, play_delayed, out, size);
+		write_out_ring(impl, out, size);
 	}
 
-	/* Next, copy over the output to the output ringbuffer */
-	avail = spa_ringbuffer_get_write_index(&impl->out_ring, &oindex);
-	if (avail + size > impl->out_ringsize) {
-		uint32_t rindex, drop;
+	/* And finally take data from the output ringbuffers and make it
+	 * available on the sources */
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
 
-		/* Drop enough so we have size bytes left */
-		drop = avail + size - impl->out_ringsize;
-		pw_log_debug("output ringbuffer xrun %d + %u > %u, dropping %u",
-				avail, size, impl->out_ringsize, drop);
+		avail = spa_ringbuffer_get_read_index(&grp->out_ring, &oindex);
+		while (avail >= size) {
+			if ((cout = pw_stream_dequeue_buffer(grp->source)) == NULL) {
+				pw_log_debug("out of source buffers: %m");
+				break;
+			}
 
-		spa_ringbuffer_get_read_index(&impl->out_ring, &rindex);
-		spa_ringbuffer_read_update(&impl->out_ring, rindex + drop);
+			for (i = 0; i < grp->source_info.channels; i++) {
+				dd = &cout->buffer->datas[i];
+				spa_ringbuffer_read_data(&grp->out_ring,
+						impl->out_buffer[grp->out_offset + i],
+						impl->out_ringsize, oindex % impl->out_ringsize,
+						(void *)dd->data, size);
+				dd->chunk->offset = 0;
+				dd->chunk->size = size;
+				dd->chunk->stride = sizeof(float);
+			}
 
-		avail += drop;
-	}
+			pw_stream_queue_buffer(grp->source, cout);
 
-	for (i = 0; i < impl->out_info.channels; i++) {
-		/* captured samples, with echo from sink */
-		spa_ringbuffer_write_data(&impl->out_ring, impl->out_buffer[i],
-				impl->out_ringsize, oindex % impl->out_ringsize,
-				(void *)out[i], size);
+			oindex += size;
+			spa_ringbuffer_read_update(&grp->out_ring, oindex);
+			avail -= size;
+		}
 	}
 
-	spa_ringbuffer_write_update(&impl->out_ring, oindex + size);
-
-	/* And finally take data from the output ringbuffer and make it
-	 * available on the source */
-
-	avail = spa_ringbuffer_get_read_index(&impl->out_ring, &oindex);
-	while (avail >= size) {
-		if ((cout = pw_stream_dequeue_buffer(impl->source)) == NULL) {
-			pw_log_debug("out of source buffers: %m");
-			break;
-		}
+done:
+	impl->sink_ready = false;
+	for (g = 0; g < impl->n_groups; g++)
+		impl->groups[g].capture_ready = false;
+}
 
-		for (i = 0; i < impl->out_info.channels; i++) {
-			dd = &cout->buffer->datas[i];
-			spa_ringbuffer_read_data(&impl->out_ring, impl->out_buffer[i],
-					impl->out_ringsize, oindex % impl->out_ringsize,
-					(void *)dd->data, size);
-			dd->chunk->offset = 0;
-			dd->chunk->size = size;
-			dd->chunk->stride = sizeof(float);
-		}
+/* all streaming capture groups have a block, and at least one group */
+static bool captures_ready(struct impl *impl)
+{
+	uint32_t g;
+	bool ready = false;
+
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
+		if (grp->capture_ready)
+			ready = true;
+		else if (grp->capture_active)
+			return false;
+	}
+	return ready;
+}
 
-		pw_stream_queue_buffer(impl->source, cout);
+static bool captures_streaming(struct impl *impl)
+{
+	uint32_t g;
 
-		oindex += size;
-		spa_ringbuffer_read_update(&impl->out_ring, oindex);
-		avail -= size;
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
+		if (grp->capture != NULL &&
+		    pw_stream_get_state(grp->capture, NULL) == PW_STREAM_STATE_STREAMING)
+			return true;
 	}
-
-done:
-	impl->sink_ready = false;
-	impl->capture_ready = false;
+	return false;
 }
 
 static void capture_destroy(void *d)
 {
-	struct impl *impl = d;
-	spa_hook_remove(&impl->capture_listener);
-	impl->capture = NULL;
+	struct group *grp = d;
+	spa_hook_remove(&grp->capture_listener);
+	grp->capture = NULL;
 }
 
 static void capture_process(void *data)
 {
-	struct impl *impl = data;
+	struct group *grp = data;
+	struct impl *impl = grp->impl;
 	struct pw_buffer *buf;
 	struct spa_data *d;
 	uint32_t i, index, offs, size;
 	int32_t avail;
 
-	if ((buf = pw_stream_dequeue_buffer(impl->capture)) == NULL) {
+	if ((buf = pw_stream_dequeue_buffer(grp->capture)) == NULL) {
 		pw_log_debug("out of capture buffers: %m");
 		return;
 	}
@@ -477,7 +690,7 @@ static void capture_process(void *data)
 	offs = SPA_MIN(d->chunk->offset, d->maxsize);
 	size = SPA_MIN(d->chunk->size, d->maxsize - offs);
 
-	avail = spa_ringbuffer_get_write_index(&impl->rec_ring, &index);
+	avail = spa_ringbuffer_get_write_index(&grp->rec_ring, &index);
 
 	if (avail + size > impl->rec_ringsize) {
 		uint32_t rindex, drop;
@@ -487,8 +700,8 @@ static void capture_process(void *data)
 		pw_log_debug("capture ringbuffer xrun %d + %u > %u, dropping %u",
 				avail, size, impl->rec_ringsize, drop);
 
-		spa_ringbuffer_get_read_index(&impl->rec_ring, &rindex);
-		spa_ringbuffer_read_update(&impl->rec_ring, rindex + drop);
+		spa_ringbuffer_get_read_index(&grp->rec_ring, &rindex);
+		spa_ringbuffer_read_update(&grp->rec_ring, rindex + drop);
 
 		avail += drop;
 	}
@@ -501,58 +714,102 @@ static void capture_process(void *data)
 		pw_log_debug("Setting AEC block size to %u", impl->aec_blocksize);
 	}
 
-	for (i = 0; i < impl->rec_info.channels; i++) {
+	for (i = 0; i < grp->capture_info.channels; i++) {
 		/* captured samples, with echo from sink */
 		d = &buf->buffer->datas[i];
 
 		offs = SPA_MIN(d->chunk->offset, d->maxsize);
 		size = SPA_MIN(d->chunk->size, d->maxsize - offs);
 
-		spa_ringbuffer_write_data(&impl->rec_ring, impl->rec_buffer[i],
+		spa_ringbuffer_write_data(&grp->rec_ring, impl->rec_buffer[grp->rec_offset + i],
 				impl->rec_ringsize, index % impl->rec_ringsize,
 				SPA_PTROFF(d->data, offs, void), size);
 	}
 
-	spa_ringbuffer_write_update(&impl->rec_ring, index + size);
+	spa_ringbuffer_write_update(&grp->rec_ring, index + size);
 
 	if (avail + size >= impl->aec_blocksize) {
-		impl->capture_ready = true;
-		if (impl->sink_ready)
+		grp->capture_ready = true;
+		if (impl->sink_ready && captures_ready(impl))
 			process(impl);
 	}
 
-	pw_stream_queue_buffer(impl->capture, buf);
+	pw_stream_queue_buffer(grp->capture, buf);
+}
+
+static int do_aec_set_active(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	bool active = *(const bool*)data;
+	uint32_t g;
+	int res;
+
+	pw_log_debug("%p: %s %s", impl, active ? "activate" : "deactivate", impl->aec->name);
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
+		if (active)
+			res = spa_audio_aec_activate(grp->aec);
+		else
+			res = spa_audio_aec_deactivate(grp->aec);
+		if (res < 0 && res != -EOPNOTSUPP) {
+			pw_log_error("aec plugin %s %s failed: %s", grp->aec->name,
+					active ? "activate" : "deactivate", spa_strerror(res));
+		}
+	}
+	return 0;
+}
+
+static void aec_set_active(struct impl *impl, bool active)
+{
+	/* the worker might be running the canceller, change it from there */
+	if (impl->worker != NULL)
+		pw_loop_invoke(pw_data_loop_get_loop(impl->worker),
+				do_aec_set_active, 0, &active, sizeof(active), false, impl);
+	else
+		do_aec_set_active(NULL, false, 0, &active, sizeof(active), impl);
+}
+
+static int do_reset_delay(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	impl->current_delay = 0;
+	return 0;
+}
+
+static void reset_delay(struct impl *impl)
+{
+	/* current_delay is used by the worker when processing a block */
+	if (impl->worker != NULL)
+		pw_loop_invoke(pw_data_loop_get_loop(impl->worker),
+				do_reset_delay, 0, NULL, 0, false, impl);
+	else
+		impl->current_delay = 0;
 }
 
 static void capture_state_changed(void *data, enum pw_stream_state old,
 		enum pw_stream_state state, const char *error)
 {
-	struct impl *impl = data;
-	int res;
+	struct group *grp = data;
+	struct impl *impl = grp->impl;
 
 	switch (state) {
 	case PW_STREAM_STATE_PAUSED:
-		pw_stream_flush(impl->source, false);
-		pw_stream_flush(impl->capture, false);
+		pw_stream_flush(grp->source, false);
+		pw_stream_flush(grp->capture, false);
+		grp->capture_active = false;
 
 		if (old == PW_STREAM_STATE_STREAMING) {
-			if (pw_stream_get_state(impl->sink, NULL) != PW_STREAM_STATE_STREAMING) {
-				pw_log_debug("%p: deactivate %s", impl, impl->aec->name);
-				res = spa_audio_aec_deactivate(impl->aec);
-				if (res < 0 && res != -EOPNOTSUPP) {
-					pw_log_error("aec plugin %s deactivate failed: %s", impl->aec->name, spa_strerror(res));
-				}
-			}
+			if (pw_stream_get_state(impl->sink, NULL) != PW_STREAM_STATE_STREAMING &&
+			    !captures_streaming(impl))
+				aec_set_active(impl, false);
 		}
 		break;
 	case PW_STREAM_STATE_STREAMING:
-		if (pw_stream_get_state(impl->sink, NULL) == PW_STREAM_STATE_STREAMING) {
-			pw_log_debug("%p: activate %s", impl, impl->aec->name);
-			res = spa_audio_aec_activate(impl->aec);
-			if (res < 0 && res != -EOPNOTSUPP) {
-				pw_log_error("aec plugin %s activate failed: %s", impl->aec->name, spa_strerror(res));
-			}
-		}
+		grp->capture_active = true;
+		if (pw_stream_get_state(impl->sink, NULL) == PW_STREAM_STATE_STREAMING)
+			aec_set_active(impl, true);
 		break;
 	case PW_STREAM_STATE_UNCONNECTED:
 		pw_log_info("%p: capture unconnected", impl);
@@ -569,12 +826,13 @@ static void capture_state_changed(void *data, enum pw_stream_state old,
 static void source_state_changed(void *data, enum pw_stream_state old,
 		enum pw_stream_state state, const char *error)
 {
-	struct impl *impl = data;
+	struct group *grp = data;
+	struct impl *impl = grp->impl;
 
 	switch (state) {
 	case PW_STREAM_STATE_PAUSED:
-		pw_stream_flush(impl->source, false);
-		pw_stream_flush(impl->capture, false);
+		pw_stream_flush(grp->source, false);
+		pw_stream_flush(grp->capture, false);
 		break;
 	case PW_STREAM_STATE_UNCONNECTED:
 		pw_log_info("%p: source unconnected", impl);
@@ -588,14 +846,21 @@ static void source_state_changed(void *data, enum pw_stream_state old,
 	}
 }
 
-static void reset_buffers(struct impl *impl)
+static int do_reset_buffers(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
 {
-	uint32_t index, i;
+	struct impl *impl = user_data;
+	uint32_t index, i, g;
 
-	spa_ringbuffer_init(&impl->rec_ring);
+	for (g = 0; g < impl->n_groups; g++) {
+		spa_ringbuffer_init(&impl->groups[g].rec_ring);
+		spa_ringbuffer_init(&impl->groups[g].out_ring);
+	}
 	spa_ringbuffer_init(&impl->play_ring);
 	spa_ringbuffer_init(&impl->play_delayed_ring);
-	spa_ringbuffer_init(&impl->out_ring);
+	spa_ringbuffer_init(&impl->work_rec_ring);
+	spa_ringbuffer_init(&impl->work_play_ring);
+	impl->out_primed = false;
 
 	for (i = 0; i < impl->rec_info.channels; i++)
 		memset(impl->rec_buffer[i], 0, impl->rec_ringsize);
@@ -608,10 +873,23 @@ static void reset_buffers(struct impl *impl)
 	spa_ringbuffer_write_update(&impl->play_ring, index + (sizeof(float) * (impl->buffer_delay)));
 	spa_ringbuffer_get_read_index(&impl->play_ring, &index);
 	spa_ringbuffer_read_update(&impl->play_ring, index + (sizeof(float) * (impl->buffer_delay)));
+
+	return 0;
+}
+
+static void reset_buffers(struct impl *impl)
+{
+	/* with a worker, reset the rings when it is not processing a block */
+	if (impl->worker != NULL)
+		pw_loop_invoke(pw_data_loop_get_loop(impl->worker),
+				do_reset_buffers, 0, NULL, 0, true, impl);
+	else
+		do_reset_buffers(NULL, false, 0, NULL, 0, impl);
 }
 
-static void input_param_latency_changed(struct impl *impl, const struct spa_pod *param)
+static void input_param_latency_changed(struct group *grp, const struct spa_pod *param)
 {
+	struct impl *impl = grp->impl;
 	struct spa_latency_info latency;
 	uint8_t buffer[1024];
 	struct spa_pod_builder b;
@@ -620,13 +898,19 @@ static void input_param_latency_changed(struct impl *impl, const struct spa_pod
 	if (param == NULL || spa_latency_parse(param, &latency) < 0)
 		return;
 
+	if (impl->worker != NULL && latency.direction == SPA_DIRECTION_OUTPUT) {
+		/* the worker output is delayed by one block */
+		latency.min_rate += impl->aec_blocksize / sizeof(float);
+		latency.max_rate += impl->aec_blocksize / sizeof(float);
+	}
+
 	spa_pod_builder_init(&b, buffer, sizeof(buffer));
 	params[0] = spa_latency_build(&b, SPA_PARAM_Latency, &latency);
 
 	if (latency.direction == SPA_DIRECTION_INPUT)
-		pw_stream_update_params(impl->source, params, 1);
+		pw_stream_update_params(grp->source, params, 1);
 	else
-		pw_stream_update_params(impl->capture, params, 1);
+		pw_stream_update_params(grp->capture, params, 1);
 }
 
 static struct spa_pod* get_props_param(struct impl* impl, struct spa_pod_builder* b)
@@ -652,6 +936,7 @@ static int set_params(struct impl* impl, const struct spa_pod *params)
 {
 	struct spa_pod_parser prs;
 	struct spa_pod_frame f;
+	uint32_t g;
 
 	spa_pod_parser_pod(&prs, params);
 	if (spa_pod_parser_push_struct(&prs, &f) < 0)
@@ -682,7 +967,8 @@ static int set_params(struct impl* impl, const struct spa_pod *params)
 				sizeof(impl->wav_path), "%s", value);
 		}
 	}
-	spa_audio_aec_set_params(impl->aec, params);
+	for (g = 0; g < impl->n_groups; g++)
+		spa_audio_aec_set_params(impl->groups[g].aec, params);
 	return 1;
 }
 
@@ -705,7 +991,9 @@ static void props_changed(struct impl* impl, const struct spa_pod *param)
 	spa_pod_dynamic_builder_init(&b, buffer, sizeof(buffer), 4096);
 	params[0] = get_props_param(impl, &b.b);
 	if (params[0]) {
-		pw_stream_update_params(impl->capture, params, 1);
+		uint32_t g;
+		for (g = 0; g < impl->n_groups; g++)
+			pw_stream_update_params(impl->groups[g].capture, params, 1);
 		if (impl->playback != NULL)
 			pw_stream_update_params(impl->playback, params, 1);
 	}
@@ -714,7 +1002,8 @@ static void props_changed(struct impl* impl, const struct spa_pod *param)
 
 static void input_param_changed(void *data, uint32_t id, const struct spa_pod* param)
 {
-	struct impl* impl = data;
+	struct group *grp = data;
+	struct impl *impl = grp->impl;
 
 	switch (id) {
 	case SPA_PARAM_Format:
@@ -722,7 +1011,7 @@ static void input_param_changed(void *data, uint32_t id, const struct spa_pod* p
 			reset_buffers(impl);
 		break;
 	case SPA_PARAM_Latency:
-		input_param_latency_changed(impl, param);
+		input_param_latency_changed(grp, param);
 		break;
 	case SPA_PARAM_Props:
 		props_changed(impl, param);
@@ -740,9 +1029,9 @@ static const struct pw_stream_events capture_events = {
 
 static void source_destroy(void *d)
 {
-	struct impl *impl = d;
-	spa_hook_remove(&impl->source_listener);
-	impl->source = NULL;
+	struct group *grp = d;
+	spa_hook_remove(&grp->source_listener);
+	grp->source = NULL;
 }
 
 static const struct pw_stream_events source_events = {
@@ -761,9 +1050,8 @@ static void playback_state_changed(void *data, enum pw_stream_state old,
 		pw_stream_flush(impl->sink, false);
 		if (impl->playback != NULL)
 			pw_stream_flush(impl->playback, false);
-		if (old == PW_STREAM_STATE_STREAMING) {
-			impl->current_delay = 0;
-		}
+		if (old == PW_STREAM_STATE_STREAMING)
+			reset_delay(impl);
 		break;
 	case PW_STREAM_STATE_UNCONNECTED:
 		pw_log_info("%p: playback unconnected", impl);
@@ -781,7 +1069,6 @@ static void sink_state_changed(void *data, enum pw_stream_state old,
 		enum pw_stream_state state, const char *error)
 {
 	struct impl *impl = data;
-	int res;
 
 	switch (state) {
 	case PW_STREAM_STATE_PAUSED:
@@ -789,25 +1076,15 @@ static void sink_state_changed(void *data, enum pw_stream_state old,
 		if (impl->playback != NULL)
 			pw_stream_flush(impl->playback, false);
 		if (old == PW_STREAM_STATE_STREAMING) {
-			impl->current_delay = 0;
-
-			if (pw_stream_get_state(impl->capture, NULL) != PW_STREAM_STATE_STREAMING) {
-				pw_log_debug("%p: deactivate %s", impl, impl->aec->name);
-				res = spa_audio_aec_deactivate(impl->aec);
-				if (res < 0 && res != -EOPNOTSUPP) {
-					pw_log_error("aec plugin %s deactivate failed: %s", impl->aec->name, spa_strerror(res));
-				}
-			}
+			reset_delay(impl);
+
+			if (!captures_streaming(impl))
+				aec_set_active(impl, false);
 		}
 		break;
 	case PW_STREAM_STATE_STREAMING:
-		if (pw_stream_get_state(impl->capture, NULL) == PW_STREAM_STATE_STREAMING) {
-			pw_log_debug("%p: activate %s", impl, impl->aec->name);
-			res = spa_audio_aec_activate(impl->aec);
-			if (res < 0 && res != -EOPNOTSUPP) {
-				pw_log_error("aec plugin %s activate failed: %s", impl->aec->name, spa_strerror(res));
-			}
-		}
+		if (captures_streaming(impl))
+			aec_set_active(impl, true);
 		break;
 	case PW_STREAM_STATE_UNCONNECTED:
 		pw_log_info("%p: sink unconnected", impl);
@@ -921,7 +1198,7 @@ static void sink_process(void *data)
 
 	if (avail + size >= impl->aec_blocksize) {
 		impl->sink_ready = true;
-		if (impl->capture_ready)
+		if (captures_ready(impl))
 			process(impl);
 	}
 
@@ -960,26 +1237,31 @@ static int setup_streams(struct impl *impl)
 	uint32_t offsets[MAX_PARAMS];
 	const struct spa_pod *params[MAX_PARAMS];
 	struct spa_pod_dynamic_builder b;
+	uint32_t g;
 
-	impl->capture = pw_stream_new(impl->core,
-			"Echo-Cancel Capture", impl->capture_props);
-	impl->capture_props = NULL;
-	if (impl->capture == NULL)
-		return -errno;
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
+
+		grp->capture = pw_stream_new(impl->core,
+				"Echo-Cancel Capture", grp->capture_props);
+		grp->capture_props = NULL;
+		if (grp->capture == NULL)
+			return -errno;
 
-	pw_stream_add_listener(impl->capture,
-			&impl->capture_listener,
-			&capture_events, impl);
+		pw_stream_add_listener(grp->capture,
+				&grp->capture_listener,
+				&capture_events, grp);
 
-	impl->source = pw_stream_new(impl->core,
-			"Echo-Cancel Source", impl->source_props);
-	impl->source_props = NULL;
-	if (impl->source == NULL)
-		return -errno;
+		grp->source = pw_stream_new(impl->core,
+				"Echo-Cancel Source", grp->source_props);
+		grp->source_props = NULL;
+		if (grp->source == NULL)
+			return -errno;
 
-	pw_stream_add_listener(impl->source,
-			&impl->source_listener,
-			&source_events, impl);
+		pw_stream_add_listener(grp->source,
+				&grp->source_listener,
+				&source_events, grp);
+	}
 
 	if (impl->monitor_mode) {
 		impl->playback = NULL;
@@ -1010,7 +1292,7 @@ static int setup_streams(struct impl *impl)
 
 	if (n_params < MAX_PARAMS) {
 		offsets[n_params++] = b.b.state.offset;
-		spa_format_audio_raw_build(&b.b, SPA_PARAM_EnumFormat, &impl->capture_info);
+		spa_format_audio_raw_build(&b.b, SPA_PARAM_EnumFormat, &impl->groups[0].capture_info);
 	}
 	int nbr_of_external_props = spa_audio_aec_enum_props(impl->aec, 0, NULL);
 	for (int i = 0; i < nbr_of_external_props; i++) {
@@ -1033,35 +1315,42 @@ static int setup_streams(struct impl *impl)
 		get_props_param(impl, &b.b);
 	}
 
-	for (i = 0; i < n_params; i++)
-		params[i] = spa_pod_builder_deref(&b.b, offsets[i]);
+	for (g = 0; g < impl->n_groups; g++) {
+		struct group *grp = &impl->groups[g];
 
-	if ((res = pw_stream_connect(impl->capture,
-			PW_DIRECTION_INPUT,
-			PW_ID_ANY,
-			PW_STREAM_FLAG_AUTOCONNECT |
-			PW_STREAM_FLAG_MAP_BUFFERS |
-			PW_STREAM_FLAG_RT_PROCESS,
-			params, n_params)) < 0) {
-		spa_pod_dynamic_builder_clean(&b);
-		return res;
-	}
+		offsets[0] = b.b.state.offset;
+		spa_format_audio_raw_build(&b.b, SPA_PARAM_EnumFormat, &grp->capture_info);
 
-	offsets[0] = b.b.state.offset;
-	spa_format_audio_raw_build(&b.b, SPA_PARAM_EnumFormat, &impl->source_info);
+		for (i = 0; i < n_params; i++)
+			params[i] = spa_pod_builder_deref(&b.b, offsets[i]);
 
-	for (i = 0; i < n_params; i++)
-		params[i] = spa_pod_builder_deref(&b.b, offsets[i]);
+		if ((res = pw_stream_connect(grp->capture,
+				PW_DIRECTION_INPUT,
+				PW_ID_ANY,
+				PW_STREAM_FLAG_AUTOCONNECT |
+				PW_STREAM_FLAG_MAP_BUFFERS |
+				PW_STREAM_FLAG_RT_PROCESS,
+				params, n_params)) < 0) {
+			spa_pod_dynamic_builder_clean(&b);
+			return res;
+		}
 
-	if ((res = pw_stream_connect(impl->source,
-			PW_DIRECTION_OUTPUT,
-			PW_ID_ANY,
-			PW_STREAM_FLAG_MAP_BUFFERS |
-			PW_STREAM_FLAG_RT_PROCESS |
-			PW_STREAM_FLAG_ASYNC,
-			params, n_params)) < 0) {
-		spa_pod_dynamic_builder_clean(&b);
-		return res;
+		offsets[0] = b.b.state.offset;
+		spa_format_audio_raw_build(&b.b, SPA_PARAM_EnumFormat, &grp->source_info);
+
+		for (i = 0; i < n_params; i++)
+			params[i] = spa_pod_builder_deref(&b.b, offsets[i]);
+
+		if ((res = pw_stream_connect(grp->source,
+				PW_DIRECTION_OUTPUT,
+				PW_ID_ANY,
+				PW_STREAM_FLAG_MAP_BUFFERS |
+				PW_STREAM_FLAG_RT_PROCESS |
+				PW_STREAM_FLAG_ASYNC,
+				params, n_params)) < 0) {
+			spa_pod_dynamic_builder_clean(&b);
+			return res;
+		}
 	}
 
 	offsets[0] = b.b.state.offset;
@@ -1111,6 +1400,14 @@ static int setup_streams(struct impl *impl)
 	for (i = 0; i < impl->out_info.channels; i++)
 		impl->out_buffer[i] = malloc(impl->out_ringsize);
 
+	if (impl->worker != NULL) {
+		impl->work_ringsize = impl->rec_ringsize;
+		for (i = 0; i < impl->rec_info.channels; i++)
+			impl->work_rec_buffer[i] = malloc(impl->work_ringsize);
+		for (i = 0; i < impl->play_info.channels; i++)
+			impl->work_play_buffer[i] = malloc(impl->work_ringsize);
+	}
+
 	reset_buffers(impl);
 
 	return 0;
@@ -1152,20 +1449,28 @@ static const struct pw_proxy_events core_proxy_events = {
 static void impl_destroy(struct impl *impl)
 {
 	uint32_t i;
-	if (impl->capture)
-		pw_stream_destroy(impl->capture);
-	if (impl->source)
-		pw_stream_destroy(impl->source);
+	for (i = 0; i < impl->n_groups; i++) {
+		struct group *grp = &impl->groups[i];
+		if (grp->capture)
+			pw_stream_destroy(grp->capture);
+		if (grp->source)
+			pw_stream_destroy(grp->source);
+		pw_properties_free(grp->capture_props);
+		pw_properties_free(grp->source_props);
+	}
 	if (impl->playback)
 		pw_stream_destroy(impl->playback);
 	if (impl->sink)
 		pw_stream_destroy(impl->sink);
 	if (impl->core && impl->do_disconnect)
 		pw_core_disconnect(impl->core);
-	if (impl->spa_handle)
-		spa_plugin_loader_unload(impl->loader, impl->spa_handle);
-	pw_properties_free(impl->capture_props);
-	pw_properties_free(impl->source_props);
+	if (impl->worker)
+		pw_data_loop_destroy(impl->worker);
+	for (i = 0; i < impl->n_groups; i++) {
+		struct group *grp = &impl->groups[i];
+		if (grp->spa_handle)
+			spa_plugin_loader_unload(impl->loader, grp->spa_handle);
+	}
 	pw_properties_free(impl->playback_props);
 	pw_properties_free(impl->sink_props);
 
@@ -1175,6 +1480,10 @@ static void impl_destroy(struct impl *impl)
 		free(impl->play_buffer[i]);
 	for (i = 0; i < impl->out_info.channels; i++)
 		free(impl->out_buffer[i]);
+	for (i = 0; i < impl->rec_info.channels; i++)
+		free(impl->work_rec_buffer[i]);
+	for (i = 0; i < impl->play_info.channels; i++)
+		free(impl->work_play_buffer[i]);
 
 	free(impl);
 }
@@ -1238,11 +1547,15 @@ static void parse_audio_info(struct pw_properties *props, struct spa_audio_info_
 static void copy_props(struct impl *impl, struct pw_properties *props, const char *key)
 {
 	const char *str;
+	uint32_t g;
 	if ((str = pw_properties_get(props, key)) != NULL) {
-		if (pw_properties_get(impl->capture_props, key) == NULL)
-			pw_properties_set(impl->capture_props, key, str);
-		if (pw_properties_get(impl->source_props, key) == NULL)
-			pw_properties_set(impl->source_props, key, str);
+		for (g = 0; g < impl->n_groups; g++) {
+			struct group *grp = &impl->groups[g];
+			if (pw_properties_get(grp->capture_props, key) == NULL)
+				pw_properties_set(grp->capture_props, key, str);
+			if (pw_properties_get(grp->source_props, key) == NULL)
+				pw_properties_set(grp->source_props, key, str);
+		}
 		if (pw_properties_get(impl->playback_props, key) == NULL)
 			pw_properties_set(impl->playback_props, key, str);
 		if (pw_properties_get(impl->sink_props, key) == NULL)
@@ -1250,6 +1563,156 @@ static void copy_props(struct impl *impl, struct pw_properties *props, const cha
 	}
 }
 
+static struct group *add_group(struct impl *impl, struct pw_properties *props)
+{
+	struct group *grp;
+	const char *str;
+
+	if (impl->n_groups >= MAX_GROUPS) {
+		errno = ENOSPC;
+		return NULL;
+	}
+	grp = &impl->groups[impl->n_groups];
+	grp->impl = impl;
+	grp->index = impl->n_groups;
+	grp->capture_props = pw_properties_new(NULL, NULL);
+	grp->source_props = pw_properties_new(NULL, NULL);
+	impl->n_groups++;
+
+	if (grp->capture_props == NULL || grp->source_props == NULL)
+		return NULL;
+
+	if ((str = pw_properties_get(props, "capture.props")) != NULL)
+		pw_properties_update_string(grp->capture_props, str, strlen(str));
+	if ((str = pw_properties_get(props, "source.props")) != NULL)
+		pw_properties_update_string(grp->source_props, str, strlen(str));
+	return grp;
+}
+
+static int parse_groups(struct impl *impl, struct pw_properties *props, const char *groups)
+{
+	struct spa_json it[3];
+	char key[256];
+
+	spa_json_init(&it[0], groups, strlen(groups));
+	if (spa_json_enter_array(&it[0], &it[1]) <= 0)
+		return -EINVAL;
+
+	while (spa_json_enter_object(&it[1], &it[2]) > 0) {
+		struct group *grp;
+
+		if ((grp = add_group(impl, props)) == NULL)
+			return -errno;
+
+		while (spa_json_get_string(&it[2], key, sizeof(key)) > 0) {
+			const char *value;
+			int len;
+
+			if ((len = spa_json_next(&it[2], &value)) <= 0)
+				return -EINVAL;
+
+			if (spa_json_is_container(value, len))
+				len = spa_json_container_len(&it[2], value, len);
+
+			if (spa_streq(key, "capture.props"))
+				pw_properties_update_string(grp->capture_props, value, len);
+			else if (spa_streq(key, "source.props"))
+				pw_properties_update_string(grp->source_props, value, len);
+		}
+	}
+	return impl->n_groups > 0 ? 0 : -EINVAL;
+}
+
+static void append_channels(struct spa_audio_info_raw *dst, const struct spa_audio_info_raw *src)
+{
+	uint32_t i;
+	for (i = 0; i < src->channels && dst->channels < SPA_AUDIO_MAX_CHANNELS; i++)
+		dst->position[dst->channels++] = src->position[i];
+}
+
+static int group_init_aec(struct impl *impl, struct group *grp, const char *path,
+		struct pw_properties *aec_props)
+{
+	struct spa_dict_item dict_items[] = {
+		{ SPA_KEY_LIBRARY_NAME, path },
+	};
+	struct spa_dict dict = SPA_DICT_INIT_ARRAY(dict_items);
+	struct spa_audio_info_raw info, play_info;
+	void *iface;
+	int res;
+
+	grp->spa_handle = spa_plugin_loader_load(impl->loader, SPA_NAME_AEC, &dict);
+	if (grp->spa_handle == NULL) {
+		pw_log_error("aec plugin %s not available library.name %s", SPA_NAME_AEC, path);
+		return -ENOENT;
+	}
+
+	if ((res = spa_handle_get_interface(grp->spa_handle, SPA_TYPE_INTERFACE_AUDIO_AEC, &iface)) < 0) {
+		pw_log_error("can't get %s interface %d", SPA_TYPE_INTERFACE_AUDIO_AEC, res);
+		return res;
+	}
+	grp->aec = iface;
+
+	if (grp->aec->iface.version > SPA_VERSION_AUDIO_AEC) {
+		pw_log_error("codec plugin %s has incompatible ABI version (%d > %d)",
+			SPA_NAME_AEC, grp->aec->iface.version, SPA_VERSION_AUDIO_AEC);
+		return -ENOENT;
+	}
+
+	pw_log_info("Using plugin AEC %s with version %d for group %u", grp->aec->name,
+			grp->aec->iface.version, grp->index);
+
+	if (spa_interface_callback_check(&grp->aec->iface, struct spa_audio_aec_methods, init2, 3)) {
+		struct spa_audio_info_raw rec_info = grp->capture_info;
+		struct spa_audio_info_raw out_info = grp->source_info;
+
+		play_info = impl->sink_info;
+
+		res = spa_audio_aec_init2(grp->aec, &aec_props->dict,
+				&rec_info, &out_info, &play_info);
+
+		if (grp->capture_info.channels != rec_info.channels)
+			grp->capture_info = rec_info;
+		if (grp->source_info.channels != out_info.channels)
+			grp->source_info = out_info;
+	} else {
+		if (grp->source_info.channels != impl->sink_info.channels)
+			grp->source_info = impl->sink_info;
+		if (grp->capture_info.channels != grp->source_info.channels)
+			grp->capture_info = grp->source_info;
+		if (impl->playback_info.channels != impl->sink_info.channels)
+			impl->playback_info = impl->sink_info;
+
+		info = impl->playback_info;
+
+		res = spa_audio_aec_init(grp->aec, &aec_props->dict, &info);
+
+		grp->capture_info = info;
+		grp->source_info = info;
+		play_info = info;
+	}
+	if (res < 0) {
+		pw_log_error("aec plugin %s create failed: %s", grp->aec->name,
+				spa_strerror(res));
+		return res;
+	}
+
+	/* the groups are all cancelled against the same far-end signal */
+	if (grp->index == 0) {
+		impl->play_info = play_info;
+		if (impl->sink_info.channels != impl->play_info.channels)
+			impl->sink_info = impl->play_info;
+		if (impl->playback_info.channels != impl->play_info.channels)
+			impl->playback_info = impl->play_info;
+	} else if (play_info.channels != impl->play_info.channels) {
+		pw_log_error("aec plugin %s needs %u far-end channels for group %u, not %u",
+				grp->aec->name, play_info.channels, grp->index,
+				impl->play_info.channels);
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
 SPA_EXPORT
 int pipewire__module_init(struct pw_impl_module *module, const char *args)
 {
@@ -1262,8 +1725,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	const char *str;
 	const char *path;
 	int res = 0;
-	struct spa_handle *handle = NULL;
-	void *iface;
+	uint32_t i, n_rec = 0, n_out = 0;
 
 	PW_LOG_TOPIC_INIT(mod_topic);
 
@@ -1283,12 +1745,20 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto error;
 	}
 
-	impl->capture_props = pw_properties_new(NULL, NULL);
-	impl->source_props = pw_properties_new(NULL, NULL);
 	impl->playback_props = pw_properties_new(NULL, NULL);
 	impl->sink_props = pw_properties_new(NULL, NULL);
-	if (impl->source_props == NULL || impl->sink_props == NULL ||
-	    impl->capture_props == NULL || impl->playback_props == NULL) {
+	if (impl->sink_props == NULL || impl->playback_props == NULL) {
+		res = -errno;
+		pw_log_error( "can't create properties: %m");
+		goto error;
+	}
+
+	if ((str = pw_properties_get(props, "capture.groups")) != NULL) {
+		if ((res = parse_groups(impl, props, str)) < 0) {
+			pw_log_error("can't parse capture.groups: %s", spa_strerror(res));
+			goto error;
+		}
+	} else if (add_group(impl, props) == NULL) {
 		res = -errno;
 		pw_log_error( "can't create properties: %m");
 		goto error;
@@ -1312,33 +1782,45 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	parse_audio_info(props, &info);
 
-	impl->capture_info = info;
-	impl->source_info = info;
 	impl->sink_info = info;
 	impl->playback_info = info;
 
-	if ((str = pw_properties_get(props, "capture.props")) != NULL)
-		pw_properties_update_string(impl->capture_props, str, strlen(str));
-	if ((str = pw_properties_get(props, "source.props")) != NULL)
-		pw_properties_update_string(impl->source_props, str, strlen(str));
 	if ((str = pw_properties_get(props, "sink.props")) != NULL)
 		pw_properties_update_string(impl->sink_props, str, strlen(str));
 	if ((str = pw_properties_get(props, "playback.props")) != NULL)
 		pw_properties_update_string(impl->playback_props, str, strlen(str));
 
-	if (pw_properties_get(impl->capture_props, PW_KEY_NODE_NAME) == NULL)
-		pw_properties_set(impl->capture_props, PW_KEY_NODE_NAME, "echo-cancel-capture");
-	if (pw_properties_get(impl->capture_props, PW_KEY_NODE_DESCRIPTION) == NULL)
-		pw_properties_set(impl->capture_props, PW_KEY_NODE_DESCRIPTION, "Echo-Cancel Capture");
-	if (pw_properties_get(impl->capture_props, PW_KEY_NODE_PASSIVE) == NULL)
-		pw_properties_set(impl->capture_props, PW_KEY_NODE_PASSIVE, "true");
-
-	if (pw_properties_get(impl->source_props, PW_KEY_NODE_NAME) == NULL)
-		pw_properties_set(impl->source_props, PW_KEY_NODE_NAME, "echo-cancel-source");
-	if (pw_properties_get(impl->source_props, PW_KEY_NODE_DESCRIPTION) == NULL)
-		pw_properties_set(impl->source_props, PW_KEY_NODE_DESCRIPTION, "Echo-Cancel Source");
-	if (pw_properties_get(impl->source_props, PW_KEY_MEDIA_CLASS) == NULL)
-		pw_properties_set(impl->source_props, PW_KEY_MEDIA_CLASS, "Audio/Source");
+	for (i = 0; i < impl->n_groups; i++) {
+		struct group *grp = &impl->groups[i];
+		struct pw_properties *cp = grp->capture_props, *sp = grp->source_props;
+
+		grp->capture_info = info;
+		grp->source_info = info;
+
+		if (impl->n_groups == 1) {
+			if (pw_properties_get(cp, PW_KEY_NODE_NAME) == NULL)
+				pw_properties_set(cp, PW_KEY_NODE_NAME, "echo-cancel-capture");
+			if (pw_properties_get(cp, PW_KEY_NODE_DESCRIPTION) == NULL)
+				pw_properties_set(cp, PW_KEY_NODE_DESCRIPTION, "Echo-Cancel Capture");
+			if (pw_properties_get(sp, PW_KEY_NODE_NAME) == NULL)
+				pw_properties_set(sp, PW_KEY_NODE_NAME, "echo-cancel-source");
+			if (pw_properties_get(sp, PW_KEY_NODE_DESCRIPTION) == NULL)
+				pw_properties_set(sp, PW_KEY_NODE_DESCRIPTION, "Echo-Cancel Source");
+		} else {
+			if (pw_properties_get(cp, PW_KEY_NODE_NAME) == NULL)
+				pw_properties_setf(cp, PW_KEY_NODE_NAME, "echo-cancel-capture-%u", i);
+			if (pw_properties_get(cp, PW_KEY_NODE_DESCRIPTION) == NULL)
+				pw_properties_setf(cp, PW_KEY_NODE_DESCRIPTION, "Echo-Cancel Capture %u", i);
+			if (pw_properties_get(sp, PW_KEY_NODE_NAME) == NULL)
+				pw_properties_setf(sp, PW_KEY_NODE_NAME, "echo-cancel-source-%u", i);
+			if (pw_properties_get(sp, PW_KEY_NODE_DESCRIPTION) == NULL)
+				pw_properties_setf(sp, PW_KEY_NODE_DESCRIPTION, "Echo-Cancel Source %u", i);
+		}
+		if (pw_properties_get(cp, PW_KEY_NODE_PASSIVE) == NULL)
+			pw_properties_set(cp, PW_KEY_NODE_PASSIVE, "true");
+		if (pw_properties_get(sp, PW_KEY_MEDIA_CLASS) == NULL)
+			pw_properties_set(sp, PW_KEY_MEDIA_CLASS, "Audio/Source");
+	}
 
 	if (pw_properties_get(impl->playback_props, PW_KEY_NODE_NAME) == NULL)
 		pw_properties_set(impl->playback_props, PW_KEY_NODE_NAME, "echo-cancel-playback");
@@ -1371,6 +1853,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, "resample.prefill");
 
 	impl->max_buffer_size = pw_properties_get_uint32(props,"buffer.max_size", MAX_BUFSIZE_MS);
+	impl->async = pw_properties_get_bool(props, "aec.async", false);
 
 	if ((str = pw_properties_get(props, "buffer.play_delay")) != NULL) {
 		int req_num, req_denom;
@@ -1389,11 +1872,23 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		impl->buffer_delay = DELAY_MS * info.rate / 1000;
 	}
 
-	if ((str = pw_properties_get(impl->capture_props, SPA_KEY_AUDIO_POSITION)) != NULL) {
-		parse_position(&impl->capture_info, str, strlen(str));
+	for (i = 0; i < impl->n_groups; i++) {
+		struct group *grp = &impl->groups[i];
+
+		if ((str = pw_properties_get(grp->capture_props, SPA_KEY_AUDIO_POSITION)) != NULL) {
+			parse_position(&grp->capture_info, str, strlen(str));
+		}
+		if ((str = pw_properties_get(grp->source_props, SPA_KEY_AUDIO_POSITION)) != NULL) {
+			parse_position(&grp->source_info, str, strlen(str));
+		}
+		n_rec += grp->capture_info.channels;
+		n_out += grp->source_info.channels;
 	}
-	if ((str = pw_properties_get(impl->source_props, SPA_KEY_AUDIO_POSITION)) != NULL) {
-		parse_position(&impl->source_info, str, strlen(str));
+	if (n_rec > SPA_AUDIO_MAX_CHANNELS || n_out > SPA_AUDIO_MAX_CHANNELS) {
+		pw_log_error("capture.groups need too many channels: %u/%u",
+				n_rec, n_out);
+		res = -EINVAL;
+		goto error;
 	}
 	if ((str = pw_properties_get(impl->sink_props, SPA_KEY_AUDIO_POSITION)) != NULL) {
 		parse_position(&impl->sink_info, str, strlen(str));
@@ -1422,80 +1917,41 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		return -EINVAL;
 	}
 
-	struct spa_dict_item dict_items[] = {
-		{ SPA_KEY_LIBRARY_NAME, path },
-	};
-	struct spa_dict dict = SPA_DICT_INIT_ARRAY(dict_items);
-
-	handle = spa_plugin_loader_load(impl->loader, SPA_NAME_AEC, &dict);
-	if (handle == NULL) {
-		pw_log_error("aec plugin %s not available library.name %s", SPA_NAME_AEC, path);
-		return -ENOENT;
-	}
-
-	if ((res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_AUDIO_AEC, &iface)) < 0) {
-		pw_log_error("can't get %s interface %d", SPA_TYPE_INTERFACE_AUDIO_AEC, res);
-		return res;
-	}
-	impl->aec = iface;
-	impl->spa_handle = handle;
-
-	if (impl->aec->iface.version > SPA_VERSION_AUDIO_AEC) {
-		pw_log_error("codec plugin %s has incompatible ABI version (%d > %d)",
-			SPA_NAME_AEC, impl->aec->iface.version, SPA_VERSION_AUDIO_AEC);
-		res = -ENOENT;
-		goto error;
-	}
-
-	pw_log_info("Using plugin AEC %s with version %d", impl->aec->name,
-			impl->aec->iface.version);
-
 	if ((str = pw_properties_get(props, "aec.args")) != NULL)
 		aec_props = pw_properties_new_string(str);
 	else
 		aec_props = pw_properties_new(NULL, NULL);
 
+	impl->rec_info = impl->groups[0].capture_info;
+	impl->out_info = impl->groups[0].source_info;
+	impl->rec_info.channels = impl->out_info.channels = 0;
+	n_rec = n_out = 0;
 
-	if (spa_interface_callback_check(&impl->aec->iface, struct spa_audio_aec_methods, init2, 3)) {
-		impl->rec_info = impl->capture_info;
-		impl->out_info = impl->source_info;
-		impl->play_info = impl->sink_info;
-
-		res = spa_audio_aec_init2(impl->aec, &aec_props->dict,
-				&impl->rec_info, &impl->out_info, &impl->play_info);
-
-		if (impl->sink_info.channels != impl->play_info.channels)
-			impl->sink_info = impl->play_info;
-		if (impl->playback_info.channels != impl->play_info.channels)
-			impl->playback_info = impl->play_info;
-		if (impl->capture_info.channels != impl->rec_info.channels)
-			impl->capture_info = impl->rec_info;
-		if (impl->source_info.channels != impl->out_info.channels)
-			impl->source_info = impl->out_info;
-	} else {
-		if (impl->source_info.channels != impl->sink_info.channels)
-			impl->source_info = impl->sink_info;
-		if (impl->capture_info.channels != impl->source_info.channels)
-			impl->capture_info = impl->source_info;
-		if (impl->playback_info.channels != impl->sink_info.channels)
-			impl->playback_info = impl->sink_info;
+	for (i = 0; i < impl->n_groups; i++) {
+		struct group *grp = &impl->groups[i];
 
-		info = impl->playback_info;
-
-		res = spa_audio_aec_init(impl->aec, &aec_props->dict, &info);
+		if ((res = group_init_aec(impl, grp, path, aec_props)) < 0)
+			break;
 
-		impl->rec_info = info;
-		impl->out_info = info;
-		impl->play_info = info;
+		grp->rec_offset = n_rec;
+		grp->out_offset = n_out;
+		n_rec += grp->capture_info.channels;
+		n_out += grp->source_info.channels;
+		append_channels(&impl->rec_info, &grp->capture_info);
+		append_channels(&impl->out_info, &grp->source_info);
 	}
-
 	pw_properties_free(aec_props);
 
-	if (res < 0) {
-		pw_log_error("aec plugin %s create failed: %s", impl->aec->name,
-				spa_strerror(res));
+	if (res < 0)
+		goto error;
+
+	if (n_rec > SPA_AUDIO_MAX_CHANNELS || n_out > SPA_AUDIO_MAX_CHANNELS) {
+		pw_log_error("capture.groups need too many channels: %u/%u",
+				n_rec, n_out);
+		res = -EINVAL;
 		goto error;
 	}
+	impl->aec = impl->groups[0].aec;
 
 	if (impl->aec->latency) {
 		unsigned int num, denom, req_num, req_denom;
@@ -1526,6 +1982,27 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	copy_props(impl, props, PW_KEY_NODE_LATENCY);
 
+	if (impl->async) {
+		struct spa_dict_item items[] = {
+			{ PW_KEY_LOOP_NAME, "echo-cancel-aec" },
+			{ SPA_KEY_THREAD_NAME, "echo-cancel-aec" },
+		};
+		/* a realtime data loop, the output of the worker needs to be ready
+		 * in the next cycle */
+		impl->worker = pw_data_loop_new(&SPA_DICT_INIT_ARRAY(items));
+		if (impl->worker == NULL) {
+			res = -errno;
+			pw_log_error("can't create worker thread: %m");
+			goto error;
+		}
+		pw_data_loop_set_thread_utils(impl->worker,
+				pw_context_get_object(impl->context, SPA_TYPE_INTERFACE_ThreadUtils));
+		if ((res = pw_data_loop_start(impl->worker)) < 0) {
+			pw_log_error("can't start worker thread: %s", spa_strerror(res));
+			goto error;
+		}
+	}
+
 	impl->core = pw_context_get_object(impl->context, PW_TYPE_INTERFACE_Core);
 	if (impl->core == NULL) {
 		str = pw_properties_get(props, PW_KEY_REMOTE_NAME);
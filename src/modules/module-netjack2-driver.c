@@ -24,6 +24,7 @@
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
 #include <spa/debug/types.h>
+#include <spa/support/cpu.h>
 #include <spa/pod/builder.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/latency-utils.h>
@@ -63,6 +64,8 @@
  * - `netjack2.save`: if jack port connections should be save automatically. Can also be
  *                   placed per stream.
  * - `netjack2.latency`: the latency in cycles, default 2
+ * - `netjack2.opus-threads`: the number of threads used to encode and decode
+ *                   opus audio channels when the manager uses opus, default 1
  * - `audio.channels`: the number of audio ports. Can also be added to the stream props.
  * - `midi.ports`: the number of midi ports. Can also be added to the stream props.
  * - `source.props`: Extra properties for the source filter.
@@ -94,6 +97,7 @@
  *         #netjack2.client-name = PipeWire
  *         #netjack2.save        = false
  *         #netjack2.latency     = 2
+ *         #netjack2.opus-threads = 1
  *         #midi.ports           = 0
  *         #audio.channels       = 2
  *         #audio.position       = [ FL FR ]
@@ -125,6 +129,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 #define MAX_MTU			9000
 
 #define DEFAULT_NETWORK_LATENCY	2
+#define DEFAULT_OPUS_THREADS	1
 #define NETWORK_MAX_LATENCY	30
 
 #define DEFAULT_CLIENT_NAME	"PipeWire"
@@ -146,6 +151,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 			"( netjack2.client-name=<name of the NETJACK2 client> ) "	\
 			"( netjack2.save=<bool, save ports> ) "			\
 			"( netjack2.latency=<latency in cycles, default 2> ) "	\
+			"( netjack2.opus-threads=<opus threads, default 1> ) "	\
 			"( midi.ports=<number of midi ports> ) "		\
 			"( audio.channels=<number of channels> ) "		\
 			"( audio.position=<channel map> ) "			\
@@ -207,6 +213,8 @@ struct impl {
 	int mtu;
 	uint32_t latency;
 	uint32_t quantum_limit;
+	uint32_t cpu_flags;
+	uint32_t opus_threads;
 
 	struct pw_impl_module *module;
 	struct spa_hook module_listener;
@@ -859,6 +867,8 @@ static int handle_follower_setup(struct impl *impl, struct nj2_session_params *p
 	peer->send_volume = &impl->sink.volume;
 	peer->recv_volume = &impl->source.volume;
 	peer->quantum_limit = impl->quantum_limit;
+	peer->cpu_flags = impl->cpu_flags;
+	peer->opus_threads = impl->opus_threads;
 	netjack2_init(peer);
 
 	int bufsize = NETWORK_MAX_LATENCY * (peer->params.mtu +
@@ -1207,6 +1217,9 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 {
 	struct pw_context *context = pw_impl_module_get_context(module);
 	struct pw_properties *props = NULL;
+	const struct spa_support *support;
+	uint32_t n_support;
+	struct spa_cpu *cpu_iface;
 	struct impl *impl;
 	const char *str;
 	int res;
@@ -1237,6 +1250,10 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 			pw_context_get_properties(context),
 			"default.clock.quantum-limit", 8192u);
 
+	support = pw_context_get_support(context, &n_support);
+	cpu_iface = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	impl->cpu_flags = cpu_iface ? spa_cpu_get_flags(cpu_iface) : 0;
+
 	impl->sink.props = pw_properties_new(NULL, NULL);
 	impl->source.props = pw_properties_new(NULL, NULL);
 	if (impl->source.props == NULL || impl->sink.props == NULL) {
@@ -1269,6 +1286,8 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	}
 	impl->latency = pw_properties_get_uint32(impl->props, "netjack2.latency",
 			DEFAULT_NETWORK_LATENCY);
+	impl->opus_threads = pw_properties_get_uint32(impl->props, "netjack2.opus-threads",
+			DEFAULT_OPUS_THREADS);
 
 	pw_properties_set(props, PW_KEY_NODE_LOOP_NAME, impl->data_loop->name);
 	if (pw_properties_get(props, PW_KEY_NODE_VIRTUAL) == NULL)
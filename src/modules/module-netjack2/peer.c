@@ -1,5 +1,14 @@
 
 #include <byteswap.h>
+#include <semaphore.h>
+
+#include <spa/support/thread.h>
+
+#include <pipewire/thread.h>
+
+#ifdef HAVE_SPA_PLUGINS
+#include <spa/plugins/audioconvert/fmt-ops.h>
+#endif
 
 #ifdef HAVE_OPUS_CUSTOM
 #include <opus/opus.h>
@@ -55,6 +64,7 @@ static inline void do_volume(float *dst, const float *src, struct volume *vol,
 	}
 }
 
+#ifndef HAVE_SPA_PLUGINS
 #define ITOF(type,v,scale) \
 	(((type)(v)) * (1.0f / (scale)))
 #define FTOI(type,v,scale,min,max) \
@@ -65,40 +75,27 @@ static inline void do_volume(float *dst, const float *src, struct volume *vol,
 #define S16_SCALE		32768.0f
 #define S16_TO_F32(v)		ITOF(int16_t, v, S16_SCALE)
 #define F32_TO_S16(v)		FTOI(int16_t, v, S16_SCALE, S16_MIN, S16_MAX)
+#endif
 
-static inline void do_volume_to_s16(int16_t *dst, const float *src, struct volume *vol,
-		uint32_t ch, uint32_t n_samples)
-{
-	float v = vol->mute ? 0.0f : vol->volumes[ch];
-	uint32_t i;
+struct data_info {
+	uint32_t id;
+	void *data;
+	bool filled;
+};
 
-	if (v == 0.0f || src == NULL)
-		memset(dst, 0, n_samples * sizeof(int16_t));
-	else if (v == 1.0f) {
-		for (i = 0; i < n_samples; i++)
-			dst[i] = F32_TO_S16(src[i]);
-	} else {
-		for (i = 0; i < n_samples; i++)
-			dst[i] = F32_TO_S16(src[i] * v);
-	}
-}
+#ifdef HAVE_OPUS_CUSTOM
+#define MAX_OPUS_THREADS	16
 
-static inline void do_volume_from_s16(float *dst, const int16_t *src, struct volume *vol,
-		uint32_t ch, uint32_t n_samples)
-{
-	float v = vol->mute ? 0.0f : vol->volumes[ch];
-	uint32_t i;
+struct netjack2_peer;
 
-	if (v == 0.0f || src == NULL)
-		memset(dst, 0, n_samples * sizeof(float));
-	else if (v == 1.0f) {
-		for (i = 0; i < n_samples; i++)
-			dst[i] = S16_TO_F32(src[i]);
-	} else {
-		for (i = 0; i < n_samples; i++)
-			dst[i] = S16_TO_F32(src[i]) * v;
-	}
-}
+struct netjack2_worker {
+	struct netjack2_peer *peer;
+	struct spa_thread *thread;
+	uint32_t index;
+	sem_t start;
+	sem_t done;
+};
+#endif
 
 struct netjack2_peer {
 	int fd;
@@ -116,19 +113,240 @@ struct netjack2_peer {
 	uint32_t midi_size;
 
 	uint32_t quantum_limit;
+	uint32_t cpu_flags;
+	uint32_t opus_threads;
+
 	float *empty;
+	float *scratch;
 	void *encoded_data;
 	uint32_t encoded_size;
 	uint32_t max_encoded_size;
+#ifdef HAVE_SPA_PLUGINS
+	struct convert to_s16;
+	struct convert from_s16;
+#endif
 #ifdef HAVE_OPUS_CUSTOM
 	OpusCustomMode *opus_config;
 	OpusCustomEncoder **opus_enc;
 	OpusCustomDecoder **opus_dec;
+
+	/* optional helper threads that each encode or decode a
+	 * slice of the channels while the data thread does the first
+	 * slice itself */
+	struct netjack2_worker workers[MAX_OPUS_THREADS];
+	uint32_t n_workers;
+	bool running;
+	struct {
+		struct data_info *info;
+		uint32_t n_info;
+		uint32_t nframes;
+		bool encode;
+	} job;
 #endif
 
 	unsigned fix_midi:1;
+	unsigned have_convert:1;
 };
 
+static inline void do_volume_to_s16(struct netjack2_peer *peer, int16_t *dst,
+		const float *src, struct volume *vol, uint32_t ch, uint32_t n_samples)
+{
+	float v = vol->mute ? 0.0f : vol->volumes[ch];
+	uint32_t i;
+
+	if (v == 0.0f || src == NULL) {
+		memset(dst, 0, n_samples * sizeof(int16_t));
+		return;
+	}
+	if (v != 1.0f) {
+		float *s = peer->scratch;
+		for (i = 0; i < n_samples; i++)
+			s[i] = src[i] * v;
+		src = s;
+	}
+#ifdef HAVE_SPA_PLUGINS
+	if (peer->have_convert) {
+		convert_process(&peer->to_s16, (void **)&dst, (const void **)&src, n_samples);
+		return;
+	}
+#endif
+	for (i = 0; i < n_samples; i++)
+		dst[i] = F32_TO_S16(src[i]);
+}
+
+static inline void do_volume_from_s16(struct netjack2_peer *peer, float *dst,
+		const int16_t *src, struct volume *vol, uint32_t ch, uint32_t n_samples)
+{
+	float v = vol->mute ? 0.0f : vol->volumes[ch];
+	uint32_t i;
+
+	if (v == 0.0f || src == NULL) {
+		memset(dst, 0, n_samples * sizeof(float));
+		return;
+	}
+#ifdef HAVE_SPA_PLUGINS
+	if (peer->have_convert)
+		convert_process(&peer->from_s16, (void **)&dst, (const void **)&src, n_samples);
+	else
+#endif
+		for (i = 0; i < n_samples; i++)
+			dst[i] = S16_TO_F32(src[i]);
+
+	if (v != 1.0f) {
+		for (i = 0; i < n_samples; i++)
+			dst[i] *= v;
+	}
+}
+
+#ifdef HAVE_OPUS_CUSTOM
+static void opus_encode_channels(struct netjack2_peer *peer, uint32_t start, uint32_t end)
+{
+	struct data_info *info = peer->job.info;
+	uint32_t i, max_encoded = peer->max_encoded_size;
+
+	for (i = start; i < end; i++) {
+		uint16_t *ap = SPA_PTROFF(peer->encoded_data, i * max_encoded, uint16_t);
+		void *pcm;
+		int res;
+
+		if (i >= peer->job.n_info || (pcm = info[i].data) == NULL)
+			pcm = peer->empty;
+
+		res = opus_custom_encode_float(peer->opus_enc[i],
+				pcm, peer->job.nframes, (unsigned char*)&ap[1], max_encoded - 2);
+
+		if (res < 0 || res > 0xffff) {
+			pw_log_warn("encoding error %d", res);
+			ap[0] = 0;
+		} else {
+			ap[0] = htons(res);
+		}
+	}
+}
+
+static void opus_decode_channels(struct netjack2_peer *peer, uint32_t start, uint32_t end)
+{
+	struct data_info *info = peer->job.info;
+	uint32_t i, max_encoded = peer->max_encoded_size;
+
+	for (i = start; i < end; i++) {
+		uint16_t *ap = SPA_PTROFF(peer->encoded_data, i * max_encoded, uint16_t);
+		void *pcm;
+		int res;
+
+		if (i >= peer->job.n_info || (pcm = info[i].data) == NULL)
+			continue;
+
+		res = opus_custom_decode_float(peer->opus_dec[i],
+				(unsigned char*)&ap[1], ntohs(ap[0]),
+				pcm, peer->job.nframes);
+
+		if (res < 0 || res > 0xffff || res != (int)peer->job.nframes)
+			pw_log_warn("decoding error %d", res);
+		else
+			info[i].filled = true;
+	}
+}
+
+static void opus_run_slice(struct netjack2_peer *peer, uint32_t index)
+{
+	uint32_t n_channels, n_slices, start, end;
+
+	n_channels = peer->job.encode ?
+		peer->params.send_audio_channels : peer->params.recv_audio_channels;
+	n_slices = peer->n_workers + 1;
+	start = n_channels * index / n_slices;
+	end = n_channels * (index + 1) / n_slices;
+
+	if (peer->job.encode)
+		opus_encode_channels(peer, start, end);
+	else
+		opus_decode_channels(peer, start, end);
+}
+
+static void *opus_worker_thread(void *data)
+{
+	struct netjack2_worker *w = data;
+	struct netjack2_peer *peer = w->peer;
+
+	while (true) {
+		while (sem_wait(&w->start) < 0 && errno == EINTR);
+		if (!peer->running)
+			break;
+		opus_run_slice(peer, w->index);
+		sem_post(&w->done);
+	}
+	return NULL;
+}
+
+static void opus_run(struct netjack2_peer *peer, bool encode, uint32_t nframes,
+		struct data_info *info, uint32_t n_info)
+{
+	uint32_t i;
+
+	peer->job.encode = encode;
+	peer->job.nframes = nframes;
+	peer->job.info = info;
+	peer->job.n_info = n_info;
+
+	for (i = 0; i < peer->n_workers; i++)
+		sem_post(&peer->workers[i].start);
+
+	opus_run_slice(peer, 0);
+
+	for (i = 0; i < peer->n_workers; i++)
+		while (sem_wait(&peer->workers[i].done) < 0 && errno == EINTR);
+}
+
+static void opus_start_workers(struct netjack2_peer *peer)
+{
+	uint32_t i, n_threads;
+
+	n_threads = SPA_MIN(peer->opus_threads, MAX_OPUS_THREADS);
+	n_threads = SPA_MIN(n_threads, (uint32_t)SPA_MAX(peer->params.send_audio_channels,
+				peer->params.recv_audio_channels));
+	if (n_threads <= 1)
+		return;
+
+	peer->running = true;
+	for (i = 0; i < n_threads - 1; i++) {
+		struct netjack2_worker *w = &peer->workers[i];
+
+		w->peer = peer;
+		w->index = i + 1;
+		sem_init(&w->start, 0, 0);
+		sem_init(&w->done, 0, 0);
+
+		if ((w->thread = pw_thread_utils_create(NULL, opus_worker_thread, w)) == NULL) {
+			pw_log_warn("can't create opus thread: %m");
+			sem_destroy(&w->start);
+			sem_destroy(&w->done);
+			break;
+		}
+		pw_thread_utils_acquire_rt(w->thread, -1);
+		peer->n_workers++;
+	}
+	pw_log_info("using %u opus threads", peer->n_workers + 1);
+}
+
+static void opus_stop_workers(struct netjack2_peer *peer)
+{
+	uint32_t i;
+
+	peer->running = false;
+	for (i = 0; i < peer->n_workers; i++)
+		sem_post(&peer->workers[i].start);
+
+	for (i = 0; i < peer->n_workers; i++) {
+		struct netjack2_worker *w = &peer->workers[i];
+		pw_thread_utils_join(w->thread, NULL);
+		sem_destroy(&w->start);
+		sem_destroy(&w->done);
+	}
+	peer->n_workers = 0;
+}
+#endif
+
 static int netjack2_init(struct netjack2_peer *peer)
 {
 	int res = 0;
@@ -145,6 +363,34 @@ static int netjack2_init(struct netjack2_peer *peer)
 			SPA_MAX(peer->params.send_audio_channels, peer->params.recv_audio_channels);
 		if ((peer->encoded_data = calloc(1, peer->encoded_size)) == NULL)
 			goto error_errno;
+		if ((peer->scratch = calloc(peer->quantum_limit, sizeof(float))) == NULL)
+			goto error_errno;
+#ifdef HAVE_SPA_PLUGINS
+		peer->to_s16 = (struct convert) {
+			.src_fmt = SPA_AUDIO_FORMAT_F32P,
+			.dst_fmt = SPA_AUDIO_FORMAT_S16P,
+			.n_channels = 1,
+			.cpu_flags = peer->cpu_flags,
+		};
+		peer->from_s16 = (struct convert) {
+			.src_fmt = SPA_AUDIO_FORMAT_S16P,
+			.dst_fmt = SPA_AUDIO_FORMAT_F32P,
+			.n_channels = 1,
+			.cpu_flags = peer->cpu_flags,
+		};
+		if ((res = convert_init(&peer->to_s16)) >= 0) {
+			if ((res = convert_init(&peer->from_s16)) >= 0)
+				peer->have_convert = true;
+			else
+				convert_free(&peer->to_s16);
+		}
+		if (!peer->have_convert)
+			pw_log_warn("can't init converter: %s", spa_strerror(res));
+		else
+			pw_log_debug("using %s and %s", peer->to_s16.func_name,
+					peer->from_s16.func_name);
+		res = 0;
+#endif
 	} else if (peer->params.sample_encoder == NJ2_ENCODER_OPUS) {
 #ifdef HAVE_OPUS_CUSTOM
 		int32_t i;
@@ -182,6 +428,7 @@ static int netjack2_init(struct netjack2_peer *peer)
 					1, &res)) == NULL)
 				goto error_opus;
 		}
+		opus_start_workers(peer);
 #else
 		return -ENOTSUP;
 #endif
@@ -202,9 +449,19 @@ static void netjack2_cleanup(struct netjack2_peer *peer)
 {
 
 	free(peer->empty);
+	free(peer->scratch);
 	free(peer->midi_data);
+	free(peer->encoded_data);
+#ifdef HAVE_SPA_PLUGINS
+	if (peer->have_convert) {
+		convert_free(&peer->to_s16);
+		convert_free(&peer->from_s16);
+	}
+#endif
 #ifdef HAVE_OPUS_CUSTOM
 	int32_t i;
+
+	opus_stop_workers(peer);
 	if (peer->opus_enc != NULL) {
 		for (i = 0; i < peer->params.send_audio_channels; i++) {
 			if (peer->opus_enc[i])
@@ -221,17 +478,10 @@ static void netjack2_cleanup(struct netjack2_peer *peer)
 	}
 	if (peer->opus_config)
 		opus_custom_mode_destroy(peer->opus_config);
-	free(peer->encoded_data);
 #endif
 	spa_zero(*peer);
 }
 
-struct data_info {
-	uint32_t id;
-	void *data;
-	bool filled;
-};
-
 static inline void fix_midi_event(uint8_t *data, size_t size)
 {
 	/* fixup NoteOn with vel 0 */
@@ -512,24 +762,7 @@ static int netjack2_send_opus(struct netjack2_peer *peer, uint32_t nframes,
 
 	encoded_data = peer->encoded_data;
 
-	for (i = 0; i < active_ports; i++) {
-		uint16_t *ap = SPA_PTROFF(encoded_data, i * max_encoded, uint16_t);
-		void *pcm;
-		int res;
-
-		if (i >= n_info || (pcm = info[i].data) == NULL)
-			pcm = peer->empty;
-
-		res = opus_custom_encode_float(peer->opus_enc[i],
-				pcm, nframes, (unsigned char*)&ap[1], max_encoded - 2);
-
-		if (res < 0 || res > 0xffff) {
-			pw_log_warn("encoding error %d", res);
-			ap[0] = 0;
-		} else {
-			ap[0] = htons(res);
-		}
-	}
+	opus_run(peer, true, nframes, info, n_info);
 
 	strcpy(header.type, "header");
 	header.data_type = htonl('a');
@@ -594,7 +827,7 @@ static int netjack2_send_int(struct netjack2_peer *peer, uint32_t nframes,
 		void *pcm;
 
 		if (i < n_info && (pcm = info[i].data) != NULL)
-			do_volume_to_s16(ap, pcm, peer->send_volume, i, nframes);
+			do_volume_to_s16(peer, ap, pcm, peer->send_volume, i, nframes);
 		else
 			memset(ap, 0, max_encoded);
 	}
@@ -879,23 +1112,8 @@ static int netjack2_recv_opus(struct netjack2_peer *peer, struct nj2_packet_head
 	if (++(*count) < peer->sync.num_packets)
 		return 0;
 
-	for (i = 0; i < active_ports; i++) {
-		uint16_t *ap = SPA_PTROFF(encoded_data, i * max_encoded, uint16_t);
-		void *pcm;
-		int res;
-
-		if (i >= n_info || (pcm = info[i].data) == NULL)
-			continue;
+	opus_run(peer, false, peer->sync.frames, info, n_info);
 
-		res = opus_custom_decode_float(peer->opus_dec[i],
-				(unsigned char*)&ap[1], ntohs(ap[0]),
-				pcm, peer->sync.frames);
-
-		if (res < 0 || res > 0xffff || res != peer->sync.frames)
-			pw_log_warn("decoding error %d", res);
-		else
-			info[i].filled = true;
-	}
 	return 0;
 #else
 	return -ENOTSUP;
@@ -959,7 +1177,7 @@ static int netjack2_recv_int(struct netjack2_peer *peer, struct nj2_packet_heade
 		if (i >= n_info || (pcm = info[i].data) == NULL)
 			continue;
 
-		do_volume_from_s16(pcm, ap, peer->recv_volume, i, peer->sync.frames);
+		do_volume_from_s16(peer, pcm, ap, peer->recv_volume, i, peer->sync.frames);
 		info[i].filled = true;
 	}
 	return 0;
@@ -10,6 +10,7 @@
 #include <spa/utils/result.h>
 
 #include <pipewire/impl.h>
+#include <pipewire/private.h>
 #include <pipewire/extensions/protocol-native.h>
 #include <pipewire/extensions/security-context.h>
 
@@ -19,6 +20,12 @@
 #define MAX_PARAM_INFO	128
 #define MAX_PERMISSIONS	4096
 
+/* features announced by the client in Core::Hello */
+#define PROTOCOL_FEATURE_INFO_DELTA	(1u<<0)
+
+/* flags appended to info events when the client has the feature */
+#define INFO_FLAG_DELTA		(1u<<0)
+
 PW_LOG_TOPIC_EXTERN(mod_topic);
 #define PW_LOG_TOPIC_DEFAULT mod_topic
 
@@ -40,7 +47,8 @@ static int core_method_marshal_hello(void *object, uint32_t version)
 	b = pw_protocol_native_begin_proxy(proxy, PW_CORE_METHOD_HELLO, NULL);
 
 	spa_pod_builder_add_struct(b,
-			SPA_POD_Int(version));
+			SPA_POD_Int(version),
+			SPA_POD_Int(PROTOCOL_FEATURE_INFO_DELTA));
 
 	return pw_protocol_native_end_proxy(proxy, b);
 }
@@ -216,6 +224,201 @@ do {											\
 	spa_pod_parser_pop(prs, f);							\
 } while(0)
 
+/* Last info sent to a resource or received on a proxy. When the client
+ * announced PROTOCOL_FEATURE_INFO_DELTA, info events only carry the changed
+ * and removed (None value) properties and the params only when they
+ * changed. The proxy side merges them back into complete info so that
+ * listeners see the same events as before. */
+struct info_cache {
+	struct spa_hook listener;
+	struct pw_properties *props;
+	uint32_t n_params;
+	struct spa_param_info *params;
+};
+
+static struct info_cache *info_cache_new(void)
+{
+	struct info_cache *c;
+
+	if ((c = calloc(1, sizeof(*c))) == NULL)
+		return NULL;
+	if ((c->props = pw_properties_new(NULL, NULL)) == NULL) {
+		free(c);
+		return NULL;
+	}
+	return c;
+}
+
+static void info_cache_free(struct info_cache *c)
+{
+	spa_hook_remove(&c->listener);
+	pw_properties_free(c->props);
+	free(c->params);
+	free(c);
+}
+
+static struct info_cache *info_cache_find(struct spa_hook_list *list, const void *events)
+{
+	struct spa_hook *h;
+	spa_list_for_each(h, &list->list, link)
+		if (h->cb.funcs == events)
+			return h->cb.data;
+	return NULL;
+}
+
+static void resource_info_cache_destroy(void *data)
+{
+	info_cache_free(data);
+}
+
+static const struct pw_resource_events resource_info_cache_events = {
+	PW_VERSION_RESOURCE_EVENTS,
+	.destroy = resource_info_cache_destroy,
+};
+
+static struct info_cache *resource_info_cache(struct pw_resource *resource)
+{
+	struct info_cache *c;
+
+	if (!(resource->client->protocol_features & PROTOCOL_FEATURE_INFO_DELTA))
+		return NULL;
+	if ((c = info_cache_find(&resource->listener_list, &resource_info_cache_events)) != NULL)
+		return c;
+	if ((c = info_cache_new()) == NULL)
+		return NULL;
+	pw_resource_add_listener(resource, &c->listener, &resource_info_cache_events, c);
+	return c;
+}
+
+static void push_dict_delta(struct spa_pod_builder *b, struct pw_properties *last,
+		const struct spa_dict *dict)
+{
+	static const struct spa_dict empty = SPA_DICT_INIT(NULL, 0);
+	const struct spa_dict_item *it;
+	struct spa_pod_frame f;
+	uint32_t i, n_changed = 0, n_kept = 0, n_removed;
+
+	if (dict == NULL)
+		dict = &empty;
+
+	spa_dict_for_each(it, dict) {
+		const char *old = pw_properties_get(last, it->key);
+		if (old != NULL)
+			n_kept++;
+		if (!spa_streq(old, it->value))
+			n_changed++;
+	}
+	n_removed = last->dict.n_items - n_kept;
+
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_int(b, n_changed + n_removed);
+	spa_dict_for_each(it, dict) {
+		if (spa_streq(pw_properties_get(last, it->key), it->value))
+			continue;
+		push_item(b, it);
+		pw_properties_set(last, it->key, it->value);
+	}
+	for (i = 0; n_removed > 0 && i < last->dict.n_items;) {
+		const struct spa_dict_item *item = &last->dict.items[i];
+		if (spa_dict_lookup_item(dict, item->key) != NULL) {
+			i++;
+			continue;
+		}
+		spa_pod_builder_string(b, item->key);
+		spa_pod_builder_none(b);
+		/* moves the last item into slot i */
+		pw_properties_set(last, item->key, NULL);
+		n_removed--;
+	}
+	spa_pod_builder_pop(b, &f);
+}
+
+static void push_info_props(struct spa_pod_builder *b, struct info_cache *cache,
+		const struct spa_dict *dict, bool changed)
+{
+	if (!changed)
+		push_dict(b, NULL);
+	else if (cache == NULL)
+		push_dict(b, dict);
+	else
+		push_dict_delta(b, cache->props, dict);
+}
+
+static void push_info_params(struct spa_pod_builder *b, struct info_cache *cache,
+		uint32_t n_params, const struct spa_param_info *params, bool changed)
+{
+	if (cache == NULL || changed)
+		push_params(b, n_params, params);
+	else
+		push_params(b, 0, NULL);
+}
+
+static void push_info_flags(struct spa_pod_builder *b, struct info_cache *cache)
+{
+	if (cache != NULL)
+		spa_pod_builder_int(b, INFO_FLAG_DELTA);
+}
+
+static void proxy_info_cache_destroy(void *data)
+{
+	info_cache_free(data);
+}
+
+static const struct pw_proxy_events proxy_info_cache_events = {
+	PW_VERSION_PROXY_EVENTS,
+	.destroy = proxy_info_cache_destroy,
+};
+
+static int proxy_info_merge(struct pw_proxy *proxy, struct spa_pod_parser *prs,
+		struct spa_dict **props, bool props_changed,
+		uint32_t *n_params, struct spa_param_info **params, bool params_changed)
+{
+	struct info_cache *c;
+	uint32_t flags = 0;
+
+	if (spa_pod_parser_get(prs,
+			SPA_POD_OPT_Int(&flags), NULL) < 0)
+		return -EINVAL;
+
+	c = info_cache_find(&proxy->listener_list, &proxy_info_cache_events);
+
+	if (!(flags & INFO_FLAG_DELTA)) {
+		/* complete info, the server will start over from empty
+		 * when it sends deltas again */
+		if (c != NULL)
+			info_cache_free(c);
+		return 0;
+	}
+	if (c == NULL) {
+		if ((c = info_cache_new()) == NULL)
+			return -errno;
+		pw_proxy_add_listener(proxy, &c->listener, &proxy_info_cache_events, c);
+	}
+	if (props_changed) {
+		const struct spa_dict_item *it;
+		spa_dict_for_each(it, *props)
+			pw_properties_set(c->props, it->key, it->value);
+		*props = &c->props->dict;
+	}
+	if (params_changed) {
+		if (*n_params != c->n_params) {
+			struct spa_param_info *np = NULL;
+			if (*n_params > 0 &&
+			    (np = pw_reallocarray(c->params, *n_params, sizeof(*np))) == NULL)
+				return -errno;
+			if (np == NULL)
+				free(c->params);
+			c->params = np;
+			c->n_params = *n_params;
+		}
+		if (c->n_params > 0)
+			memcpy(c->params, *params, c->n_params * sizeof(struct spa_param_info));
+	} else {
+		*n_params = c->n_params;
+		*params = c->params;
+	}
+	return 0;
+}
 
 #define parse_permissions_struct(prs,f,n_permissions,permissions)				\
 do {												\
@@ -606,13 +809,16 @@ static int core_method_demarshal_hello(void *object, const struct pw_protocol_na
 {
 	struct pw_resource *resource = object;
 	struct spa_pod_parser prs;
-	uint32_t version;
+	uint32_t version, features = 0;
 
 	spa_pod_parser_init(&prs, msg->data, msg->size);
 	if (spa_pod_parser_get_struct(&prs,
-				SPA_POD_Int(&version)) < 0)
+				SPA_POD_Int(&version),
+				SPA_POD_OPT_Int(&features)) < 0)
 		return -EINVAL;
 
+	resource->client->protocol_features = features;
+
 	return pw_resource_notify(resource, struct pw_core_methods, hello, 0, version);
 }
 
@@ -1128,6 +1334,7 @@ static int node_method_marshal_add_listener(void *object,
 static void node_marshal_info(void *data, const struct pw_node_info *info)
 {
 	struct pw_resource *resource = data;
+	struct info_cache *cache = resource_info_cache(resource);
 	struct spa_pod_builder *b;
 	struct spa_pod_frame f;
 
@@ -1144,8 +1351,10 @@ static void node_marshal_info(void *data, const struct pw_node_info *info)
 			    SPA_POD_Id(info->state),
 			    SPA_POD_String(info->error),
 			    NULL);
-	push_dict(b, info->change_mask & PW_NODE_CHANGE_MASK_PROPS ? info->props : NULL);
-	push_params(b, info->n_params, info->params);
+	push_info_props(b, cache, info->props, info->change_mask & PW_NODE_CHANGE_MASK_PROPS);
+	push_info_params(b, cache, info->n_params, info->params,
+			info->change_mask & PW_NODE_CHANGE_MASK_PARAMS);
+	push_info_flags(b, cache);
 	spa_pod_builder_pop(b, &f);
 
 	pw_protocol_native_end_resource(resource, b);
@@ -1158,6 +1367,7 @@ static int node_demarshal_info(void *data, const struct pw_protocol_native_messa
 	struct spa_pod_frame f[2];
 	struct spa_dict props = SPA_DICT_INIT(NULL, 0);
 	struct pw_node_info info = { .props = &props };
+	int res;
 
 	spa_pod_parser_init(&prs, msg->data, msg->size);
 	if (spa_pod_parser_push_struct(&prs, &f[0]) < 0 ||
@@ -1175,6 +1385,12 @@ static int node_demarshal_info(void *data, const struct pw_protocol_native_messa
 	parse_dict_struct(&prs, &f[1], &props);
 	parse_params_struct(&prs, &f[1], info.params, info.n_params);
 
+	if ((res = proxy_info_merge(proxy, &prs,
+			&info.props, info.change_mask & PW_NODE_CHANGE_MASK_PROPS,
+			&info.n_params, &info.params,
+			info.change_mask & PW_NODE_CHANGE_MASK_PARAMS)) < 0)
+		return res;
+
 	return pw_proxy_notify(proxy, struct pw_node_events, info, 0, &info);
 }
 
@@ -1362,6 +1578,7 @@ static int port_method_marshal_add_listener(void *object,
 static void port_marshal_info(void *data, const struct pw_port_info *info)
 {
 	struct pw_resource *resource = data;
+	struct info_cache *cache = resource_info_cache(resource);
 	struct spa_pod_builder *b;
 	struct spa_pod_frame f;
 
@@ -1373,8 +1590,10 @@ static void port_marshal_info(void *data, const struct pw_port_info *info)
 			    SPA_POD_Int(info->direction),
 			    SPA_POD_Long(info->change_mask),
 			    NULL);
-	push_dict(b, info->change_mask & PW_PORT_CHANGE_MASK_PROPS ? info->props : NULL);
-	push_params(b, info->n_params, info->params);
+	push_info_props(b, cache, info->props, info->change_mask & PW_PORT_CHANGE_MASK_PROPS);
+	push_info_params(b, cache, info->n_params, info->params,
+			info->change_mask & PW_PORT_CHANGE_MASK_PARAMS);
+	push_info_flags(b, cache);
 	spa_pod_builder_pop(b, &f);
 
 	pw_protocol_native_end_resource(resource, b);
@@ -1387,6 +1606,7 @@ static int port_demarshal_info(void *data, const struct pw_protocol_native_messa
 	struct spa_pod_frame f[2];
 	struct spa_dict props = SPA_DICT_INIT(NULL, 0);
 	struct pw_port_info info = { .props = &props };
+	int res;
 
 	spa_pod_parser_init(&prs, msg->data, msg->size);
 	if (spa_pod_parser_push_struct(&prs, &f[0]) < 0 ||
@@ -1399,6 +1619,12 @@ static int port_demarshal_info(void *data, const struct pw_protocol_native_messa
 	parse_dict_struct(&prs, &f[1], &props);
 	parse_params_struct(&prs, &f[1], info.params, info.n_params);
 
+	if ((res = proxy_info_merge(proxy, &prs,
+			&info.props, info.change_mask & PW_PORT_CHANGE_MASK_PROPS,
+			&info.n_params, &info.params,
+			info.change_mask & PW_PORT_CHANGE_MASK_PARAMS)) < 0)
+		return res;
+
 	return pw_proxy_notify(proxy, struct pw_port_events, info, 0, &info);
 }
 
@@ -76,6 +76,7 @@
  *     #pulse.default.format   = F32
  *     #pulse.default.position = [ FL FR ]
  *     #pulse.idle.timeout     = 0
+ *     #pulse.event.max-rate   = 0
  * }
  *
  * pulse.properties.rules = [
@@ -247,6 +248,15 @@
  * save battery power. When the client resumes, it will unpause again.
  * A value of 0 disables this feature.
  *
+ *\code{.unparsed}
+ *     pulse.event.max-rate = 0
+ *\endcode
+ *
+ * The maximum number of times per second that subscribe events are sent to a
+ * client. Events that arrive in between are held back and merged so that the
+ * client receives one change event per object. This avoids event storms when
+ * many devices appear at once. A value of 0 sends events right away.
+ *
  * ## Command execution
  *
  * As part of the server startup sequence, a set of commands can be executed.
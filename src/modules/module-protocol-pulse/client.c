@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 
@@ -47,6 +48,9 @@ struct client *client_new(struct server *server)
 
 	pw_map_init(&client->streams, 16, 16);
 	spa_list_init(&client->out_messages);
+	spa_list_init(&client->pending_events);
+	for (uint32_t i = 0; i < SUBSCRIBE_HASH_SIZE; i++)
+		spa_list_init(&client->subscribe_events[i]);
 	spa_list_init(&client->operations);
 	spa_list_init(&client->pending_samples);
 	spa_hook_list_init(&client->listener_list);
@@ -116,6 +120,11 @@ void client_disconnect(struct client *client)
 		client->source = NULL;
 	}
 
+	if (client->event_timer) {
+		pw_loop_destroy_source(impl->loop, client->event_timer);
+		client->event_timer = NULL;
+	}
+
 	if (client->manager) {
 		pw_manager_destroy(client->manager);
 		client->manager = NULL;
@@ -146,6 +155,9 @@ void client_free(struct client *client)
 	spa_list_consume(msg, &client->out_messages, link)
 		message_free(msg, true, false);
 
+	spa_list_consume(msg, &client->pending_events, link)
+		message_free(msg, true, false);
+
 	spa_list_consume(o, &client->operations, link)
 		operation_free(o);
 
@@ -289,11 +301,13 @@ int client_flush_messages(struct client *client)
 
 static bool drop_from_out_queue(struct client *client, struct message *m)
 {
-	spa_assert(!spa_list_is_empty(&client->out_messages));
-
-	struct message *first = spa_list_first(&client->out_messages, struct message, link);
-	if (m == first && client->out_index > 0)
-		return false;
+	/* the first message might be partially sent already, events held
+	 * back in pending_events can always be dropped */
+	if (!spa_list_is_empty(&client->out_messages)) {
+		struct message *first = spa_list_first(&client->out_messages, struct message, link);
+		if (m == first && client->out_index > 0)
+			return false;
+	}
 
 	message_free(m, true, false);
 
@@ -301,6 +315,12 @@ static bool drop_from_out_queue(struct client *client, struct message *m)
 }
 
 /* returns true if an event with the (mask, event, index) triplet should be dropped because it is redundant */
+static inline struct spa_list *subscribe_bucket(struct client *client, uint32_t event, uint32_t index)
+{
+	uint32_t facility = event & SUBSCRIPTION_EVENT_FACILITY_MASK;
+	return &client->subscribe_events[(index * 31 + facility) & (SUBSCRIBE_HASH_SIZE - 1)];
+}
+
 static bool client_prune_subscribe_events(struct client *client, uint32_t event, uint32_t index)
 {
 	struct message *m, *t;
@@ -308,10 +328,10 @@ static bool client_prune_subscribe_events(struct client *client, uint32_t event,
 	if ((event & SUBSCRIPTION_EVENT_TYPE_MASK) == SUBSCRIPTION_EVENT_NEW)
 		return false;
 
-	/* NOTE: reverse iteration */
-	spa_list_for_each_safe_reverse(m, t, &client->out_messages, link) {
-		if (m->type != MESSAGE_TYPE_SUBSCRIPTION_EVENT)
-			continue;
+	/* NOTE: reverse iteration, the bucket has the queued events
+	 * of a few objects in queue order */
+	spa_list_for_each_safe_reverse(m, t, subscribe_bucket(client, event, index),
+			u.subscription_event.hash_link) {
 		if ((m->u.subscription_event.event ^ event) & SUBSCRIPTION_EVENT_FACILITY_MASK)
 			continue;
 		if (m->u.subscription_event.index != index)
@@ -354,6 +374,61 @@ drop:
 	return true;
 }
 
+static void client_flush_pending_events(struct client *client)
+{
+	struct message *m;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	client->last_event_flush = SPA_TIMESPEC_TO_NSEC(&now);
+
+	spa_list_consume(m, &client->pending_events, link) {
+		spa_list_remove(&m->link);
+		client_queue_message(client, m);
+	}
+}
+
+static void on_event_timeout(void *data, uint64_t expirations)
+{
+	client_flush_pending_events(data);
+}
+
+/* With pulse.event.max-rate, events are sent at most that many times per
+ * second. Events that arrive in between are held back and pruned so that
+ * the client gets one event per object on the next flush. */
+static int client_queue_rate_limited(struct client *client, struct message *msg)
+{
+	struct impl *impl = client->impl;
+	struct timespec now, timeout = {0}, interval = {0};
+	uint64_t next, current;
+
+	spa_list_append(&client->pending_events, &msg->link);
+
+	/* already waiting for the timeout */
+	if (client->pending_events.next != &msg->link)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	current = SPA_TIMESPEC_TO_NSEC(&now);
+	next = client->last_event_flush + SPA_NSEC_PER_SEC / impl->defs.event_max_rate;
+
+	if (current >= next) {
+		client_flush_pending_events(client);
+		return 0;
+	}
+
+	if (client->event_timer == NULL)
+		client->event_timer = pw_loop_add_timer(impl->loop, on_event_timeout, client);
+	if (client->event_timer == NULL) {
+		client_flush_pending_events(client);
+		return -errno;
+	}
+	timeout.tv_sec = next / SPA_NSEC_PER_SEC;
+	timeout.tv_nsec = next % SPA_NSEC_PER_SEC;
+	pw_loop_update_timer(impl->loop, client->event_timer, &timeout, &interval, true);
+	return 0;
+}
+
 int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t event, uint32_t index)
 {
 	if (client->disconnect)
@@ -374,6 +449,8 @@ int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t
 	reply->type = MESSAGE_TYPE_SUBSCRIPTION_EVENT;
 	reply->u.subscription_event.event = event;
 	reply->u.subscription_event.index = index;
+	spa_list_append(subscribe_bucket(client, event, index),
+			&reply->u.subscription_event.hash_link);
 
 	message_put(reply,
 		TAG_U32, COMMAND_SUBSCRIBE_EVENT,
@@ -382,5 +459,8 @@ int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t
 		TAG_U32, index,
 		TAG_INVALID);
 
+	if (client->impl->defs.event_max_rate > 0)
+		return client_queue_rate_limited(client, reply);
+
 	return client_queue_message(client, reply);
 }
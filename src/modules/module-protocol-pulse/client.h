@@ -22,6 +22,8 @@ struct pw_manager;
 struct pw_manager_object;
 struct pw_properties;
 
+#define SUBSCRIBE_HASH_SIZE	64u
+
 struct descriptor {
 	uint32_t length;
 	uint32_t channel;
@@ -70,6 +72,13 @@ struct client {
 	struct pw_map streams;
 	struct spa_list out_messages;
 
+	/* queued subscribe events by facility and index */
+	struct spa_list subscribe_events[SUBSCRIBE_HASH_SIZE];
+	/* subscribe events held back by pulse.event.max-rate */
+	struct spa_list pending_events;
+	struct spa_source *event_timer;
+	uint64_t last_event_flush;
+
 	struct spa_list operations;
 
 	struct spa_list pending_samples;
@@ -29,11 +29,29 @@ void select_best(struct selector *s, struct pw_manager_object *o)
 	}
 }
 
+static inline bool is_selected(struct selector *s, struct pw_manager_object *o)
+{
+	return o != NULL && !o->creating && !o->removing &&
+		(s->type == NULL || s->type(o));
+}
+
 struct pw_manager_object *select_object(struct pw_manager *m, struct selector *s)
 {
-	struct pw_manager_object *o;
+	struct pw_manager_object *o, *i;
 	const char *str;
 
+	if (s->key == NULL && s->value == NULL && s->accumulate == NULL) {
+		/* only id and index, use the lookup tables. When they point to
+		 * different objects, take the oldest one like the scan below. */
+		o = pw_manager_find_object(m, s->id);
+		if (!is_selected(s, o))
+			o = NULL;
+		i = pw_manager_find_object_by_index(m, s->index);
+		if (is_selected(s, i) && (o == NULL || i->serial < o->serial))
+			o = i;
+		return o ? o : s->best;
+	}
+
 	spa_list_for_each(o, &m->object_list, link) {
 		if (o->creating || o->removing)
 			continue;
@@ -57,32 +75,18 @@ struct pw_manager_object *select_object(struct pw_manager *m, struct selector *s
 
 uint32_t id_to_index(struct pw_manager *m, uint32_t id)
 {
-	struct pw_manager_object *o;
-	spa_list_for_each(o, &m->object_list, link) {
-		if (o->id == id)
-			return o->index;
-	}
-	return SPA_ID_INVALID;
+	struct pw_manager_object *o = pw_manager_find_object(m, id);
+	return o ? o->index : SPA_ID_INVALID;
 }
 
-static bool collect_is_linked(struct pw_manager *m, uint32_t id, enum pw_direction direction)
+static int link_found(void *data, struct pw_manager_object *o)
 {
-	struct pw_manager_object *o;
-	uint32_t in_node, out_node;
-
-	spa_list_for_each(o, &m->object_list, link) {
-		if (o->props == NULL || !pw_manager_object_is_link(o))
-			continue;
-
-		if (pw_properties_fetch_uint32(o->props, PW_KEY_LINK_OUTPUT_NODE, &out_node) != 0 ||
-                    pw_properties_fetch_uint32(o->props, PW_KEY_LINK_INPUT_NODE, &in_node) != 0)
-                        continue;
+	return 1;
+}
 
-		if ((direction == PW_DIRECTION_OUTPUT && id == out_node) ||
-		    (direction == PW_DIRECTION_INPUT && id == in_node))
-			return true;
-	}
-	return false;
+static bool collect_is_linked(struct pw_manager *m, uint32_t id, enum pw_direction direction)
+{
+	return pw_manager_for_each_link(m, id, direction, link_found, NULL) != 0;
 }
 
 struct pw_manager_object *find_peer_for_link(struct pw_manager *m,
@@ -111,17 +115,26 @@ struct pw_manager_object *find_peer_for_link(struct pw_manager *m,
 	return NULL;
 }
 
+struct find_linked_data {
+	struct pw_manager *manager;
+	uint32_t id;
+	enum pw_direction direction;
+	struct pw_manager_object *peer;
+};
+
+static int find_linked_peer(void *data, struct pw_manager_object *o)
+{
+	struct find_linked_data *d = data;
+	d->peer = find_peer_for_link(d->manager, o, d->id, d->direction);
+	return d->peer != NULL;
+}
+
 struct pw_manager_object *find_linked(struct pw_manager *m, uint32_t id, enum pw_direction direction)
 {
-	struct pw_manager_object *o, *p;
+	struct find_linked_data d = { m, id, direction, NULL };
 
-	spa_list_for_each(o, &m->object_list, link) {
-		if (!pw_manager_object_is_link(o))
-			continue;
-		if ((p = find_peer_for_link(m, o, id, direction)) != NULL)
-			return p;
-	}
-	return NULL;
+	pw_manager_for_each_link(m, id, direction, find_linked_peer, &d);
+	return d.peer;
 }
 
 void collect_card_info(struct pw_manager_object *card, struct card_info *info)
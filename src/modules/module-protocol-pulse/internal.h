@@ -36,6 +36,7 @@ struct defs {
 	struct channel_map channel_map;
 	uint32_t quantum_limit;
 	uint32_t idle_timeout;
+	uint32_t event_max_rate;
 };
 
 struct stats {
@@ -21,8 +21,17 @@
 #define manager_emit_disconnect(m) spa_hook_list_call(&(m)->hooks, struct pw_manager_events, disconnect, 0)
 #define manager_emit_object_data_timeout(m,o,k) spa_hook_list_call(&(m)->hooks, struct pw_manager_events, object_data_timeout,0,o,k)
 
+#define HASH_MIN_SIZE	64u
+
 struct object;
 
+struct hash_bucket {
+	struct spa_list by_id;
+	struct spa_list by_index;
+	struct spa_list by_output;	/**< links by output node */
+	struct spa_list by_input;	/**< links by input node */
+};
+
 struct manager {
 	struct pw_manager this;
 
@@ -33,6 +42,9 @@ struct manager {
 	int sync_seq;
 
 	struct spa_hook_list hooks;
+
+	struct hash_bucket *buckets;
+	uint32_t n_buckets;
 };
 
 struct object_info {
@@ -65,6 +77,13 @@ struct object {
 	struct spa_hook object_listener;
 
 	struct spa_list data_list;
+
+	struct spa_list id_link;
+	struct spa_list index_link;
+	struct spa_list output_link;
+	struct spa_list input_link;
+	uint32_t output_node;
+	uint32_t input_node;
 };
 
 static int core_sync(struct manager *m)
@@ -132,16 +151,84 @@ static bool has_param(struct spa_list *param_list, struct pw_manager_param *p)
 	return false;
 }
 
-static struct object *find_object_by_id(struct manager *m, uint32_t id)
+static inline struct hash_bucket *hash_bucket(struct manager *m, uint32_t key)
+{
+	return &m->buckets[(key * 0x9e3779b1u) >> 16 & (m->n_buckets - 1)];
+}
+
+static void hash_add(struct manager *m, struct object *o)
+{
+	if (o->this.id != SPA_ID_INVALID)
+		spa_list_append(&hash_bucket(m, o->this.id)->by_id, &o->id_link);
+	if (o->this.index != SPA_ID_INVALID)
+		spa_list_append(&hash_bucket(m, o->this.index)->by_index, &o->index_link);
+	if (o->output_node != SPA_ID_INVALID && o->input_node != SPA_ID_INVALID) {
+		spa_list_append(&hash_bucket(m, o->output_node)->by_output, &o->output_link);
+		spa_list_append(&hash_bucket(m, o->input_node)->by_input, &o->input_link);
+	}
+}
+
+static void hash_remove(struct object *o)
+{
+	spa_list_remove(&o->id_link);
+	spa_list_remove(&o->index_link);
+	spa_list_remove(&o->output_link);
+	spa_list_remove(&o->input_link);
+	spa_list_init(&o->id_link);
+	spa_list_init(&o->index_link);
+	spa_list_init(&o->output_link);
+	spa_list_init(&o->input_link);
+}
+
+static int hash_resize(struct manager *m, uint32_t size)
 {
+	struct hash_bucket *buckets;
 	struct object *o;
+	uint32_t i;
+
+	buckets = calloc(size, sizeof(struct hash_bucket));
+	if (buckets == NULL)
+		return -errno;
+
+	for (i = 0; i < size; i++) {
+		spa_list_init(&buckets[i].by_id);
+		spa_list_init(&buckets[i].by_index);
+		spa_list_init(&buckets[i].by_output);
+		spa_list_init(&buckets[i].by_input);
+	}
+	free(m->buckets);
+	m->buckets = buckets;
+	m->n_buckets = size;
+
+	/* rehash in list order so that the bucket chains keep the order
+	 * of the object_list */
 	spa_list_for_each(o, &m->this.object_list, this.link) {
+		hash_remove(o);
+		hash_add(m, o);
+	}
+	return 0;
+}
+
+static struct object *find_object_by_id(struct manager *m, uint32_t id)
+{
+	struct object *o;
+	spa_list_for_each(o, &hash_bucket(m, id)->by_id, id_link) {
 		if (o->this.id == id)
 			return o;
 	}
 	return NULL;
 }
 
+static struct object *find_object_by_index(struct manager *m, uint32_t index)
+{
+	struct object *o;
+	spa_list_for_each(o, &hash_bucket(m, index)->by_index, index_link) {
+		if (o->this.index == index)
+			return o;
+	}
+	return NULL;
+}
+
 static void object_update_params(struct object *o)
 {
 	struct pw_manager_param *p, *t;
@@ -190,6 +277,7 @@ static void object_destroy(struct object *o)
 	struct manager *m = o->manager;
 	struct object_data *d;
 	spa_list_remove(&o->this.link);
+	hash_remove(o);
 	m->this.n_objects--;
 	if (o->this.proxy)
 		pw_proxy_destroy(o->this.proxy);
@@ -522,6 +610,7 @@ static int metadata_property(void *data,
 {
 	struct object *o = data;
 	struct manager *m = o->manager;
+	m->this.generation++;
 	manager_emit_metadata(m, &o->this, subject, key, type, value);
 	return 0;
 }
@@ -536,6 +625,7 @@ static void metadata_init(struct object *object)
 	struct object *o = object;
 	struct manager *m = o->manager;
 	o->this.creating = false;
+	m->this.generation++;
 	manager_emit_added(m, &o->this);
 }
 
@@ -638,10 +728,25 @@ static void registry_event_global(void *data, uint32_t id,
 	spa_list_init(&o->pending_list);
 	spa_list_init(&o->data_list);
 
+	spa_list_init(&o->id_link);
+	spa_list_init(&o->index_link);
+	spa_list_init(&o->output_link);
+	spa_list_init(&o->input_link);
+	o->output_node = o->input_node = SPA_ID_INVALID;
+	if (info == &link_info && o->this.props != NULL &&
+	    (pw_properties_fetch_uint32(o->this.props, PW_KEY_LINK_OUTPUT_NODE, &o->output_node) != 0 ||
+	     pw_properties_fetch_uint32(o->this.props, PW_KEY_LINK_INPUT_NODE, &o->input_node) != 0))
+		o->output_node = o->input_node = SPA_ID_INVALID;
+
+	if (m->this.n_objects >= m->n_buckets)
+		hash_resize(m, m->n_buckets * 2);
+
 	o->manager = m;
 	o->info = info;
 	spa_list_append(&m->this.object_list, &o->this.link);
+	hash_add(m, o);
 	m->this.n_objects++;
+	m->this.generation++;
 
 	if (info->events)
 		pw_proxy_add_object_listener(proxy,
@@ -666,6 +771,7 @@ static void registry_event_global_remove(void *data, uint32_t id)
 		return;
 
 	o->this.removing = true;
+	m->this.generation++;
 
 	if (!o->this.creating) {
 		o->this.change_mask = ~0;
@@ -705,9 +811,11 @@ static void on_core_done(void *data, uint32_t id, int seq)
 		spa_list_for_each(o, &m->this.object_list, this.link) {
 			if (o->this.creating) {
 				o->this.creating = false;
+				m->this.generation++;
 				manager_emit_added(m, &o->this);
 				o->changed = 0;
 			} else if (o->changed > 0) {
+				m->this.generation++;
 				manager_emit_updated(m, &o->this);
 				o->changed = 0;
 			}
@@ -757,6 +865,12 @@ struct pw_manager *pw_manager_new(struct pw_core *core)
 
 	spa_list_init(&m->this.object_list);
 
+	if (hash_resize(m, HASH_MIN_SIZE) < 0) {
+		pw_proxy_destroy((struct pw_proxy*)m->this.registry);
+		free(m);
+		return NULL;
+	}
+
 	pw_core_add_listener(m->this.core,
 			&m->core_listener,
 			&core_events, m);
@@ -814,6 +928,47 @@ int pw_manager_set_metadata(struct pw_manager *manager,
 	return 0;
 }
 
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager, uint32_t id)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *o = find_object_by_id(m, id);
+	return o ? &o->this : NULL;
+}
+
+struct pw_manager_object *pw_manager_find_object_by_index(struct pw_manager *manager,
+		uint32_t index)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *o = find_object_by_index(m, index);
+	return o ? &o->this : NULL;
+}
+
+int pw_manager_for_each_link(struct pw_manager *manager,
+		uint32_t node_id, enum pw_direction direction,
+		int (*callback) (void *data, struct pw_manager_object *link),
+		void *data)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct hash_bucket *b = hash_bucket(m, node_id);
+	struct object *o;
+	int res;
+
+	if (direction == PW_DIRECTION_OUTPUT) {
+		spa_list_for_each(o, &b->by_output, output_link) {
+			if (o->output_node == node_id &&
+			    (res = callback(data, &o->this)) != 0)
+				return res;
+		}
+	} else {
+		spa_list_for_each(o, &b->by_input, input_link) {
+			if (o->input_node == node_id &&
+			    (res = callback(data, &o->this)) != 0)
+				return res;
+		}
+	}
+	return 0;
+}
+
 int pw_manager_for_each_object(struct pw_manager *manager,
 		int (*callback) (void *data, struct pw_manager_object *object),
 		void *data)
@@ -849,6 +1004,7 @@ void pw_manager_destroy(struct pw_manager *manager)
 	if (m->this.info)
 		pw_core_info_free(m->this.info);
 
+	free(m->buckets);
 	free(m);
 }
 
@@ -902,6 +1058,7 @@ static void object_data_timeout(void *data, uint64_t count)
 		d->timer = NULL;
 	}
 
+	m->this.generation++;
 	manager_emit_object_data_timeout(m, &o->this, d->key);
 }
 
@@ -918,6 +1075,7 @@ void *pw_manager_object_add_temporary_data(struct pw_manager_object *obj, const
 		return NULL;
 
 	d = SPA_PTROFF(data, -sizeof(struct object_data), void);
+	o->manager->this.generation++;
 
 	if (d->timer == NULL)
 		d->timer = pw_loop_add_timer(o->manager->loop, object_data_timeout, d);
@@ -51,6 +51,8 @@ struct pw_manager {
 
 	uint32_t n_objects;
 	struct spa_list object_list;
+
+	uint64_t generation;	/**< incremented when an object, link or metadata changes */
 };
 
 struct pw_manager_param {
@@ -105,6 +107,16 @@ int pw_manager_for_each_object(struct pw_manager *manager,
 		int (*callback) (void *data, struct pw_manager_object *object),
 		void *data);
 
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager, uint32_t id);
+struct pw_manager_object *pw_manager_find_object_by_index(struct pw_manager *manager,
+		uint32_t index);
+
+/* iterate the links with node_id as the output or input node */
+int pw_manager_for_each_link(struct pw_manager *manager,
+		uint32_t node_id, enum pw_direction direction,
+		int (*callback) (void *data, struct pw_manager_object *link),
+		void *data);
+
 void *pw_manager_object_add_data(struct pw_manager_object *o, const char *key, size_t size);
 void *pw_manager_object_get_data(struct pw_manager_object *obj, const char *key);
 void *pw_manager_object_add_temporary_data(struct pw_manager_object *o, const char *key,
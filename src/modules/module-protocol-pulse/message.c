@@ -581,6 +581,17 @@ static void write_format_info(struct message *m, struct format_info *info)
 	write_dict(m, info->props ? &info->props->dict : NULL, false);
 }
 
+int message_put_raw(struct message *m, const void *data, uint32_t size)
+{
+	if (m == NULL)
+		return -EINVAL;
+
+	if (ensure_size(m, size) > 0)
+		memcpy(m->data + m->length, data, size);
+	m->length += size;
+	return 0;
+}
+
 int message_put(struct message *m, ...)
 {
 	va_list va;
@@ -860,6 +871,11 @@ void message_free(struct message *msg, bool dequeue, bool destroy)
 	if (dequeue)
 		spa_list_remove(&msg->link);
 
+	if (msg->type == MESSAGE_TYPE_SUBSCRIPTION_EVENT) {
+		spa_list_remove(&msg->u.subscription_event.hash_link);
+		msg->type = MESSAGE_TYPE_UNSPECIFIED;
+	}
+
 	if (msg->impl->stat.allocated > MAX_ALLOCATED || msg->allocated > MAX_SIZE)
 		destroy = true;
 
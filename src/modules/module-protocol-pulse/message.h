@@ -32,6 +32,7 @@ struct message {
 		struct {
 			uint32_t event;
 			uint32_t index;
+			struct spa_list hash_link;	/**< link in client subscribe_events */
 		} subscription_event;
 	} u;
 };
@@ -62,6 +63,7 @@ struct message *message_alloc(struct impl *impl, uint32_t channel, uint32_t size
 void message_free(struct message *msg, bool dequeue, bool destroy);
 int message_get(struct message *m, ...);
 int message_put(struct message *m, ...);
+int message_put_raw(struct message *m, const void *data, uint32_t size);
 int message_dump(enum spa_log_level level, const char *prefix, struct message *m);
 
 #endif /* PULSE_SERVER_MESSAGE_H */
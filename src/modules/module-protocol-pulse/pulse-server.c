@@ -66,6 +66,7 @@
 #define DEFAULT_FORMAT		"F32"
 #define DEFAULT_POSITION	"[ FL FR ]"
 #define DEFAULT_IDLE_TIMEOUT	"0"
+#define DEFAULT_EVENT_MAX_RATE	"0"
 
 #define MAX_FORMATS	32
 /* The max amount of data we send in one block when capturing. In PulseAudio this
@@ -4391,12 +4392,52 @@ struct info_list_data {
 	struct client *client;
 	struct message *reply;
 	int (*fill_func) (struct client *client, struct message *m, struct pw_manager_object *o);
+	const char *cache_key;
+};
+
+/* The encoded info of an object, reused until something in the manager
+ * changes. The info of an object also depends on other objects (card,
+ * links, modules) so any change invalidates all of them. */
+struct info_cache {
+	uint64_t generation;
+	uint64_t quirks;
+	uint32_t version;
+	uint32_t size;
+	uint8_t data[];
 };
 
 static int do_list_info(void *data, struct pw_manager_object *object)
 {
 	struct info_list_data *info = data;
-	info->fill_func(info->client, info->reply, object);
+	struct client *client = info->client;
+	struct message *m = info->reply;
+	struct info_cache *cache;
+	uint32_t start = m->length, size;
+
+	cache = pw_manager_object_get_data(object, info->cache_key);
+	if (cache != NULL &&
+	    cache->generation == client->manager->generation &&
+	    cache->version == client->version &&
+	    cache->quirks == client->quirks) {
+		message_put_raw(m, cache->data, cache->size);
+		return 0;
+	}
+
+	if (info->fill_func(client, m, object) < 0 ||
+	    m->length > m->allocated || m->length == start)
+		return 0;
+
+	size = m->length - start;
+	cache = pw_manager_object_add_data(object, info->cache_key,
+			sizeof(struct info_cache) + size);
+	if (cache == NULL)
+		return 0;
+
+	cache->generation = client->manager->generation;
+	cache->quirks = client->quirks;
+	cache->version = client->version;
+	cache->size = size;
+	memcpy(cache->data, m->data + start, size);
 	return 0;
 }
 
@@ -4423,24 +4464,31 @@ static int do_get_info_list(struct client *client, uint32_t command, uint32_t ta
 	switch (command) {
 	case COMMAND_GET_CLIENT_INFO_LIST:
 		info.fill_func = fill_client_info;
+		info.cache_key = "pulse.info.client";
 		break;
 	case COMMAND_GET_MODULE_INFO_LIST:
 		info.fill_func = fill_module_info;
+		info.cache_key = "pulse.info.module";
 		break;
 	case COMMAND_GET_CARD_INFO_LIST:
 		info.fill_func = fill_card_info;
+		info.cache_key = "pulse.info.card";
 		break;
 	case COMMAND_GET_SINK_INFO_LIST:
 		info.fill_func = fill_sink_info;
+		info.cache_key = "pulse.info.sink";
 		break;
 	case COMMAND_GET_SOURCE_INFO_LIST:
 		info.fill_func = fill_source_info;
+		info.cache_key = "pulse.info.source";
 		break;
 	case COMMAND_GET_SINK_INPUT_INFO_LIST:
 		info.fill_func = fill_sink_input_info;
+		info.cache_key = "pulse.info.sink-input";
 		break;
 	case COMMAND_GET_SOURCE_OUTPUT_INFO_LIST:
 		info.fill_func = fill_source_output_info;
+		info.cache_key = "pulse.info.source-output";
 		break;
 	default:
 		return -ENOTSUP;
@@ -5488,6 +5536,7 @@ static void load_defaults(struct defs *def, struct pw_properties *props)
 	parse_format(props, "pulse.default.format", DEFAULT_FORMAT, &def->sample_spec);
 	parse_position(props, "pulse.default.position", DEFAULT_POSITION, &def->channel_map);
 	parse_uint32(props, "pulse.idle.timeout", DEFAULT_IDLE_TIMEOUT, &def->idle_timeout);
+	parse_uint32(props, "pulse.event.max-rate", DEFAULT_EVENT_MAX_RATE, &def->event_max_rate);
 	def->sample_spec.channels = def->channel_map.channels;
 	def->quantum_limit = 8192;
 }
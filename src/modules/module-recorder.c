@@ -0,0 +1,811 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "config.h"
+
+#include <spa/utils/result.h>
+#include <spa/utils/string.h>
+#include <spa/utils/json.h>
+#include <spa/utils/ringbuffer.h>
+#include <spa/utils/atomic.h>
+#include <spa/debug/types.h>
+#include <spa/pod/builder.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/audio/raw.h>
+
+#include <spa/plugins/audioconvert/wavfile.h>
+
+#include <pipewire/impl.h>
+#include <pipewire/i18n.h>
+
+/** \page page_module_recorder Recorder
+ *
+ * The recorder writes everything it receives to WAV files on disk. It is
+ * meant for recording many channels for a long time, like for broadcast
+ * logging.
+ *
+ * The process callback only copies the samples to a ringbuffer. A separate
+ * thread collects them into large blocks that are written with O_DIRECT,
+ * bypassing the page cache. When the filesystem can't do O_DIRECT, the same
+ * large writes are done and the pages are dropped after writing.
+ *
+ * When `record.rotate` is set, a new file is started after the given
+ * number of seconds. The files follow each other without gaps. Because the
+ * WAV header can only describe 4GB of data, files are also rotated when
+ * they would grow larger than that.
+ *
+ * The stream has one port per channel. Load the module once for each
+ * device that needs to be recorded.
+ *
+ * ## Module Name
+ *
+ * `libpipewire-module-recorder`
+ *
+ * ## Module Options
+ *
+ * - `record.path = <str>`: the file to record to. This is passed to strftime
+ *   so that the start time can be made part of the name.
+ *   Default "pipewire-%Y%m%d-%H%M%S.wav"
+ * - `record.rotate = <int>`: start a new file after this many seconds,
+ *   0 to disable. Default 0
+ * - `record.buffer = <int>`: the size of the ringbuffer in milliseconds.
+ *   Default 2000
+ * - `record.block-size = <int>`: the size of the disk writes in bytes.
+ *   Default 1048576
+ * - `record.direct = <bool>`: use O_DIRECT and aligned writes. Default true
+ * - `record.preallocate = <bool>`: allocate the disk space of a complete
+ *   file when it is opened. Only used with `record.rotate` and only on
+ *   Linux. Default true
+ * - `stream.props = {}`: properties to be passed to the stream
+ *
+ * The stream properties are checked every second and updated when one of
+ * them changed:
+ *
+ * - `record.file`: the file that is being written
+ * - `record.queue.depth`: the largest amount of data in milliseconds that was
+ *   waiting to be written since the recording started
+ * - `record.overruns`: the number of times data was dropped because the
+ *   ringbuffer was full
+ *
+ * ## General options
+ *
+ * Options with well-known behavior.
+ *
+ * - \ref PW_KEY_REMOTE_NAME
+ * - \ref PW_KEY_AUDIO_FORMAT
+ * - \ref PW_KEY_AUDIO_RATE
+ * - \ref PW_KEY_AUDIO_CHANNELS
+ * - \ref SPA_KEY_AUDIO_POSITION
+ * - \ref PW_KEY_NODE_LATENCY
+ * - \ref PW_KEY_NODE_NAME
+ * - \ref PW_KEY_NODE_DESCRIPTION
+ * - \ref PW_KEY_NODE_GROUP
+ * - \ref PW_KEY_MEDIA_CLASS
+ * - \ref PW_KEY_TARGET_OBJECT
+ *
+ * ## Example configuration
+ *
+ *\code{.unparsed}
+ * # ~/.config/pipewire/pipewire.conf.d/my-recorder.conf
+ *
+ * context.modules = [
+ * {   name = libpipewire-module-recorder
+ *     args = {
+ *         node.name = "recorder-1"
+ *         record.path = "/srv/log/desk1-%Y%m%d-%H%M%S.wav"
+ *         record.rotate = 3600
+ *         audio.format = S24
+ *         audio.channels = 64
+ *         stream.props = {
+ *             target.object = "alsa_input.desk1"
+ *             stream.dont-remix = true
+ *         }
+ *     }
+ * }
+ * ]
+ *\endcode
+ */
+
+#define NAME "recorder"
+
+PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
+#define PW_LOG_TOPIC_DEFAULT mod_topic
+
+#define DEFAULT_FORMAT "S24"
+#define DEFAULT_RATE 48000
+#define DEFAULT_CHANNELS 2
+#define DEFAULT_POSITION "[ FL FR ]"
+#define DEFAULT_PATH "pipewire-%Y%m%d-%H%M%S.wav"
+#define DEFAULT_BUFFER_MS 2000
+#define DEFAULT_BLOCK_SIZE (1024 * 1024)
+
+/* the WAV header uses 32 bits for the data size */
+#define MAX_FILE_SIZE ((uint64_t)UINT32_MAX - 65536)
+
+#define MODULE_USAGE	"( node.latency=<latency as fraction> ) "				\
+			"( node.name=<name of the nodes> ) "					\
+			"( node.description=<description of the nodes> ) "			\
+			"( audio.format=<format, default:"DEFAULT_FORMAT"> ) "			\
+			"( audio.rate=<sample rate, default: "SPA_STRINGIFY(DEFAULT_RATE)"> ) "			\
+			"( audio.channels=<number of channels, default:"SPA_STRINGIFY(DEFAULT_CHANNELS) "> ) "	\
+			"( audio.position=<channel map, default:"DEFAULT_POSITION"> ) "		\
+			"( record.path=<strftime file pattern, default:"DEFAULT_PATH"> ) "	\
+			"( record.rotate=<seconds per file> ) "					\
+			"( record.buffer=<buffer size in ms, default:"SPA_STRINGIFY(DEFAULT_BUFFER_MS)"> ) "	\
+			"( record.block-size=<write size in bytes> ) "				\
+			"( record.direct=<use O_DIRECT, default:true> ) "			\
+			"( record.preallocate=<allocate files, default:true> ) "		\
+			"( stream.props=<properties> ) "
+
+
+static const struct spa_dict_item module_props[] = {
+	{ PW_KEY_MODULE_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
+	{ PW_KEY_MODULE_DESCRIPTION, "Record audio to disk" },
+	{ PW_KEY_MODULE_USAGE, MODULE_USAGE },
+	{ PW_KEY_MODULE_VERSION, PACKAGE_VERSION },
+};
+
+struct impl {
+	struct pw_context *context;
+	struct pw_loop *main_loop;
+
+	struct pw_properties *props;
+
+	struct pw_impl_module *module;
+
+	struct spa_hook module_listener;
+
+	struct pw_core *core;
+	struct spa_hook core_proxy_listener;
+	struct spa_hook core_listener;
+
+	struct pw_properties *stream_props;
+	struct pw_stream *stream;
+	struct spa_hook stream_listener;
+	struct spa_audio_info_raw info;
+	uint32_t frame_size;
+
+	const char *path;
+	uint64_t rotate_frames;
+	uint32_t block_size;
+	unsigned int direct:1;
+	unsigned int preallocate:1;
+	unsigned int do_disconnect:1;
+
+	/* filled by the data thread, emptied by the writer */
+	struct spa_ringbuffer ring;
+	void *buffer;
+	uint32_t buffer_size;
+	uint32_t threshold;
+
+	struct pw_thread_loop *writer;
+	struct spa_source *wakeup;
+
+	/* only used from the writer thread */
+	struct wav_file *file;
+	uint64_t file_frames;
+	uint32_t file_index;
+	char filename[PATH_MAX];
+	char prev_filename[PATH_MAX];
+	bool failed;
+
+	/* stats, reported on the stream */
+	struct spa_source *stats_timer;
+	pthread_mutex_t stats_lock;	/* only held to copy stats_filename */
+	char stats_filename[PATH_MAX];
+	uint32_t queue_max;
+	uint32_t overruns;
+	/* the last values that were published on the stream */
+	uint32_t reported_overruns;
+	uint64_t reported_depth;
+	char reported_filename[PATH_MAX];
+};
+
+static int open_file(struct impl *impl)
+{
+	struct wav_file_info info;
+	char name[PATH_MAX];
+	time_t now;
+	struct tm tm;
+
+	now = time(NULL);
+	localtime_r(&now, &tm);
+	if (strftime(name, sizeof(name), impl->path, &tm) == 0) {
+		pw_log_error("can't make a file name from %s", impl->path);
+		return -ENAMETOOLONG;
+	}
+
+	/* rotating faster than the pattern changes, number the files */
+	if (spa_streq(name, impl->prev_filename)) {
+		const char *base = strrchr(name, '/');
+		const char *ext = strrchr(base ? base : name, '.');
+		int len = ext ? ext - name : (int)strlen(name);
+
+		snprintf(impl->filename, sizeof(impl->filename), "%.*s-%u%s",
+				len, name, ++impl->file_index, ext ? ext : "");
+	} else {
+		snprintf(impl->filename, sizeof(impl->filename), "%s", name);
+		impl->file_index = 0;
+	}
+	snprintf(impl->prev_filename, sizeof(impl->prev_filename), "%s", name);
+
+	spa_zero(info);
+	info.info.media_type = SPA_MEDIA_TYPE_audio;
+	info.info.media_subtype = SPA_MEDIA_SUBTYPE_raw;
+	info.info.info.raw = impl->info;
+	if (impl->direct)
+		info.flags |= WAV_FILE_FLAG_DIRECT;
+	info.block_size = impl->block_size;
+	if (impl->preallocate)
+		info.preallocate = impl->rotate_frames * impl->frame_size;
+
+	impl->file = wav_file_open(impl->filename, "w", &info);
+	if (impl->file == NULL)
+		return -errno;
+
+	impl->file_frames = 0;
+	pw_log_info("recording to %s", impl->filename);
+
+	pthread_mutex_lock(&impl->stats_lock);
+	memcpy(impl->stats_filename, impl->filename, sizeof(impl->stats_filename));
+	pthread_mutex_unlock(&impl->stats_lock);
+	return 0;
+}
+
+static void close_file(struct impl *impl)
+{
+	int res;
+
+	if (impl->file == NULL)
+		return;
+	if ((res = wav_file_close(impl->file)) < 0)
+		pw_log_warn("error closing %s: %s", impl->filename, spa_strerror(res));
+	impl->file = NULL;
+}
+
+/* called from the writer thread, write the ring to the files */
+static void write_data(struct impl *impl, bool flush)
+{
+	uint32_t index, avail, offs, n_frames;
+	int32_t filled;
+	ssize_t res;
+	const void *data[1];
+
+	while (!impl->failed) {
+		filled = spa_ringbuffer_get_read_index(&impl->ring, &index);
+		avail = SPA_MAX(filled, 0);
+		if (avail == 0 || (!flush && avail < impl->threshold))
+			break;
+
+		if (impl->file == NULL && (res = open_file(impl)) < 0) {
+			pw_log_error("can't open file for %s: %s", impl->path, spa_strerror(res));
+			impl->failed = true;
+			break;
+		}
+
+		offs = index % impl->buffer_size;
+		n_frames = SPA_MIN(avail, impl->buffer_size - offs) / impl->frame_size;
+		if (impl->rotate_frames > 0)
+			n_frames = SPA_MIN(n_frames, impl->rotate_frames - impl->file_frames);
+
+		data[0] = SPA_PTROFF(impl->buffer, offs, void);
+		if ((res = wav_file_write(impl->file, data, n_frames)) < 0) {
+			pw_log_error("error writing %s: %s", impl->filename, spa_strerror(res));
+			impl->failed = true;
+			break;
+		}
+		spa_ringbuffer_read_update(&impl->ring, index + n_frames * impl->frame_size);
+
+		impl->file_frames += n_frames;
+		if (impl->file_frames == impl->rotate_frames)
+			close_file(impl);
+	}
+}
+
+static void do_wakeup(void *data, uint64_t count)
+{
+	struct impl *impl = data;
+	write_data(impl, false);
+}
+
+static void stream_destroy(void *d)
+{
+	struct impl *impl = d;
+	spa_hook_remove(&impl->stream_listener);
+	impl->stream = NULL;
+}
+
+static void stream_state_changed(void *d, enum pw_stream_state old,
+		enum pw_stream_state state, const char *error)
+{
+	struct impl *impl = d;
+	switch (state) {
+	case PW_STREAM_STATE_ERROR:
+	case PW_STREAM_STATE_UNCONNECTED:
+		pw_impl_module_schedule_destroy(impl->module);
+		break;
+	case PW_STREAM_STATE_PAUSED:
+	case PW_STREAM_STATE_STREAMING:
+		break;
+	default:
+		break;
+	}
+}
+
+static void capture_stream_process(void *d)
+{
+	struct impl *impl = d;
+	struct pw_buffer *buf;
+	struct spa_data *bd;
+	uint32_t index, offs, size, avail;
+	int32_t filled;
+
+	if ((buf = pw_stream_dequeue_buffer(impl->stream)) == NULL) {
+		pw_log_debug("out of buffers: %m");
+		return;
+	}
+
+	bd = &buf->buffer->datas[0];
+
+	offs = SPA_MIN(bd->chunk->offset, bd->maxsize);
+	size = SPA_MIN(bd->chunk->size, bd->maxsize - offs);
+	size = SPA_ROUND_DOWN(size, impl->frame_size);
+
+	filled = spa_ringbuffer_get_write_index(&impl->ring, &index);
+	avail = impl->buffer_size - SPA_CLAMP(filled, 0, (int32_t)impl->buffer_size);
+
+	if (size > avail) {
+		/* the disk can't keep up, drop the complete buffer so
+		 * that the file only has holes at buffer boundaries */
+		SPA_ATOMIC_INC(impl->overruns);
+	} else if (size > 0) {
+		spa_ringbuffer_write_data(&impl->ring,
+				impl->buffer, impl->buffer_size,
+				index % impl->buffer_size,
+				SPA_PTROFF(bd->data, offs, void), size);
+		spa_ringbuffer_write_update(&impl->ring, index + size);
+		filled += size;
+
+		if ((uint32_t)filled > SPA_ATOMIC_LOAD(impl->queue_max))
+			SPA_ATOMIC_STORE(impl->queue_max, filled);
+		if ((uint32_t)filled >= impl->threshold &&
+		    (uint32_t)(filled - size) < impl->threshold)
+			pw_loop_signal_event(pw_thread_loop_get_loop(impl->writer),
+					impl->wakeup);
+	}
+	pw_stream_queue_buffer(impl->stream, buf);
+}
+
+static const struct pw_stream_events capture_stream_events = {
+	PW_VERSION_STREAM_EVENTS,
+	.destroy = stream_destroy,
+	.state_changed = stream_state_changed,
+	.process = capture_stream_process
+};
+
+static void update_stats(void *data, uint64_t expirations)
+{
+	struct impl *impl = data;
+	struct spa_dict_item items[3];
+	char depth[32], overruns[32], filename[PATH_MAX];
+	uint32_t n_overruns;
+	uint64_t max_ms;
+
+	if (impl->stream == NULL)
+		return;
+
+	max_ms = (uint64_t)SPA_ATOMIC_LOAD(impl->queue_max) / impl->frame_size *
+		1000 / impl->info.rate;
+	n_overruns = SPA_ATOMIC_LOAD(impl->overruns);
+
+	pthread_mutex_lock(&impl->stats_lock);
+	memcpy(filename, impl->stats_filename, sizeof(filename));
+	pthread_mutex_unlock(&impl->stats_lock);
+
+	/* every update is sent to all clients that watch the node, only
+	 * update when something changed */
+	if (n_overruns == impl->reported_overruns &&
+	    max_ms == impl->reported_depth &&
+	    spa_streq(filename, impl->reported_filename))
+		return;
+
+	if (n_overruns != impl->reported_overruns)
+		pw_log_warn("%u overruns, the disk can't keep up",
+				n_overruns - impl->reported_overruns);
+	impl->reported_overruns = n_overruns;
+	impl->reported_depth = max_ms;
+	memcpy(impl->reported_filename, filename, sizeof(filename));
+
+	snprintf(depth, sizeof(depth), "%"PRIu64, max_ms);
+	snprintf(overruns, sizeof(overruns), "%u", n_overruns);
+
+	items[0] = SPA_DICT_ITEM_INIT("record.file", filename);
+	items[1] = SPA_DICT_ITEM_INIT("record.queue.depth", depth);
+	items[2] = SPA_DICT_ITEM_INIT("record.overruns", overruns);
+	pw_stream_update_properties(impl->stream, &SPA_DICT_INIT_ARRAY(items));
+}
+
+static int create_stream(struct impl *impl)
+{
+	int res;
+	uint32_t n_params;
+	const struct spa_pod *params[1];
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+
+	impl->stream = pw_stream_new(impl->core, "recorder", impl->stream_props);
+	impl->stream_props = NULL;
+
+	if (impl->stream == NULL)
+		return -errno;
+
+	pw_stream_add_listener(impl->stream,
+			&impl->stream_listener,
+			&capture_stream_events, impl);
+
+	n_params = 0;
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	params[n_params++] = spa_format_audio_raw_build(&b,
+			SPA_PARAM_EnumFormat, &impl->info);
+
+	if ((res = pw_stream_connect(impl->stream,
+			PW_DIRECTION_INPUT,
+			PW_ID_ANY,
+			PW_STREAM_FLAG_AUTOCONNECT |
+			PW_STREAM_FLAG_MAP_BUFFERS |
+			PW_STREAM_FLAG_RT_PROCESS,
+			params, n_params)) < 0)
+		return res;
+
+	return 0;
+}
+
+static void core_error(void *data, uint32_t id, int seq, int res, const char *message)
+{
+	struct impl *impl = data;
+
+	pw_log_error("error id:%u seq:%d res:%d (%s): %s",
+			id, seq, res, spa_strerror(res), message);
+
+	if (id == PW_ID_CORE && res == -EPIPE)
+		pw_impl_module_schedule_destroy(impl->module);
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.error = core_error,
+};
+
+static void core_destroy(void *d)
+{
+	struct impl *impl = d;
+	spa_hook_remove(&impl->core_listener);
+	impl->core = NULL;
+	pw_impl_module_schedule_destroy(impl->module);
+}
+
+static const struct pw_proxy_events core_proxy_events = {
+	.destroy = core_destroy,
+};
+
+static void impl_destroy(struct impl *impl)
+{
+	if (impl->stats_timer)
+		pw_loop_destroy_source(impl->main_loop, impl->stats_timer);
+	if (impl->stream)
+		pw_stream_destroy(impl->stream);
+	if (impl->core && impl->do_disconnect)
+		pw_core_disconnect(impl->core);
+
+	if (impl->writer)
+		pw_thread_loop_stop(impl->writer);
+	write_data(impl, true);
+	close_file(impl);
+	if (impl->writer)
+		pw_thread_loop_destroy(impl->writer);
+	free(impl->buffer);
+
+	pw_properties_free(impl->stream_props);
+	pw_properties_free(impl->props);
+
+	pthread_mutex_destroy(&impl->stats_lock);
+	free(impl);
+}
+
+static void module_destroy(void *data)
+{
+	struct impl *impl = data;
+	spa_hook_remove(&impl->module_listener);
+	impl_destroy(impl);
+}
+
+static const struct pw_impl_module_events module_events = {
+	PW_VERSION_IMPL_MODULE_EVENTS,
+	.destroy = module_destroy,
+};
+
+static inline uint32_t format_from_name(const char *name)
+{
+	int i;
+	for (i = 0; spa_type_audio_format[i].name; i++) {
+		if (spa_streq(name, spa_debug_type_short_name(spa_type_audio_format[i].name)))
+			return spa_type_audio_format[i].type;
+	}
+	return SPA_AUDIO_FORMAT_UNKNOWN;
+}
+
+static uint32_t channel_from_name(const char *name)
+{
+	int i;
+	for (i = 0; spa_type_audio_channel[i].name; i++) {
+		if (spa_streq(name, spa_debug_type_short_name(spa_type_audio_channel[i].name)))
+			return spa_type_audio_channel[i].type;
+	}
+	return SPA_AUDIO_CHANNEL_UNKNOWN;
+}
+
+static void parse_position(struct spa_audio_info_raw *info, const char *val, size_t len)
+{
+	struct spa_json it[2];
+	char v[256];
+
+	spa_json_init(&it[0], val, len);
+        if (spa_json_enter_array(&it[0], &it[1]) <= 0)
+                spa_json_init(&it[1], val, len);
+
+	info->channels = 0;
+	while (spa_json_get_string(&it[1], v, sizeof(v)) > 0 &&
+	    info->channels < SPA_AUDIO_MAX_CHANNELS) {
+		info->position[info->channels++] = channel_from_name(v);
+	}
+}
+
+static void parse_audio_info(const struct pw_properties *props, struct spa_audio_info_raw *info)
+{
+	const char *str;
+	uint32_t i;
+
+	spa_zero(*info);
+	if ((str = pw_properties_get(props, PW_KEY_AUDIO_FORMAT)) == NULL)
+		str = DEFAULT_FORMAT;
+	info->format = format_from_name(str);
+
+	info->rate = pw_properties_get_uint32(props, PW_KEY_AUDIO_RATE, info->rate);
+	if (info->rate == 0)
+		info->rate = DEFAULT_RATE;
+
+	info->channels = pw_properties_get_uint32(props, PW_KEY_AUDIO_CHANNELS, info->channels);
+	info->channels = SPA_MIN(info->channels, SPA_AUDIO_MAX_CHANNELS);
+	if ((str = pw_properties_get(props, SPA_KEY_AUDIO_POSITION)) != NULL)
+		parse_position(info, str, strlen(str));
+	if (info->channels == 0)
+		parse_position(info, DEFAULT_POSITION, strlen(DEFAULT_POSITION));
+	else if (str == NULL) {
+		/* many channels without a map, record them as AUX channels */
+		if (info->channels == 2)
+			parse_position(info, DEFAULT_POSITION, strlen(DEFAULT_POSITION));
+		else
+			for (i = 0; i < info->channels; i++)
+				info->position[i] = SPA_AUDIO_CHANNEL_AUX0 + i;
+	}
+}
+
+static int calc_frame_size(const struct spa_audio_info_raw *info)
+{
+	int res = info->channels;
+	switch (info->format) {
+	case SPA_AUDIO_FORMAT_U8:
+		return res;
+	case SPA_AUDIO_FORMAT_S16:
+		return res * 2;
+	case SPA_AUDIO_FORMAT_S24:
+		return res * 3;
+	case SPA_AUDIO_FORMAT_S24_32:
+	case SPA_AUDIO_FORMAT_S32:
+	case SPA_AUDIO_FORMAT_F32:
+		return res * 4;
+	default:
+		return 0;
+	}
+}
+
+static void copy_props(struct impl *impl, struct pw_properties *props, const char *key)
+{
+	const char *str;
+	if ((str = pw_properties_get(props, key)) != NULL) {
+		if (pw_properties_get(impl->stream_props, key) == NULL)
+			pw_properties_set(impl->stream_props, key, str);
+	}
+}
+
+SPA_EXPORT
+int pipewire__module_init(struct pw_impl_module *module, const char *args)
+{
+	struct pw_context *context = pw_impl_module_get_context(module);
+	struct pw_properties *props = NULL;
+	uint32_t id = pw_global_get_id(pw_impl_module_get_global(module));
+	uint32_t pid = getpid();
+	struct impl *impl;
+	const char *str;
+	uint64_t max_frames;
+	uint32_t buffer_ms;
+	struct timespec value, interval;
+	int res;
+
+	PW_LOG_TOPIC_INIT(mod_topic);
+
+	impl = calloc(1, sizeof(struct impl));
+	if (impl == NULL)
+		return -errno;
+
+	pthread_mutex_init(&impl->stats_lock, NULL);
+
+	pw_log_debug("module %p: new %s", impl, args);
+
+	if (args == NULL)
+		args = "";
+
+	props = pw_properties_new_string(args);
+	if (props == NULL) {
+		res = -errno;
+		pw_log_error( "can't create properties: %m");
+		goto error;
+	}
+	impl->props = props;
+
+	impl->stream_props = pw_properties_new(NULL, NULL);
+	if (impl->stream_props == NULL) {
+		res = -errno;
+		pw_log_error( "can't create properties: %m");
+		goto error;
+	}
+
+	impl->module = module;
+	impl->context = context;
+	impl->main_loop = pw_context_get_main_loop(context);
+
+	if (pw_properties_get(props, PW_KEY_MEDIA_CLASS) == NULL)
+		pw_properties_set(props, PW_KEY_MEDIA_CLASS, "Stream/Input/Audio");
+
+	if (pw_properties_get(props, PW_KEY_NODE_NAME) == NULL)
+		pw_properties_setf(props, PW_KEY_NODE_NAME, "recorder-%u-%u", pid, id);
+	if (pw_properties_get(props, PW_KEY_NODE_DESCRIPTION) == NULL)
+		pw_properties_set(props, PW_KEY_NODE_DESCRIPTION,
+				pw_properties_get(props, PW_KEY_NODE_NAME));
+
+	if ((str = pw_properties_get(props, "stream.props")) != NULL)
+		pw_properties_update_string(impl->stream_props, str, strlen(str));
+
+	copy_props(impl, props, PW_KEY_AUDIO_FORMAT);
+	copy_props(impl, props, PW_KEY_AUDIO_RATE);
+	copy_props(impl, props, PW_KEY_AUDIO_CHANNELS);
+	copy_props(impl, props, SPA_KEY_AUDIO_POSITION);
+	copy_props(impl, props, PW_KEY_NODE_NAME);
+	copy_props(impl, props, PW_KEY_NODE_DESCRIPTION);
+	copy_props(impl, props, PW_KEY_NODE_GROUP);
+	copy_props(impl, props, PW_KEY_NODE_LATENCY);
+	copy_props(impl, props, PW_KEY_MEDIA_CLASS);
+	copy_props(impl, props, PW_KEY_TARGET_OBJECT);
+
+	parse_audio_info(impl->stream_props, &impl->info);
+
+	impl->frame_size = calc_frame_size(&impl->info);
+	if (impl->frame_size == 0) {
+		res = -EINVAL;
+		pw_log_error( "can't record audio format %s",
+				pw_properties_get(impl->stream_props, PW_KEY_AUDIO_FORMAT));
+		goto error;
+	}
+
+	if ((impl->path = pw_properties_get(props, "record.path")) == NULL)
+		impl->path = DEFAULT_PATH;
+	impl->direct = pw_properties_get_bool(props, "record.direct", true);
+	impl->block_size = pw_properties_get_uint32(props, "record.block-size", DEFAULT_BLOCK_SIZE);
+	impl->rotate_frames = (uint64_t)pw_properties_get_uint32(props, "record.rotate", 0) *
+		impl->info.rate;
+	impl->preallocate = impl->rotate_frames > 0 &&
+		pw_properties_get_bool(props, "record.preallocate", true);
+
+	max_frames = MAX_FILE_SIZE / impl->frame_size;
+	if (impl->rotate_frames == 0 || impl->rotate_frames > max_frames)
+		impl->rotate_frames = max_frames;
+
+	buffer_ms = pw_properties_get_uint32(props, "record.buffer", DEFAULT_BUFFER_MS);
+	impl->buffer_size = (uint64_t)impl->info.rate * buffer_ms / 1000 * impl->frame_size;
+	/* wake up the writer when there is a block to write, keep room
+	 * for at least 4 of them */
+	impl->threshold = SPA_MAX(impl->block_size, impl->frame_size);
+	impl->buffer_size = SPA_MAX(impl->buffer_size, impl->threshold * 4);
+	impl->buffer_size = SPA_ROUND_UP(impl->buffer_size, impl->frame_size);
+	if (impl->buffer_size > INT32_MAX / 2) {
+		res = -EINVAL;
+		pw_log_error("record.buffer %u is too large", buffer_ms);
+		goto error;
+	}
+	impl->buffer = calloc(1, impl->buffer_size);
+	if (impl->buffer == NULL) {
+		res = -errno;
+		goto error;
+	}
+	spa_ringbuffer_init(&impl->ring);
+
+	/* check that we can make the file before we start */
+	if ((res = open_file(impl)) < 0) {
+		pw_log_error("can't open %s: %s", impl->filename, spa_strerror(res));
+		goto error;
+	}
+
+	impl->writer = pw_thread_loop_new("pw-recorder", NULL);
+	if (impl->writer == NULL) {
+		res = -errno;
+		goto error;
+	}
+	impl->wakeup = pw_loop_add_event(pw_thread_loop_get_loop(impl->writer),
+			do_wakeup, impl);
+	if (impl->wakeup == NULL ||
+	    (res = pw_thread_loop_start(impl->writer)) < 0) {
+		res = impl->wakeup == NULL ? -errno : res;
+		pw_log_error("can't start writer thread: %s", spa_strerror(res));
+		goto error;
+	}
+
+	impl->core = pw_context_get_object(impl->context, PW_TYPE_INTERFACE_Core);
+	if (impl->core == NULL) {
+		str = pw_properties_get(props, PW_KEY_REMOTE_NAME);
+		impl->core = pw_context_connect(impl->context,
+				pw_properties_new(
+					PW_KEY_REMOTE_NAME, str,
+					NULL),
+				0);
+		impl->do_disconnect = true;
+	}
+	if (impl->core == NULL) {
+		res = -errno;
+		pw_log_error("can't connect: %m");
+		goto error;
+	}
+
+	pw_proxy_add_listener((struct pw_proxy*)impl->core,
+			&impl->core_proxy_listener,
+			&core_proxy_events, impl);
+	pw_core_add_listener(impl->core,
+			&impl->core_listener,
+			&core_events, impl);
+
+	if ((res = create_stream(impl)) < 0)
+		goto error;
+
+	impl->stats_timer = pw_loop_add_timer(impl->main_loop, update_stats, impl);
+	if (impl->stats_timer != NULL) {
+		value.tv_sec = interval.tv_sec = 1;
+		value.tv_nsec = interval.tv_nsec = 0;
+		pw_loop_update_timer(impl->main_loop, impl->stats_timer, &value, &interval, false);
+	}
+
+	pw_impl_module_add_listener(module, &impl->module_listener, &module_events, impl);
+
+	pw_impl_module_update_properties(module, &SPA_DICT_INIT_ARRAY(module_props));
+
+	return 0;
+
+error:
+	if (impl->file != NULL) {
+		close_file(impl);
+		unlink(impl->filename);
+	}
+	impl_destroy(impl);
+	return res;
+}
@@ -383,14 +383,347 @@ int pw_conf_save_state(const char *prefix, const char *name, const struct pw_pro
 	return 0;
 }
 
-static int conf_load(const char *path, struct pw_properties *conf)
+#define CONF_CACHE_MAGIC	0x43435750	/* "PWCC" */
+#define CONF_CACHE_VERSION	1
+
+/* Cache of parsed config files, one per config prefix and name. It holds a
+ * record for each loaded file with its parsed items, so that unchanged files
+ * don't need to be parsed again. It is only used when PIPEWIRE_CONFIG_CACHE_DIR
+ * is set. */
+struct conf_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_files;
+	uint32_t padding;
+	uint64_t size;			/* size of the records after the header */
+};
+
+struct conf_cache_file {
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	int64_t mtime;
+	uint32_t path_len;		/* including the trailing 0 */
+	uint32_t n_items;
+	uint64_t items_len;		/* key\0 followed by =value\0 or ! for null */
+	/* followed by path and items, padded to 8 bytes */
+};
+
+struct conf_cache {
+	char path[PATH_MAX];
+	void *data;			/* mmapped old cache or MAP_FAILED */
+	size_t size;
+	uint32_t n_files;
+
+	FILE *out;			/* new cache records */
+	char *out_data;
+	size_t out_size;
+	uint32_t n_out;
+	bool dirty;
+};
+
+static inline size_t conf_cache_file_size(const struct conf_cache_file *f)
+{
+	return SPA_ROUND_UP_N(sizeof(*f) + f->path_len + f->items_len, 8);
+}
+
+static bool conf_cache_items_valid(const char *p, size_t size, uint32_t n_items)
+{
+	const char *end = p + size, *e;
+
+	while (n_items-- > 0) {
+		if ((e = memchr(p, '\0', end - p)) == NULL || e + 1 >= end)
+			return false;
+		p = e + 1;
+		if (*p == '!') {
+			p++;
+		} else if (*p++ == '=') {
+			if ((e = memchr(p, '\0', end - p)) == NULL)
+				return false;
+			p = e + 1;
+		} else {
+			return false;
+		}
+	}
+	return p == end;
+}
+
+static bool conf_cache_valid(const void *data, size_t size, uint32_t *n_files)
+{
+	const struct conf_cache_header *h = data;
+	const struct conf_cache_file *f;
+	size_t offs = sizeof(*h);
+	uint32_t i;
+
+	if (size < sizeof(*h) || h->magic != CONF_CACHE_MAGIC ||
+	    h->version != CONF_CACHE_VERSION || h->size != size - sizeof(*h))
+		return false;
+
+	for (i = 0; i < h->n_files; i++) {
+		if (size - offs < sizeof(*f))
+			return false;
+		f = SPA_PTROFF(data, offs, const struct conf_cache_file);
+		if (f->path_len == 0 || f->path_len > size - offs - sizeof(*f) ||
+		    f->items_len > size - offs - sizeof(*f) - f->path_len ||
+		    conf_cache_file_size(f) > size - offs)
+			return false;
+		if (SPA_PTROFF(f, sizeof(*f) + f->path_len - 1, const char)[0] != '\0')
+			return false;
+		if (!conf_cache_items_valid(SPA_PTROFF(f, sizeof(*f) + f->path_len, const char),
+					f->items_len, f->n_items))
+			return false;
+		offs += conf_cache_file_size(f);
+	}
+	*n_files = h->n_files;
+	return offs == size;
+}
+
+static void conf_cache_open(struct conf_cache *cache, const char *prefix, const char *name)
+{
+	const char *dir;
+	struct stat sbuf;
+	char *p;
+	int len;
+
+	spa_zero(*cache);
+	cache->data = MAP_FAILED;
+
+	if ((dir = getenv("PIPEWIRE_CONFIG_CACHE_DIR")) == NULL || dir[0] == '\0')
+		return;
+
+	len = snprintf(cache->path, sizeof(cache->path), "%s/", dir);
+	if (len < 0 || (size_t)len >= sizeof(cache->path))
+		return;
+	p = cache->path + len;
+	len = snprintf(p, sizeof(cache->path) - len, "%s%s%s.cache",
+			prefix ? prefix : "", prefix ? "-" : "", name);
+	if (len < 0 || (size_t)len >= sizeof(cache->path) - (p - cache->path))
+		return;
+	for (; *p; p++)
+		if (*p == '/')
+			*p = '_';
+
+	if ((cache->out = open_memstream(&cache->out_data, &cache->out_size)) == NULL)
+		return;
+
+	spa_autoclose int fd = open(cache->path, O_CLOEXEC | O_RDONLY);
+	if (fd < 0 || fstat(fd, &sbuf) < 0 || sbuf.st_size == 0)
+		goto no_cache;
+
+	cache->size = sbuf.st_size;
+	cache->data = mmap(NULL, cache->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (cache->data == MAP_FAILED)
+		goto no_cache;
+
+	if (!conf_cache_valid(cache->data, cache->size, &cache->n_files)) {
+		pw_log_info("ignoring invalid config cache '%s'", cache->path);
+		munmap(cache->data, cache->size);
+		cache->data = MAP_FAILED;
+		goto no_cache;
+	}
+	pw_log_debug("opened config cache '%s' with %u files", cache->path, cache->n_files);
+	return;
+
+no_cache:
+	cache->dirty = true;
+}
+
+static const struct conf_cache_file *conf_cache_find(struct conf_cache *cache,
+		const char *path, const struct stat *sbuf)
+{
+	const struct conf_cache_file *f;
+	size_t offs = sizeof(struct conf_cache_header);
+	uint32_t i;
+
+	if (cache->data == MAP_FAILED)
+		return NULL;
+
+	for (i = 0; i < cache->n_files; i++) {
+		f = SPA_PTROFF(cache->data, offs, const struct conf_cache_file);
+		offs += conf_cache_file_size(f);
+
+		if (!spa_streq(SPA_PTROFF(f, sizeof(*f), const char), path))
+			continue;
+		if (f->dev != (uint64_t)sbuf->st_dev || f->ino != (uint64_t)sbuf->st_ino ||
+		    f->size != (uint64_t)sbuf->st_size ||
+		    f->mtime != (int64_t)SPA_TIMESPEC_TO_NSEC(&sbuf->st_mtim))
+			return NULL;
+		return f;
+	}
+	return NULL;
+}
+
+static void conf_cache_add(struct conf_cache *cache, const char *path, const struct stat *sbuf,
+		const char *items, size_t items_len, uint32_t n_items)
+{
+	struct conf_cache_file f;
+	size_t pad;
+
+	f = (struct conf_cache_file) {
+		.dev = sbuf->st_dev,
+		.ino = sbuf->st_ino,
+		.size = sbuf->st_size,
+		.mtime = SPA_TIMESPEC_TO_NSEC(&sbuf->st_mtim),
+		.path_len = strlen(path) + 1,
+		.n_items = n_items,
+		.items_len = items_len,
+	};
+	fwrite(&f, sizeof(f), 1, cache->out);
+	fwrite(path, f.path_len, 1, cache->out);
+	fwrite(items, items_len, 1, cache->out);
+	pad = conf_cache_file_size(&f) - sizeof(f) - f.path_len - items_len;
+	fwrite("\0\0\0\0\0\0\0", pad, 1, cache->out);
+	cache->n_out++;
+}
+
+static int conf_cache_apply(struct pw_properties *conf, const char *p, uint32_t n_items)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_items; i++) {
+		const char *key = p, *val = NULL;
+
+		p += strlen(p) + 1;
+		if (*p++ == '=') {
+			val = p;
+			p += strlen(p) + 1;
+		}
+		pw_properties_set(conf, key, val);
+	}
+	return n_items;
+}
+
+/* Same as pw_properties_update_string_checked() but writes the items to f */
+static int conf_cache_parse(FILE *f, const char *str, size_t size,
+		struct spa_error_location *loc)
+{
+	struct spa_json it[2];
+	char key[1024];
+	int count = 0;
+
+	spa_json_init(&it[0], str, size);
+	if (spa_json_enter_object(&it[0], &it[1]) <= 0)
+		spa_json_init(&it[1], str, size);
+
+	while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
+		const char *value;
+		char *val;
+		int len;
+
+		if ((len = spa_json_next(&it[1], &value)) <= 0)
+			break;
+
+		if (spa_json_is_null(value, len)) {
+			fwrite(key, strlen(key) + 1, 1, f);
+			fputc('!', f);
+		} else {
+			if (spa_json_is_container(value, len))
+				len = spa_json_container_len(&it[1], value, len);
+			if (len <= 0)
+				break;
+			if ((val = malloc(len+1)) == NULL)
+				return -errno;
+			spa_json_parse_stringn(value, len, val, len+1);
+			fwrite(key, strlen(key) + 1, 1, f);
+			fputc('=', f);
+			fwrite(val, strlen(val) + 1, 1, f);
+			free(val);
+		}
+		count++;
+	}
+	if (spa_json_get_error(&it[1], str, loc))
+		return -EINVAL;
+	return count;
+}
+
+static int conf_cache_reuse(struct conf_cache *cache, const struct conf_cache_file *f,
+		const struct stat *sbuf, struct pw_properties *conf)
+{
+	const char *path = SPA_PTROFF(f, sizeof(*f), const char);
+	const char *items = SPA_PTROFF(f, sizeof(*f) + f->path_len, const char);
+
+	conf_cache_add(cache, path, sbuf, items, f->items_len, f->n_items);
+	return conf_cache_apply(conf, items, f->n_items);
+}
+
+static int conf_cache_update(struct conf_cache *cache, const char *path,
+		const struct stat *sbuf, const char *data, struct pw_properties *conf,
+		struct spa_error_location *loc)
+{
+	spa_autofree char *buf = NULL;
+	size_t size = 0;
+	FILE *out;
+	int count;
+
+	if ((out = open_memstream(&buf, &size)) == NULL)
+		return -errno;
+	count = conf_cache_parse(out, data, sbuf->st_size, loc);
+	fclose(out);
+	if (count < 0)
+		return count;
+
+	conf_cache_add(cache, path, sbuf, buf, size, count);
+	cache->dirty = true;
+
+	return conf_cache_apply(conf, buf, count);
+}
+
+static void conf_cache_close(struct conf_cache *cache)
+{
+	struct conf_cache_header h;
+	char tmp_name[PATH_MAX + 32];
+	FILE *f;
+
+	if (cache->data != MAP_FAILED)
+		munmap(cache->data, cache->size);
+	if (cache->out == NULL)
+		return;
+
+	fclose(cache->out);
+
+	if (!cache->dirty && cache->n_out == cache->n_files)
+		goto done;
+
+	snprintf(tmp_name, sizeof(tmp_name), "%s.tmp.%d", cache->path, (int)getpid());
+	if ((f = fopen(tmp_name, "we")) == NULL) {
+		pw_log_debug("can't open config cache '%s': %m", tmp_name);
+		goto done;
+	}
+	h = (struct conf_cache_header) {
+		.magic = CONF_CACHE_MAGIC,
+		.version = CONF_CACHE_VERSION,
+		.n_files = cache->n_out,
+		.size = cache->out_size,
+	};
+	if (fwrite(&h, sizeof(h), 1, f) != 1 ||
+	    (cache->out_size > 0 && fwrite(cache->out_data, cache->out_size, 1, f) != 1)) {
+		pw_log_warn("can't write config cache '%s': %m", tmp_name);
+		fclose(f);
+		unlink(tmp_name);
+		goto done;
+	}
+	if (fclose(f) != 0 || rename(tmp_name, cache->path) < 0) {
+		pw_log_warn("can't save config cache '%s': %m", cache->path);
+		unlink(tmp_name);
+		goto done;
+	}
+	pw_log_info("saved config cache '%s' with %u files", cache->path, cache->n_out);
+done:
+	free(cache->out_data);
+}
+
+static int conf_load(const char *path, struct pw_properties *conf, struct conf_cache *cache)
 {
 	char *data = MAP_FAILED;
 	struct stat sbuf;
 	int count;
 	struct spa_error_location loc = { 0 };
+	const struct conf_cache_file *f;
 	int res;
 
+	if (cache != NULL && cache->out == NULL)
+		cache = NULL;
+
 	spa_autoclose int fd = open(path,  O_CLOEXEC | O_RDONLY);
 	if (fd < 0)
 		goto error;
@@ -398,11 +731,16 @@ static int conf_load(const char *path, struct pw_properties *conf)
 	if (fstat(fd, &sbuf) < 0)
 		goto error;
 
-	if (sbuf.st_size > 0) {
+	if (cache != NULL && (f = conf_cache_find(cache, path, &sbuf)) != NULL) {
+		count = conf_cache_reuse(cache, f, &sbuf, conf);
+	} else if (sbuf.st_size > 0) {
 		if ((data = mmap(NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
 			goto error;
 
-		count = pw_properties_update_string_checked(conf, data, sbuf.st_size, &loc);
+		if (cache != NULL)
+			count = conf_cache_update(cache, path, &sbuf, data, conf, &loc);
+		else
+			count = pw_properties_update_string_checked(conf, data, sbuf.st_size, &loc);
 		if (count < 0) {
 			errno = EINVAL;
 			goto error;
@@ -475,6 +813,7 @@ int pw_conf_load_conf(const char *prefix, const char *name, struct pw_properties
 	char fname[PATH_MAX + 256];
 	int i, res, level = 0;
 	spa_autoptr(pw_properties) override = NULL;
+	struct conf_cache cache;
 	const char *dname;
 
 	if (name == NULL) {
@@ -490,8 +829,10 @@ int pw_conf_load_conf(const char *prefix, const char *name, struct pw_properties
 	pw_properties_set(conf, "config.name", name);
 	pw_properties_set(conf, "config.path", path);
 
-	if ((res = conf_load(path, conf)) < 0)
-		return res;
+	conf_cache_open(&cache, prefix, name);
+
+	if ((res = conf_load(path, conf, &cache)) < 0)
+		goto done;
 
 	pw_properties_setf(conf, "config.name.d", "%s.d", name);
 	dname = pw_properties_get(conf, "config.name.d");
@@ -511,15 +852,17 @@ int pw_conf_load_conf(const char *prefix, const char *name, struct pw_properties
 			continue;
 		}
 		if (override == NULL &&
-		    (override = pw_properties_new(NULL, NULL)) == NULL)
-			return -errno;
+		    (override = pw_properties_new(NULL, NULL)) == NULL) {
+			res = -errno;
+			goto done;
+		}
 
 		for (i = 0; i < n; i++) {
 			const char *name = entries[i]->d_name;
 
 			snprintf(fname, sizeof(fname), "%s/%s", path, name);
 			if (check_override(conf, name, level)) {
-				if (conf_load(fname, override) >= 0)
+				if (conf_load(fname, override, &cache) >= 0)
 					add_override(conf, override, fname, name, level, i);
 				pw_properties_clear(override);
 			} else {
@@ -529,8 +872,10 @@ int pw_conf_load_conf(const char *prefix, const char *name, struct pw_properties
 		}
 		free(entries);
 	}
-
-	return 0;
+	res = 0;
+done:
+	conf_cache_close(&cache);
+	return res;
 }
 
 SPA_EXPORT
@@ -547,7 +892,7 @@ int pw_conf_load_state(const char *prefix, const char *name, struct pw_propertie
 		pw_log_debug("%p: can't load config '%s': %m", conf, path);
 		return -ENOENT;
 	}
-	return conf_load(path, conf);
+	return conf_load(path, conf, NULL);
 }
 
 struct data {
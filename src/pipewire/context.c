@@ -692,7 +692,7 @@ static struct pw_data_loop *acquire_data_loop(struct impl *impl, const char *nam
 	if (best_loop == NULL)
 		return NULL;
 
-	best_loop->ref++;
+	SPA_ATOMIC_INC(best_loop->ref);
 	if ((res = data_loop_start(impl, best_loop)) < 0) {
 		errno = -res;
 		return NULL;
@@ -744,7 +744,7 @@ void pw_context_release_loop(struct pw_context *context, struct pw_loop *loop)
 	for (i = 0; i < impl->n_data_loops; i++) {
 		struct data_loop *l = &impl->data_loops[i];
 		if (l->impl->loop == loop) {
-			l->ref--;
+			SPA_ATOMIC_DEC(l->ref);
 			pw_log_info("release name:'%s' class:'%s' ref:%d", l->impl->loop->name,
 					l->impl->class, l->ref);
 			return;
@@ -752,6 +752,21 @@ void pw_context_release_loop(struct pw_context *context, struct pw_loop *loop)
 	}
 }
 
+/* Get the number of users of a data loop, 0 when the loop is not a data loop.
+ * Can be called from any thread. */
+int pw_context_get_loop_users(struct pw_context *context, struct pw_loop *loop)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	uint32_t i;
+
+	for (i = 0; i < impl->n_data_loops; i++) {
+		struct data_loop *l = &impl->data_loops[i];
+		if (l->impl->loop == loop)
+			return SPA_ATOMIC_LOAD(l->ref);
+	}
+	return 0;
+}
+
 SPA_EXPORT
 struct pw_work_queue *pw_context_get_work_queue(struct pw_context *context)
 {
@@ -1512,7 +1527,7 @@ int pw_context_recalc_graph(struct pw_context *context, const char *reason)
 	const uint32_t *rates;
 	uint32_t max_quantum, min_quantum, def_quantum, rate_quantum, floor_quantum, ceil_quantum;
 	uint32_t n_rates, def_rate;
-	bool freewheel, global_force_rate, global_force_quantum, transport_start;
+	bool freewheel, global_force_rate, global_force_quantum, transport_start, wakeup_peers;
 	struct spa_list collect;
 
 	pw_log_info("%p: busy:%d reason:%s", context, impl->recalc, reason);
@@ -1873,6 +1888,16 @@ again:
 				n->rt.position->clock.target_duration,
 				n->rt.position->clock.target_rate.denom, n->name);
 
+		/* nodes can only wait on the wakeup word when all the nodes that can
+		 * trigger them also signal the wakeup word */
+		wakeup_peers = true;
+		spa_list_for_each(s, &n->follower_list, follower_link) {
+			if (s->remote && s->rt.target.activation->client_version < 2)
+				wakeup_peers = false;
+		}
+		spa_list_for_each(s, &n->follower_list, follower_link)
+			SPA_ATOMIC_STORE(s->rt.target.activation->wakeup_peers, wakeup_peers);
+
 		/* first change the node states of the followers to the new target */
 		spa_list_for_each(s, &n->follower_list, follower_link) {
 			if (s->transport)
@@ -1147,6 +1147,8 @@ static void check_properties(struct pw_impl_node *node)
 	node->pause_on_idle = pw_properties_get_bool(node->properties, PW_KEY_NODE_PAUSE_ON_IDLE, true);
 	node->suspend_on_idle = pw_properties_get_bool(node->properties, PW_KEY_NODE_SUSPEND_ON_IDLE, false);
 	node->transport_sync = pw_properties_get_bool(node->properties, PW_KEY_NODE_TRANSPORT_SYNC, false);
+	node->rt.wakeup_timeout = pw_properties_get_uint64(node->properties,
+			PW_KEY_NODE_WAKEUP_TIMEOUT, 0) * SPA_NSEC_PER_USEC;
 	impl->cache_params =  pw_properties_get_bool(node->properties, PW_KEY_NODE_CACHE_PARAMS, true);
 	driver = pw_properties_get_bool(node->properties, PW_KEY_NODE_DRIVER, false);
 
@@ -1541,6 +1543,65 @@ int pw_impl_node_trigger(struct pw_impl_node *node)
 	return 0;
 }
 
+#ifdef __linux__
+/* spin this long on the wakeup word before doing a futex wait */
+#define WAKEUP_SPIN_NSEC	(20 * SPA_NSEC_PER_USEC)
+/* max number of cycles to run from the wakeup word before we go back to the
+ * loop so that other sources and invoke items are handled */
+#define WAKEUP_MAX_CYCLES	16
+
+/* We can only wait on the wakeup word when all peers signal it and when we don't
+ * block other nodes or sources on our data loop. */
+static inline bool can_wait_wakeup(struct pw_impl_node *this)
+{
+	return this->rt.prepared &&
+		SPA_ATOMIC_LOAD(this->rt.target.activation->wakeup_peers) &&
+		pw_context_get_loop_users(this->context, this->data_loop) == 1;
+}
+
+/* Called from the data loop after the node finished. Wait in user space for the
+ * next trigger on the wakeup word. Returns true when we were signaled, false
+ * when we timed out and the eventfd will be used for the next cycle. */
+static inline bool wait_wakeup(struct pw_impl_node *this, uint64_t *nsec)
+{
+	struct pw_node_activation *a = this->rt.target.activation;
+	struct spa_system *data_system = this->rt.target.system;
+	uint64_t start = *nsec, now = start, spin_end, end;
+	struct timespec ts;
+
+	spin_end = start + SPA_MIN(this->rt.wakeup_timeout, WAKEUP_SPIN_NSEC);
+	end = start + this->rt.wakeup_timeout;
+
+	SPA_ATOMIC_STORE(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN);
+	while (now < spin_end) {
+		if (SPA_ATOMIC_LOAD(a->wakeup) == PW_NODE_ACTIVATION_WAKEUP_SIGNALED)
+			goto signaled;
+		now = get_time_ns(data_system);
+	}
+	if (now < end &&
+	    SPA_ATOMIC_CAS(a->wakeup,
+			PW_NODE_ACTIVATION_WAKEUP_SPIN,
+			PW_NODE_ACTIVATION_WAKEUP_WAIT)) {
+		ts.tv_sec = (end - now) / SPA_NSEC_PER_SEC;
+		ts.tv_nsec = (end - now) % SPA_NSEC_PER_SEC;
+		pw_node_activation_futex(&a->wakeup, FUTEX_WAIT,
+				PW_NODE_ACTIVATION_WAKEUP_WAIT, &ts);
+	}
+	/* go back to the eventfd, if this fails, we were signaled */
+	if (SPA_ATOMIC_CAS(a->wakeup,
+			PW_NODE_ACTIVATION_WAKEUP_SPIN,
+			PW_NODE_ACTIVATION_WAKEUP_EVENTFD) ||
+	    SPA_ATOMIC_CAS(a->wakeup,
+			PW_NODE_ACTIVATION_WAKEUP_WAIT,
+			PW_NODE_ACTIVATION_WAKEUP_EVENTFD))
+		return false;
+signaled:
+	SPA_ATOMIC_STORE(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_EVENTFD);
+	*nsec = get_time_ns(data_system);
+	return true;
+}
+#endif
+
 static void node_on_fd_events(struct spa_source *source)
 {
 	struct pw_impl_node *this = source->data;
@@ -1569,6 +1630,18 @@ static void node_on_fd_events(struct spa_source *source)
 				nsec);
 
 		process_node(this, nsec);
+
+#ifdef __linux__
+		if (this->rt.wakeup_timeout > 0) {
+			uint32_t cycles = 0;
+			nsec = get_time_ns(data_system);
+			while (can_wait_wakeup(this) && cycles++ < WAKEUP_MAX_CYCLES &&
+			    wait_wakeup(this, &nsec)) {
+				process_node(this, nsec);
+				nsec = get_time_ns(data_system);
+			}
+		}
+#endif
 	}
 }
 
@@ -187,6 +187,10 @@ extern "C" {
 #define PW_KEY_NODE_SUSPEND_ON_IDLE	"node.suspend-on-idle"	/**< suspend the node when idle */
 #define PW_KEY_NODE_CACHE_PARAMS	"node.cache-params"	/**< cache the node params */
 #define PW_KEY_NODE_TRANSPORT_SYNC	"node.transport.sync"	/**< the node handles transport sync */
+#define PW_KEY_NODE_WAKEUP_TIMEOUT	"node.wakeup-timeout"	/**< after processing, spin and then futex-wait
+								  *  up to this many microseconds for the next
+								  *  cycle instead of going back to the loop.
+								  *  0 (the default) disables. */
 #define PW_KEY_NODE_DRIVER		"node.driver"		/**< node can drive the graph. When the node is
 								  *  selected as the driver, it needs to start
 								  *  the graph periodically. */
@@ -74,6 +74,7 @@ struct support {
 	unsigned int in_valgrind:1;
 	unsigned int no_color:1;
 	unsigned int no_config:1;
+	unsigned int intern_properties:1;
 	unsigned int do_dlclose:1;
 };
 
@@ -513,6 +514,10 @@ void pw_init(int *argc, char **argv[])
 	if ((str = getenv("PIPEWIRE_NO_CONFIG")) != NULL)
 		support->no_config = pw_properties_parse_bool(str);
 
+	if ((str = getenv("PIPEWIRE_INTERN_PROPERTIES")) != NULL)
+		support->intern_properties = pw_properties_parse_bool(str);
+	pw_properties_intern_enable(support->intern_properties);
+
 	init_i18n(support);
 
 	if ((str = getenv("SPA_PLUGIN_DIR")) == NULL)
@@ -609,6 +614,8 @@ void pw_deinit(void)
 		goto done;
 
 	pthread_mutex_lock(&support_lock);
+	if (support->intern_properties)
+		pw_properties_intern_report();
 	pw_log_deinit();
 
 	spa_list_consume(h, &registry->handles, link)
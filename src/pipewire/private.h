@@ -13,6 +13,10 @@ extern "C" {
 
 #include <sys/socket.h>
 #include <sys/types.h> /* for pthread_t */
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #include "pipewire/impl.h"
 
@@ -259,6 +263,7 @@ struct pw_impl_client {
 	int send_seq;			/**< last sender sequence number */
 	uint64_t recv_generation;	/**< last received registry generation */
 	uint64_t sent_generation;	/**< last sent registry generation */
+	uint32_t protocol_features;	/**< protocol features announced in hello */
 
 	void *user_data;		/**< extra user data */
 
@@ -560,8 +565,10 @@ static inline void copy_target(struct pw_node_target *dst, const struct pw_node_
  * 1 the activation status needs to be CAS
  *   async nodes, driver resumes async nodes
  *   transport with sync.group properties instead of client command
+ * 2 the wakeup futex word is used to signal nodes that wait for their
+ *   next cycle in user space
  */
-#define PW_VERSION_NODE_ACTIVATION	1
+#define PW_VERSION_NODE_ACTIVATION	2
 
 #define PW_NODE_ACTIVATION_PENDING_TRIGGER(status) ((status) <= PW_NODE_ACTIVATION_AWAKE)
 
@@ -578,6 +585,19 @@ static inline void copy_target(struct pw_node_target *dst, const struct pw_node_
  *   NOT_TRIGGERED -> TRIGGERED (eventfd is written)
  *   TRIGGERED -> AWAKE (eventfd is read, node starts processing)
  *   AWAKE -> FINISHED (node completed processing and triggered the peers)
+ *
+ * The wakeup word selects how a TRIGGERED node is woken up. It is 0 (EVENTFD)
+ * by default and the eventfd of the node is written. A node that expects to be
+ * triggered again soon can, after finishing, set the word to SPIN and poll it,
+ * or to WAIT and futex-wait on it. The trigger then swaps SPIN/WAIT to SIGNALED
+ * (and does a futex wake for WAIT) instead of writing the eventfd. When the
+ * waiting node gives up, it swaps the word back to EVENTFD; if that fails, it
+ * was signaled and processes the cycle directly.
+ *
+ * Peers that don't know about the wakeup word only write the eventfd, which is
+ * not seen while waiting on the word. The server sets wakeup_peers when all the
+ * nodes in the graph of the node use version 2 or newer and nodes only wait on
+ * the word when it is set.
  */
 struct pw_node_activation {
 #define PW_NODE_ACTIVATION_NOT_TRIGGERED	0
@@ -610,7 +630,16 @@ struct pw_node_activation {
 							 * CAS their node id in this array. */
 	uint64_t prev_awake_time;
 	uint64_t prev_finish_time;
-	uint32_t padding[7];				/* must be 0 */
+#define PW_NODE_ACTIVATION_WAKEUP_EVENTFD	0
+#define PW_NODE_ACTIVATION_WAKEUP_SPIN		1
+#define PW_NODE_ACTIVATION_WAKEUP_WAIT		2
+#define PW_NODE_ACTIVATION_WAKEUP_SIGNALED	3
+	uint32_t wakeup;				/* futex word, how to wake up the node,
+							 * since version 2 */
+	uint32_t wakeup_peers;				/* set by the server when all peers of the
+							 * node trigger it through the wakeup word,
+							 * since version 2 */
+	uint32_t padding[5];				/* must be 0 */
 
 	uint32_t client_version;			/* verions of client, see above */
 	uint32_t server_version;			/* verions of server, see above */
@@ -651,6 +680,40 @@ static inline uint64_t get_time_ns(struct spa_system *system)
 	return SPA_TIMESPEC_TO_NSEC(&ts);
 }
 
+#ifdef __linux__
+static inline int pw_node_activation_futex(uint32_t *word, int op, uint32_t val,
+		const struct timespec *timeout)
+{
+	/* the activation is shared between processes, don't use the
+	 * private futex ops */
+	return syscall(SYS_futex, word, op, val, timeout, NULL, 0);
+}
+#endif
+
+/* Wake up a TRIGGERED node that is waiting for its next cycle in user space.
+ * Returns false when the node is not waiting on the wakeup word and the eventfd
+ * needs to be written instead. */
+static inline bool pw_node_activation_wakeup(struct pw_node_activation *a)
+{
+#ifdef __linux__
+	uint32_t wakeup = SPA_ATOMIC_LOAD(a->wakeup);
+
+	if (SPA_LIKELY(wakeup == PW_NODE_ACTIVATION_WAKEUP_EVENTFD))
+		return false;
+	if (SPA_ATOMIC_CAS(a->wakeup,
+				PW_NODE_ACTIVATION_WAKEUP_SPIN,
+				PW_NODE_ACTIVATION_WAKEUP_SIGNALED))
+		return true;
+	if (SPA_ATOMIC_CAS(a->wakeup,
+				PW_NODE_ACTIVATION_WAKEUP_WAIT,
+				PW_NODE_ACTIVATION_WAKEUP_SIGNALED)) {
+		pw_node_activation_futex(&a->wakeup, FUTEX_WAKE, 1, NULL);
+		return true;
+	}
+#endif
+	return false;
+}
+
 /* called from data-loop decrement the dependency counter of the target and when
  * there are no more dependencies, trigger the node. */
 static inline void trigger_target_v1(struct pw_node_target *t, uint64_t nsec)
@@ -667,6 +730,8 @@ static inline void trigger_target_v1(struct pw_node_target *t, uint64_t nsec)
 					PW_NODE_ACTIVATION_NOT_TRIGGERED,
 					PW_NODE_ACTIVATION_TRIGGERED)) {
 			a->signal_time = nsec;
+			if (pw_node_activation_wakeup(a))
+				return;
 			if (SPA_UNLIKELY(spa_system_eventfd_write(t->system, t->fd, 1) < 0))
 				pw_log_warn("%p: write failed %m", t->node);
 		} else {
@@ -688,6 +753,8 @@ static inline void trigger_target_v0(struct pw_node_target *t, uint64_t nsec)
 	if (pending == 0) {
 		SPA_ATOMIC_STORE(a->status, PW_NODE_ACTIVATION_TRIGGERED);
 		a->signal_time = nsec;
+		if (pw_node_activation_wakeup(a))
+			return;
 		if (SPA_UNLIKELY(spa_system_eventfd_write(t->system, t->fd, 1) < 0))
 			pw_log_warn("%p: write failed %m", t->node);
 	}
@@ -834,6 +901,9 @@ struct pw_impl_node {
 
 		struct spa_ratelimit rate_limit;
 
+		uint64_t wakeup_timeout;		/**< max nsec to wait for the next cycle
+							 *  on the wakeup futex, 0 to disable */
+
 		bool prepared;				/**< the node was added to loop */
 	} rt;
 	struct pw_node_peer *to_driver_peer;		/* node -> driver */
@@ -1277,6 +1347,11 @@ void pw_proxy_remove(struct pw_proxy *proxy);
 
 int pw_context_recalc_graph(struct pw_context *context, const char *reason);
 
+int pw_context_get_loop_users(struct pw_context *context, struct pw_loop *loop);
+
+void pw_properties_intern_enable(bool enable);
+void pw_properties_intern_report(void);
+
 void pw_impl_port_update_info(struct pw_impl_port *port, const struct spa_port_info *info);
 
 int pw_impl_port_register(struct pw_impl_port *port,
@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 #include <spa/utils/ansi.h>
 #include <spa/utils/json.h>
@@ -16,29 +17,380 @@
 #include "pipewire/log.h"
 #include "pipewire/utils.h"
 #include "pipewire/properties.h"
+#include "pipewire/private.h"
 
 PW_LOG_TOPIC_EXTERN(log_properties);
 #define PW_LOG_TOPIC_DEFAULT log_properties
 
 /** \cond */
+/* below this many items, a linear scan is faster than the index */
+#define INDEX_MIN_ITEMS	8
+
+struct index_entry {
+	uint32_t hash;
+	uint32_t pos;			/* item position + 1, 0 is an empty slot */
+};
+
 struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+
+	/* open addressing hash table from key to item position, only
+	 * used with more than INDEX_MIN_ITEMS items */
+	struct index_entry *index;
+	uint32_t index_mask;
+	bool index_dups;		/* some keys are in the items more than once */
 };
 /** \endcond */
 
+static inline uint32_t hash_key(const char *key)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	while (*key)
+		h = (h ^ (uint8_t)*key++) * 16777619u;
+	return h;
+}
+
+/* longer values are unlikely to be shared and are not interned */
+#define INTERN_MAX_VALUE	64
+
+struct intern_entry {
+	struct intern_entry *next;
+	uint32_t hash;
+	uint32_t ref;
+	char str[];
+};
+
+/* process wide table of interned strings, when enabled, all keys and short
+ * values are shared between properties */
+static struct {
+	pthread_mutex_t lock;
+	bool enabled;
+	uint32_t n_entries;		/* number of strings in the table */
+	uint32_t mask;
+	struct intern_entry **table;
+	uint64_t n_refs;		/* number of users of the strings */
+	size_t size;			/* bytes used by the strings */
+	size_t saved;			/* bytes that would be used without sharing */
+} intern = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static int intern_grow(void)
+{
+	uint32_t i, size = intern.table ? (intern.mask + 1) * 2 : 256;
+	struct intern_entry **table, *e, *next;
+
+	if ((table = calloc(size, sizeof(struct intern_entry *))) == NULL)
+		return -errno;
+
+	for (i = 0; intern.table && i <= intern.mask; i++) {
+		for (e = intern.table[i]; e; e = next) {
+			next = e->next;
+			e->next = table[e->hash & (size - 1)];
+			table[e->hash & (size - 1)] = e;
+		}
+	}
+	free(intern.table);
+	intern.table = table;
+	intern.mask = size - 1;
+	return 0;
+}
+
+/* returns a new reference to the shared copy of str or NULL when
+ * str should not be interned. */
+static const char *intern_ref(const char *str, bool is_key)
+{
+	struct intern_entry *e;
+	uint32_t hash;
+	size_t len;
+
+	if (!SPA_ATOMIC_LOAD(intern.enabled))
+		return NULL;
+
+	len = strlen(str);
+	if (!is_key && len > INTERN_MAX_VALUE)
+		return NULL;
+
+	hash = hash_key(str);
+
+	pthread_mutex_lock(&intern.lock);
+	if (intern.n_entries >= (intern.table ? intern.mask + 1 : 0) &&
+	    intern_grow() < 0)
+		goto error;
+
+	for (e = intern.table[hash & intern.mask]; e; e = e->next) {
+		if (e->hash == hash && spa_streq(e->str, str)) {
+			e->ref++;
+			intern.saved += len + 1;
+			goto done;
+		}
+	}
+	if ((e = malloc(sizeof(*e) + len + 1)) == NULL)
+		goto error;
+	e->hash = hash;
+	e->ref = 1;
+	memcpy(e->str, str, len + 1);
+	e->next = intern.table[hash & intern.mask];
+	intern.table[hash & intern.mask] = e;
+	intern.n_entries++;
+	intern.size += sizeof(*e) + len + 1;
+done:
+	intern.n_refs++;
+	pthread_mutex_unlock(&intern.lock);
+	return e->str;
+error:
+	pthread_mutex_unlock(&intern.lock);
+	return NULL;
+}
+
+/* drop a reference to str when it is interned. Returns false when
+ * str was not interned. */
+static bool intern_unref(const char *str)
+{
+	struct intern_entry **pe, *e;
+	uint32_t hash;
+	bool found = false;
+
+	if (SPA_ATOMIC_LOAD(intern.n_entries) == 0)
+		return false;
+
+	hash = hash_key(str);
+
+	pthread_mutex_lock(&intern.lock);
+	for (pe = &intern.table[hash & intern.mask]; (e = *pe); pe = &e->next) {
+		/* only the string from the table, not a copy with the same contents */
+		if (e->str != str)
+			continue;
+		found = true;
+		intern.n_refs--;
+		if (--e->ref == 0) {
+			*pe = e->next;
+			intern.n_entries--;
+			intern.size -= sizeof(*e) + strlen(e->str) + 1;
+			free(e);
+		} else {
+			intern.saved -= strlen(e->str) + 1;
+		}
+		break;
+	}
+	pthread_mutex_unlock(&intern.lock);
+	return found;
+}
+
+void pw_properties_intern_enable(bool enable)
+{
+	SPA_ATOMIC_STORE(intern.enabled, enable);
+}
+
+void pw_properties_intern_report(void)
+{
+	pthread_mutex_lock(&intern.lock);
+	pw_log_info("interned strings: %u refs:%"PRIu64" size:%zu saved:%zu",
+			intern.n_entries, intern.n_refs, intern.size, intern.saved);
+	pthread_mutex_unlock(&intern.lock);
+}
+
+static void str_free(const char *str)
+{
+	if (str != NULL && !intern_unref(str))
+		free((char*)str);
+}
+
+/* make a copy of str we own, either a shared one or a private copy. When
+ * take is true, the ownership of str is passed to us. */
+static const char *str_copy(const char *str, bool take, bool is_key)
+{
+	const char *s;
+
+	if (str == NULL)
+		return NULL;
+	if ((s = intern_ref(str, is_key)) != NULL) {
+		if (take)
+			str_free(str);
+		return s;
+	}
+	return take ? str : strdup(str);
+}
+
+static inline uint32_t n_items(const struct properties *impl)
+{
+	return pw_array_get_len(&impl->items, struct spa_dict_item);
+}
+
+static inline struct spa_dict_item *item_at(const struct properties *impl, uint32_t pos)
+{
+	return pw_array_get_unchecked(&impl->items, pos, struct spa_dict_item);
+}
+
+/* find the slot of key or the empty slot where it should go */
+static inline struct index_entry *index_find(const struct properties *impl,
+		const char *key, uint32_t hash)
+{
+	uint32_t i = hash & impl->index_mask;
+
+	while (true) {
+		struct index_entry *e = &impl->index[i];
+		if (e->pos == 0 ||
+		    (e->hash == hash && spa_streq(item_at(impl, e->pos - 1)->key, key)))
+			return e;
+		i = (i + 1) & impl->index_mask;
+	}
+}
+
+/* find the slot that points to the item at pos, NULL when the item is not
+ * in the index, which happens for duplicate keys */
+static inline struct index_entry *index_find_pos(const struct properties *impl,
+		uint32_t hash, uint32_t pos)
+{
+	uint32_t i = hash & impl->index_mask;
+
+	while (true) {
+		struct index_entry *e = &impl->index[i];
+		if (e->pos == 0)
+			return NULL;
+		if (e->pos == pos + 1)
+			return e;
+		i = (i + 1) & impl->index_mask;
+	}
+}
+
+static void index_clear(struct properties *impl)
+{
+	free(impl->index);
+	impl->index = NULL;
+	impl->index_mask = 0;
+	impl->index_dups = false;
+}
+
+static int index_rebuild(struct properties *impl)
+{
+	uint32_t i, size, n = n_items(impl);
+	struct index_entry *index;
+
+	if (n < INDEX_MIN_ITEMS) {
+		index_clear(impl);
+		return 0;
+	}
+	/* keep the load factor below 1/2 */
+	for (size = 16; size < n * 2; size <<= 1);
+
+	if ((index = calloc(size, sizeof(struct index_entry))) == NULL) {
+		/* we can do without the index */
+		index_clear(impl);
+		return -errno;
+	}
+	free(impl->index);
+	impl->index = index;
+	impl->index_mask = size - 1;
+	impl->index_dups = false;
+
+	for (i = 0; i < n; i++) {
+		const char *key = item_at(impl, i)->key;
+		uint32_t hash = hash_key(key);
+		struct index_entry *e = index_find(impl, key, hash);
+		/* like the linear scan, the first duplicate key wins */
+		if (e->pos == 0) {
+			e->hash = hash;
+			e->pos = i + 1;
+		} else {
+			impl->index_dups = true;
+		}
+	}
+	return 0;
+}
+
+/* called after the item was appended at the end of the items */
+static void index_add(struct properties *impl, const char *key)
+{
+	uint32_t n = n_items(impl);
+	struct index_entry *e;
+	uint32_t hash;
+
+	if (impl->index == NULL || n * 2 > impl->index_mask + 1) {
+		if (n >= INDEX_MIN_ITEMS)
+			index_rebuild(impl);
+		return;
+	}
+	hash = hash_key(key);
+	e = index_find(impl, key, hash);
+	if (e->pos == 0) {
+		e->hash = hash;
+		e->pos = n;
+	} else {
+		impl->index_dups = true;
+	}
+}
+
+/* called before the item at pos is removed by moving the last item
+ * into its place */
+static void index_remove(struct properties *impl, uint32_t pos)
+{
+	uint32_t i, j, k, last = n_items(impl) - 1;
+	struct index_entry *e;
+
+	if (impl->index == NULL)
+		return;
+
+	if (impl->index_dups) {
+		/* another item with the same key might need to take the place
+		 * of the removed one, do a linear scan until the index is rebuilt
+		 * on the next add */
+		index_clear(impl);
+		return;
+	}
+
+	e = index_find_pos(impl, hash_key(item_at(impl, pos)->key), pos);
+	if (e != NULL) {
+		/* backward shift deletion, move entries that probed past the
+		 * removed slot back so that lookups don't stop early */
+		i = e - impl->index;
+		j = i;
+		while (true) {
+			j = (j + 1) & impl->index_mask;
+			if (impl->index[j].pos == 0)
+				break;
+			k = impl->index[j].hash & impl->index_mask;
+			if ((j > i && (k <= i || k > j)) ||
+			    (j < i && (k <= i && k > j))) {
+				impl->index[i] = impl->index[j];
+				i = j;
+			}
+		}
+		impl->index[i].pos = 0;
+	}
+	if (pos != last) {
+		/* the last item moves into pos, with duplicate keys, the slot
+		 * of the key can point to another item so look it up by position */
+		e = index_find_pos(impl, hash_key(item_at(impl, last)->key), last);
+		if (e != NULL)
+			e->pos = pos + 1;
+	}
+}
+
+static const struct spa_dict_item *lookup_item(const struct properties *impl, const char *key)
+{
+	struct index_entry *e;
+
+	/* when the dict was sorted, the index is stale but we can bsearch */
+	if (impl->index == NULL ||
+	    SPA_FLAG_IS_SET(impl->this.dict.flags, SPA_DICT_FLAG_SORTED))
+		return spa_dict_lookup_item(&impl->this.dict, key);
+
+	e = index_find(impl, key, hash_key(key));
+	return e->pos ? item_at(impl, e->pos - 1) : NULL;
+}
+
 static int add_item(struct properties *impl, const char *key, bool take_key, const char *value, bool take_value)
 {
 	struct spa_dict_item *item;
 	const char *k, *v;
 
-	k = take_key ? key : NULL;
-	v = take_value ? value: NULL;
-
-	if (!take_key && key && (k = strdup(key)) == NULL)
-		goto error;
-	if (!take_value && value && (v = strdup(value)) == NULL)
+	k = key ? str_copy(key, take_key, true) : NULL;
+	v = value ? str_copy(value, take_value, false) : NULL;
+	if ((key && k == NULL) || (value && v == NULL))
 		goto error;
 
 	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
@@ -47,11 +399,12 @@ static int add_item(struct properties *impl, const char *key, bool take_key, con
 
 	item->key = k;
 	item->value = v;
+	index_add(impl, k);
 	return 0;
 
 error:
-	free((char*)k);
-	free((char*)v);
+	str_free(k);
+	str_free(v);
 	return -errno;
 }
 
@@ -64,14 +417,17 @@ static void update_dict(struct pw_properties *properties)
 
 static void clear_item(struct spa_dict_item *item)
 {
-	free((char *) item->key);
-	free((char *) item->value);
+	str_free(item->key);
+	str_free(item->value);
 }
 
 static void properties_init(struct properties *impl, int prealloc)
 {
 	pw_array_init(&impl->items, 16);
 	pw_array_ensure_size(&impl->items, sizeof(struct spa_dict_item) * prealloc);
+	impl->index = NULL;
+	impl->index_mask = 0;
+	impl->index_dups = false;
 }
 
 static struct properties *properties_new(int prealloc)
@@ -163,7 +519,14 @@ static int do_replace(struct pw_properties *properties, const char *key, bool ta
 	if (key == NULL || key[0] == 0)
 		goto exit_noupdate;
 
-	item = (struct spa_dict_item*) spa_dict_lookup_item(&properties->dict, key);
+	/* the items were sorted, the index needs to be updated before
+	 * we make changes */
+	if (impl->index != NULL && SPA_FLAG_IS_SET(properties->dict.flags, SPA_DICT_FLAG_SORTED)) {
+		SPA_FLAG_CLEAR(properties->dict.flags, SPA_DICT_FLAG_SORTED);
+		index_rebuild(impl);
+	}
+
+	item = (struct spa_dict_item*) lookup_item(impl, key);
 
 	if (item == NULL) {
 		if (value == NULL)
@@ -179,31 +542,35 @@ static int do_replace(struct pw_properties *properties, const char *key, bool ta
 			struct spa_dict_item *last = pw_array_get_unchecked(&impl->items,
 						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
 						     struct spa_dict_item);
+			index_remove(impl, item - item_at(impl, 0));
 			clear_item(item);
 			item->key = last->key;
 			item->value = last->value;
 			impl->items.size -= sizeof(struct spa_dict_item);
 			SPA_FLAG_CLEAR(properties->dict.flags, SPA_DICT_FLAG_SORTED);
 		} else {
-			char *v = NULL;
-			if (!take_value && value && (v = strdup(value)) == NULL) {
+			const char *v;
+			if ((v = str_copy(value, take_value, false)) == NULL) {
 				res = -errno;
+				take_value = false;
 				goto exit_noupdate;
 			}
-			free((char *) item->value);
-			item->value = take_value ? value : v;
+			str_free(item->value);
+			item->value = v;
 		}
+		/* taken strings can be interned when they come from our own
+		 * items, see update_string() */
 		if (take_key)
-			free((char*)key);
+			str_free(key);
 	}
 	update_dict(properties);
 	return 1;
 
 exit_noupdate:
 	if (take_key)
-		free((char*)key);
+		str_free(key);
 	if (take_value)
-		free((char*)value);
+		str_free(value);
 	return res;
 }
 
@@ -250,7 +617,7 @@ static int update_string(struct pw_properties *props, const char *str, size_t si
 		}
 		if (props) {
 			const struct spa_dict_item *item;
-			item = spa_dict_lookup_item(&props->dict, key);
+			item = lookup_item(SPA_CONTAINER_OF(props, struct properties, this), key);
 			if (item && spa_streq(item->value, val)) {
 				free(val);
 				continue;
@@ -284,6 +651,7 @@ static int update_string(struct pw_properties *props, const char *str, size_t si
 				clear_item(item);
 		}
 		pw_array_clear(&changes.items);
+		index_clear(&changes);
 	}
 	if (count)
 		*count = cnt;
@@ -464,6 +832,7 @@ void pw_properties_clear(struct pw_properties *properties)
 	pw_array_for_each(item, &impl->items)
 		clear_item(item);
 	pw_array_reset(&impl->items);
+	index_clear(impl);
 	properties->dict.n_items = 0;
 }
 
@@ -639,7 +1008,9 @@ int pw_properties_setf(struct pw_properties *properties, const char *key, const
 SPA_EXPORT
 const char *pw_properties_get(const struct pw_properties *properties, const char *key)
 {
-	return spa_dict_lookup(&properties->dict, key);
+	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
+	const struct spa_dict_item *item = lookup_item(impl, key);
+	return item ? item->value : NULL;
 }
 
 /** Fetch a property as uint32_t.
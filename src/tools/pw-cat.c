@@ -25,6 +25,8 @@
 #include <spa/utils/result.h>
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
+#include <spa/utils/ringbuffer.h>
+#include <spa/utils/atomic.h>
 #include <spa/debug/types.h>
 #include <spa/debug/file.h>
 
@@ -110,6 +112,7 @@ struct data {
 	const char *format;
 	const char *target;
 	const char *latency;
+	const char *io_buffer;
 	struct pw_properties *props;
 
 	const char *filename;
@@ -131,6 +134,25 @@ struct data {
 
 	fill_fn fill;
 
+	/* with --io-buffer, the sndfile calls are done from a separate
+	 * thread and the stream only copies from/to the ring */
+	struct {
+		fill_fn fill;
+		struct pw_thread_loop *thread;
+		struct spa_source *event;
+		struct spa_ringbuffer ring;
+		void *data;
+		uint32_t size;
+		uint32_t threshold;
+		bool eof;
+		int error;
+
+		uint64_t xruns;
+		uint64_t lost_frames;
+		uint64_t io_time;
+		uint64_t io_max;
+	} io;
+
 	struct spa_io_position *position;
 	bool drained;
 	uint64_t clock_time;
@@ -538,6 +560,144 @@ record_fill_fn(uint32_t fmt)
 	return NULL;
 }
 
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static int io_call(struct data *d, void *p, unsigned int n_frames)
+{
+	uint64_t t1, t2;
+	bool null_frame = false;
+	int res;
+
+	t1 = get_time_ns();
+	res = d->io.fill(d, p, n_frames, &null_frame);
+	t2 = get_time_ns();
+
+	d->io.io_time += t2 - t1;
+	d->io.io_max = SPA_MAX(d->io.io_max, t2 - t1);
+	return res;
+}
+
+/* called from the io thread, read from the file until the ring is full */
+static void io_playback_refill(struct data *d, bool force)
+{
+	uint32_t index, avail, offs;
+	int32_t filled;
+	int res;
+
+	while (!d->io.eof) {
+		filled = spa_ringbuffer_get_write_index(&d->io.ring, &index);
+		avail = d->io.size - filled;
+		if (avail < d->stride || (!force && avail < d->io.threshold))
+			break;
+
+		offs = index % d->io.size;
+		avail = SPA_MIN(avail, d->io.size - offs);
+
+		res = io_call(d, SPA_PTROFF(d->io.data, offs, void), avail / d->stride);
+		if (res <= 0) {
+			d->io.error = res;
+			SPA_ATOMIC_STORE(d->io.eof, true);
+			break;
+		}
+		spa_ringbuffer_write_update(&d->io.ring, index + res * d->stride);
+		force = true;
+	}
+}
+
+/* called from the io thread, write the ring to the file */
+static void io_record_drain(struct data *d, bool force)
+{
+	uint32_t index, avail, offs, n_frames;
+	int32_t filled;
+	int res;
+
+	while (true) {
+		filled = spa_ringbuffer_get_read_index(&d->io.ring, &index);
+		avail = SPA_MAX(filled, 0);
+		if (avail < d->stride || (!force && avail < d->io.threshold))
+			break;
+
+		offs = index % d->io.size;
+		avail = SPA_MIN(avail, d->io.size - offs);
+		n_frames = avail / d->stride;
+
+		res = io_call(d, SPA_PTROFF(d->io.data, offs, void), n_frames);
+		if (res < 0) {
+			d->io.error = res;
+			break;
+		}
+		/* only consume what was written, the rest stays in the ring
+		 * for the next drain */
+		spa_ringbuffer_read_update(&d->io.ring, index + res * d->stride);
+		if ((uint32_t)res < n_frames)
+			break;
+		force = true;
+	}
+}
+
+static void io_event(void *data, uint64_t count)
+{
+	struct data *d = data;
+
+	if (d->mode == mode_playback)
+		io_playback_refill(d, false);
+	else
+		io_record_drain(d, false);
+}
+
+static int io_playback_fill(struct data *d, void *dest, unsigned int n_frames, bool *null_frame)
+{
+	uint32_t index, avail, n_bytes = n_frames * d->stride;
+	int32_t filled;
+	bool eof;
+
+	/* check eof before the ring so that we don't miss the last data */
+	eof = SPA_ATOMIC_LOAD(d->io.eof);
+
+	filled = spa_ringbuffer_get_read_index(&d->io.ring, &index);
+	avail = SPA_MIN((uint32_t)SPA_MAX(filled, 0), n_bytes);
+	if (avail > 0) {
+		spa_ringbuffer_read_data(&d->io.ring, d->io.data, d->io.size,
+				index % d->io.size, dest, avail);
+		spa_ringbuffer_read_update(&d->io.ring, index + avail);
+	}
+	if (avail < n_bytes && !eof) {
+		d->io.xruns++;
+		d->io.lost_frames += (n_bytes - avail) / d->stride;
+		if (avail == 0)
+			*null_frame = true;
+	}
+	pw_loop_signal_event(pw_thread_loop_get_loop(d->io.thread), d->io.event);
+
+	return avail / d->stride;
+}
+
+static int io_record_fill(struct data *d, void *src, unsigned int n_frames, bool *null_frame)
+{
+	uint32_t index, avail, n_bytes = n_frames * d->stride;
+	int32_t filled;
+
+	filled = spa_ringbuffer_get_write_index(&d->io.ring, &index);
+	avail = SPA_MIN(d->io.size - SPA_MIN((uint32_t)SPA_MAX(filled, 0), d->io.size), n_bytes);
+	if (avail > 0) {
+		spa_ringbuffer_write_data(&d->io.ring, d->io.data, d->io.size,
+				index % d->io.size, src, avail);
+		spa_ringbuffer_write_update(&d->io.ring, index + avail);
+	}
+	if (avail < n_bytes) {
+		d->io.xruns++;
+		d->io.lost_frames += (n_bytes - avail) / d->stride;
+	}
+	pw_loop_signal_event(pw_thread_loop_get_loop(d->io.thread), d->io.event);
+
+	return avail / d->stride;
+}
+
 static int channelmap_from_sf(struct channelmap *map)
 {
 	static const enum spa_audio_channel table[] = {
@@ -951,6 +1111,7 @@ enum {
 	OPT_CHANNELMAP,
 	OPT_FORMAT,
 	OPT_VOLUME,
+	OPT_IO_BUFFER,
 };
 
 static const struct option long_options[] = {
@@ -977,6 +1138,7 @@ static const struct option long_options[] = {
 	{ "format",		required_argument, NULL, OPT_FORMAT },
 	{ "volume",		required_argument, NULL, OPT_VOLUME },
 	{ "quality",		required_argument, NULL, 'q' },
+	{ "io-buffer",		required_argument, NULL, OPT_IO_BUFFER },
 
 	{ NULL, 0, NULL, 0 }
 };
@@ -1021,6 +1183,10 @@ static void show_usage(const char *name, bool is_error)
 	     "      --format                          Sample format %s (req. for rec) (default %s)\n"
 	     "      --volume                          Stream volume 0-1.0 (default %.3f)\n"
 	     "  -q  --quality                         Resampler quality (0 - 15) (default %d)\n"
+	     "      --io-buffer                       Read/write the file from a separate thread\n"
+	     "                                          with a buffer of this size\n"
+	     "                                          Xunit (unit = s, ms, us, ns)\n"
+	     "                                          or direct samples (96000)\n"
 	     "\n"),
 	     DEFAULT_RATE,
 	     DEFAULT_CHANNELS,
@@ -1530,65 +1696,136 @@ static int setup_sndfile(struct data *data)
 	return 0;
 }
 
-static int setup_properties(struct data *data)
+static int parse_unit(const char *str, enum unit *unit, unsigned int *value)
 {
-	const char *s;
-	unsigned int nom = 0;
+	const char *s = str;
 
-	if (data->quality >= 0 && pw_properties_get(data->props, "resample.quality") == NULL)
-		pw_properties_setf(data->props, "resample.quality", "%d", data->quality);
-
-	if (data->rate && pw_properties_get(data->props, PW_KEY_NODE_RATE) == NULL)
-		pw_properties_setf(data->props, PW_KEY_NODE_RATE, "1/%u", data->rate);
-
-	data->latency_unit = unit_none;
-
-	s = data->latency;
 	while (*s && isdigit(*s))
 		s++;
 	if (!*s)
-		data->latency_unit = unit_samples;
+		*unit = unit_samples;
 	else if (spa_streq(s, "none"))
-		data->latency_unit = unit_none;
+		*unit = unit_none;
 	else if (spa_streq(s, "s") || spa_streq(s, "sec") || spa_streq(s, "secs"))
-		data->latency_unit = unit_sec;
+		*unit = unit_sec;
 	else if (spa_streq(s, "ms") || spa_streq(s, "msec") || spa_streq(s, "msecs"))
-		data->latency_unit = unit_msec;
+		*unit = unit_msec;
 	else if (spa_streq(s, "us") || spa_streq(s, "usec") || spa_streq(s, "usecs"))
-		data->latency_unit = unit_usec;
+		*unit = unit_usec;
 	else if (spa_streq(s, "ns") || spa_streq(s, "nsec") || spa_streq(s, "nsecs"))
-		data->latency_unit = unit_nsec;
-	else {
-		fprintf(stderr, "error: bad latency value %s (bad unit)\n", data->latency);
-		return -EINVAL;
-	}
-	data->latency_value = atoi(data->latency);
-	if (!data->latency_value && data->latency_unit != unit_none) {
-		fprintf(stderr, "error: bad latency value %s (is zero)\n", data->latency);
+		*unit = unit_nsec;
+	else
 		return -EINVAL;
-	}
 
-	switch (data->latency_unit) {
+	*value = atoi(str);
+	return 0;
+}
+
+static unsigned int unit_to_frames(enum unit unit, unsigned int value, unsigned int rate)
+{
+	switch (unit) {
 	case unit_sec:
-		nom = data->latency_value * data->rate;
-		break;
+		return value * rate;
 	case unit_msec:
-		nom = (unsigned int)nearbyint((data->latency_value * data->rate) / 1000.0);
-		break;
+		return (unsigned int)nearbyint((value * rate) / 1000.0);
 	case unit_usec:
-		nom = (unsigned int)nearbyint((data->latency_value * data->rate) / 1000000.0);
-		break;
+		return (unsigned int)nearbyint((value * rate) / 1000000.0);
 	case unit_nsec:
-		nom = (unsigned int)nearbyint((data->latency_value * data->rate) / 1000000000.0);
-		break;
+		return (unsigned int)nearbyint((value * rate) / 1000000000.0);
 	case unit_samples:
-		nom = data->latency_value;
-		break;
+		return value;
 	default:
-		nom = 0;
-		break;
+		return 0;
+	}
+}
+
+static int setup_io_thread(struct data *data)
+{
+	enum unit unit;
+	unsigned int value, frames;
+	uint64_t size;
+
+	if (parse_unit(data->io_buffer, &unit, &value) < 0 ||
+	    (frames = unit_to_frames(unit, value, data->rate)) == 0) {
+		fprintf(stderr, "error: bad io-buffer value %s\n", data->io_buffer);
+		return -EINVAL;
+	}
+	size = (uint64_t)frames * data->stride;
+	if (size > INT32_MAX) {
+		fprintf(stderr, "error: io-buffer %s too large\n", data->io_buffer);
+		return -EINVAL;
+	}
+	data->io.size = size;
+	/* wake up the file io when a quarter of the ring is free/filled */
+	data->io.threshold = SPA_ROUND_DOWN(data->io.size / 4, data->stride);
+	if ((data->io.data = calloc(1, data->io.size)) == NULL)
+		return -errno;
+	spa_ringbuffer_init(&data->io.ring);
+
+	if ((data->io.thread = pw_thread_loop_new("pw-cat-io", NULL)) == NULL)
+		return -errno;
+	data->io.event = pw_loop_add_event(pw_thread_loop_get_loop(data->io.thread),
+			io_event, data);
+	if (data->io.event == NULL)
+		return -errno;
+
+	data->io.fill = data->fill;
+	if (data->mode == mode_playback) {
+		data->fill = io_playback_fill;
+		io_playback_refill(data, true);
+	} else {
+		data->fill = io_record_fill;
 	}
 
+	if (data->verbose)
+		printf("io: buffer:%u frames (%.3fs)\n", frames, (double)frames / data->rate);
+
+	return pw_thread_loop_start(data->io.thread);
+}
+
+static void io_thread_stop(struct data *data)
+{
+	if (data->io.thread == NULL)
+		return;
+
+	pw_thread_loop_stop(data->io.thread);
+	if (data->mode == mode_record)
+		io_record_drain(data, true);
+
+	if (data->io.error < 0)
+		fprintf(stderr, "io: file error: %s\n", spa_strerror(data->io.error));
+	if (data->verbose || data->io.xruns > 0)
+		fprintf(stderr, "io: xruns:%"PRIu64" lost:%.3fs io-time:%.3fs max-io:%.3fms\n",
+				data->io.xruns,
+				data->rate ? (double)data->io.lost_frames / data->rate : 0.0,
+				data->io.io_time / (double)SPA_NSEC_PER_SEC,
+				data->io.io_max / (double)SPA_NSEC_PER_MSEC);
+
+	pw_thread_loop_destroy(data->io.thread);
+	free(data->io.data);
+	data->io.thread = NULL;
+}
+
+static int setup_properties(struct data *data)
+{
+	unsigned int nom = 0;
+
+	if (data->quality >= 0 && pw_properties_get(data->props, "resample.quality") == NULL)
+		pw_properties_setf(data->props, "resample.quality", "%d", data->quality);
+
+	if (data->rate && pw_properties_get(data->props, PW_KEY_NODE_RATE) == NULL)
+		pw_properties_setf(data->props, PW_KEY_NODE_RATE, "1/%u", data->rate);
+
+	if (parse_unit(data->latency, &data->latency_unit, &data->latency_value) < 0) {
+		fprintf(stderr, "error: bad latency value %s (bad unit)\n", data->latency);
+		return -EINVAL;
+	}
+	if (!data->latency_value && data->latency_unit != unit_none) {
+		fprintf(stderr, "error: bad latency value %s (is zero)\n", data->latency);
+		return -EINVAL;
+	}
+	nom = unit_to_frames(data->latency_unit, data->latency_value, data->rate);
+
 	if (data->verbose)
 		printf("rate:%d latency:%u (%.3fs)\n",
 				data->rate, nom, data->rate ? (double)nom/data->rate : 0.0f);
@@ -1751,6 +1988,10 @@ int main(int argc, char *argv[])
 			data.latency = optarg;
 			break;
 
+		case OPT_IO_BUFFER:
+			data.io_buffer = optarg;
+			break;
+
 		case OPT_RATE:
 			ret = atoi(optarg);
 			if (ret <= 0) {
@@ -1873,6 +2114,8 @@ int main(int argc, char *argv[])
 		switch (data.data_type) {
 		case TYPE_PCM:
 			ret = setup_sndfile(&data);
+			if (ret >= 0 && data.io_buffer != NULL)
+				ret = setup_io_thread(&data);
 			break;
 		case TYPE_MIDI:
 			ret = setup_midifile(&data);
@@ -2064,6 +2307,7 @@ error_no_context:
 error_no_props:
 error_no_main_loop:
 	pw_properties_free(data.props);
+	io_thread_stop(&data);
 	if (data.file)
 		sf_close(data.file);
 	if (data.midi.file)
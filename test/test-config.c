@@ -4,8 +4,18 @@
 
 #include "pwtest.h"
 
+#include <sys/stat.h>
+
 #include <pipewire/conf.h>
 
+static void write_file(const char *path, const char *data)
+{
+	FILE *fp = fopen(path, "we");
+	pwtest_ptr_notnull(fp);
+	fputs(data, fp);
+	fclose(fp);
+}
+
 PWTEST(config_load_abspath)
 {
 	char path[PATH_MAX];
@@ -73,10 +83,75 @@ PWTEST(config_load_nullname)
 	return PWTEST_PASS;
 }
 
+PWTEST(config_load_cache)
+{
+	const char *tmpdir = getenv("TMPDIR");
+	char dir[PATH_MAX], path[PATH_MAX];
+	struct pw_properties *props, *cached;
+	const struct spa_dict_item *it;
+	struct stat sbuf;
+	char *p;
+	int r;
+
+	pwtest_ptr_notnull(tmpdir);
+	spa_scnprintf(dir, sizeof(dir), "%s/conf", tmpdir);
+	pwtest_errno_ok(mkdir(dir, 0700));
+	spa_scnprintf(path, sizeof(path), "%s/test.conf.d", dir);
+	pwtest_errno_ok(mkdir(path, 0700));
+
+	spa_scnprintf(path, sizeof(path), "%s/test.conf", dir);
+	write_file(path, "data = x\nlist = [ a b ]\nobj = { k = \"v\" }\nnone = null\n");
+	spa_scnprintf(path, sizeof(path), "%s/test.conf.d/10-extra.conf", dir);
+	write_file(path, "extra = \"1\"\n");
+
+	setenv("PIPEWIRE_CONFIG_CACHE_DIR", tmpdir, 1);
+
+	props = pw_properties_new("ignore", "me", "none", "x", NULL);
+	r = pw_conf_load_conf(dir, "test.conf", props);
+	pwtest_neg_errno_ok(r);
+	pwtest_str_eq(pw_properties_get(props, "data"), "x");
+	pwtest_str_eq(pw_properties_get(props, "list"), "[ a b ]");
+	pwtest_str_eq(pw_properties_get(props, "obj"), "{ k = \"v\" }");
+	pwtest_ptr_null(pw_properties_get(props, "none"));
+	pwtest_str_eq(pw_properties_get(props, "override.1.0.extra"), "1");
+
+	spa_scnprintf(path, sizeof(path), "%s/%s-test.conf.cache", tmpdir, dir);
+	for (p = path + strlen(tmpdir) + 1; *p; p++)
+		if (*p == '/')
+			*p = '_';
+	pwtest_errno_ok(stat(path, &sbuf));
+
+	/* second load comes from the cache and must give the same result */
+	cached = pw_properties_new("ignore", "me", "none", "x", NULL);
+	r = pw_conf_load_conf(dir, "test.conf", cached);
+	pwtest_neg_errno_ok(r);
+	pwtest_int_eq(cached->dict.n_items, props->dict.n_items);
+	spa_dict_for_each(it, &props->dict)
+		pwtest_str_eq(pw_properties_get(cached, it->key), it->value);
+	pw_properties_free(cached);
+
+	/* changed files are parsed again */
+	spa_scnprintf(path, sizeof(path), "%s/test.conf.d/10-extra.conf", dir);
+	write_file(path, "extra = \"changed\"\n");
+
+	cached = pw_properties_new(NULL, NULL);
+	r = pw_conf_load_conf(dir, "test.conf", cached);
+	pwtest_neg_errno_ok(r);
+	pwtest_str_eq(pw_properties_get(cached, "data"), "x");
+	pwtest_str_eq(pw_properties_get(cached, "override.1.0.extra"), "changed");
+	pw_properties_free(cached);
+
+	pw_properties_free(props);
+	unsetenv("PIPEWIRE_CONFIG_CACHE_DIR");
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(context)
 {
 	pwtest_add(config_load_abspath, PWTEST_NOARG);
 	pwtest_add(config_load_nullname, PWTEST_NOARG);
+	pwtest_add(config_load_cache, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/eventfd.h>
 
 #include "pwtest.h"
@@ -435,6 +437,88 @@ PWTEST(cancel_thread_while_dispatching)
 	return PWTEST_PASS;
 }
 
+#define BENCH_THREADS	4
+#define BENCH_INVOKES	(1 << 16)
+#define BENCH_BATCH	128
+
+struct bench_data {
+	struct pw_loop *l;
+	uint64_t count;
+	uint64_t sum;
+};
+
+static int bench_do_invoke(struct spa_loop *loop, bool async, uint32_t seq,
+			   const void *d, size_t size, void *user_data)
+{
+	struct bench_data *data = user_data;
+	data->count++;
+	data->sum += *(const uint32_t*)d;
+	return 0;
+}
+
+static int bench_do_sync(struct spa_loop *loop, bool async, uint32_t seq,
+			 const void *d, size_t size, void *user_data)
+{
+	return 0;
+}
+
+static void *bench_thread(void *user_data)
+{
+	struct bench_data *data = user_data;
+	uint32_t i;
+
+	for (i = 0; i < BENCH_INVOKES; i++) {
+		pw_loop_invoke(data->l, bench_do_invoke, 0, &i, sizeof(i), false, data);
+		/* don't let the queue overflow, wait for the loop every batch */
+		if ((i % BENCH_BATCH) == BENCH_BATCH - 1)
+			pw_loop_invoke(data->l, bench_do_sync, 0, NULL, 0, true, data);
+	}
+	return NULL;
+}
+
+PWTEST(invoke_throughput)
+{
+	struct bench_data data;
+	struct pw_data_loop *dl;
+	pthread_t threads[BENCH_THREADS];
+	struct timespec t1, t2;
+	uint64_t total = (uint64_t)BENCH_THREADS * BENCH_INVOKES, nsec;
+	uint32_t i;
+
+	pw_init(NULL, NULL);
+
+	dl = pw_data_loop_new(NULL);
+	pwtest_ptr_notnull(dl);
+	pwtest_neg_errno_ok(pw_data_loop_start(dl));
+
+	spa_zero(data);
+	data.l = pw_data_loop_get_loop(dl);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (i = 0; i < BENCH_THREADS; i++)
+		pwtest_int_eq(pthread_create(&threads[i], NULL, bench_thread, &data), 0);
+	for (i = 0; i < BENCH_THREADS; i++)
+		pthread_join(threads[i], NULL);
+	/* flushes everything that is still queued */
+	pw_loop_invoke(data.l, bench_do_sync, 0, NULL, 0, true, &data);
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	pwtest_int_eq(data.count, total);
+	pwtest_int_eq(data.sum, (uint64_t)BENCH_THREADS * BENCH_INVOKES * (BENCH_INVOKES - 1) / 2);
+
+	nsec = SPA_TIMESPEC_TO_NSEC(&t2) - SPA_TIMESPEC_TO_NSEC(&t1);
+	printf("%d threads, %"PRIu64" invokes in %f sec, %f invokes/sec\n",
+			BENCH_THREADS, total, nsec / (double)SPA_NSEC_PER_SEC,
+			total * (double)SPA_NSEC_PER_SEC / nsec);
+
+	pw_data_loop_stop(dl);
+	pw_data_loop_destroy(dl);
+
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(support)
 {
 	pwtest_add(pwtest_loop_destroy2, PWTEST_NOARG);
@@ -443,6 +527,7 @@ PWTEST_SUITE(support)
 	pwtest_add(destroy_managed_source_before_dispatch, PWTEST_NOARG);
 	pwtest_add(destroy_managed_source_before_dispatch_recurse, PWTEST_NOARG);
 	pwtest_add(cancel_thread_while_dispatching, PWTEST_NOARG);
+	pwtest_add(invoke_throughput, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
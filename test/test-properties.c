@@ -5,8 +5,12 @@
 
 #include "config.h"
 
+#include <stdio.h>
+#include <time.h>
+
 #include "pwtest.h"
 
+#include "pipewire/pipewire.h"
 #include "pipewire/properties.h"
 
 PWTEST(properties_abi)
@@ -584,6 +588,178 @@ PWTEST(properties_update)
 	return PWTEST_PASS;
 }
 
+PWTEST(properties_many)
+{
+	struct pw_properties *props;
+	char key[64], value[64];
+	uint32_t i;
+
+	props = pw_properties_new(NULL, NULL);
+	pwtest_ptr_notnull(props);
+
+	for (i = 0; i < 200; i++) {
+		spa_scnprintf(key, sizeof(key), "key.%u", i);
+		pwtest_int_eq(pw_properties_setf(props, key, "value.%u", i), 1);
+	}
+	pwtest_int_eq(props->dict.n_items, 200U);
+
+	/* remove every third key, this moves items around */
+	for (i = 0; i < 200; i += 3) {
+		spa_scnprintf(key, sizeof(key), "key.%u", i);
+		pwtest_int_eq(pw_properties_set(props, key, NULL), 1);
+	}
+
+	for (i = 0; i < 200; i++) {
+		const char *str;
+		spa_scnprintf(key, sizeof(key), "key.%u", i);
+		spa_scnprintf(value, sizeof(value), "value.%u", i);
+		str = pw_properties_get(props, key);
+		if (i % 3 == 0)
+			pwtest_ptr_null(str);
+		else
+			pwtest_str_eq(str, value);
+	}
+
+	/* sorting the dict reorders the items behind our back */
+	spa_dict_qsort(&props->dict);
+	pwtest_str_eq(pw_properties_get(props, "key.1"), "value.1");
+	pwtest_int_eq(pw_properties_set(props, "key.0", "value.0"), 1);
+	pwtest_int_eq(pw_properties_set(props, "key.2", NULL), 1);
+	pwtest_str_eq(pw_properties_get(props, "key.0"), "value.0");
+	pwtest_ptr_null(pw_properties_get(props, "key.2"));
+	pwtest_str_eq(pw_properties_get(props, "key.199"), "value.199");
+
+	pw_properties_clear(props);
+	pwtest_ptr_null(pw_properties_get(props, "key.1"));
+	pwtest_int_eq(pw_properties_set(props, "key.1", "foo"), 1);
+	pwtest_str_eq(pw_properties_get(props, "key.1"), "foo");
+
+	pw_properties_free(props);
+
+	/* duplicate keys, the first one wins like with a linear scan and the
+	 * next one takes over when it is removed */
+	{
+		struct spa_dict_item items[20];
+		char keys[20][16], values[20][16];
+
+		for (i = 0; i < 20; i++) {
+			spa_scnprintf(keys[i], sizeof(keys[i]), "key.%u", i % 10);
+			spa_scnprintf(values[i], sizeof(values[i]), "value.%u", i);
+			items[i] = SPA_DICT_ITEM_INIT(keys[i], values[i]);
+		}
+		props = pw_properties_new_dict(&SPA_DICT_INIT(items, 20));
+		pwtest_ptr_notnull(props);
+		pwtest_int_eq(props->dict.n_items, 20U);
+		pwtest_str_eq(pw_properties_get(props, "key.3"), "value.3");
+
+		pwtest_int_eq(pw_properties_set(props, "key.3", NULL), 1);
+		pwtest_str_eq(pw_properties_get(props, "key.3"), "value.13");
+		pwtest_int_eq(pw_properties_set(props, "key.3", NULL), 1);
+		pwtest_ptr_null(pw_properties_get(props, "key.3"));
+
+		/* removing moves the last item, the index must follow */
+		for (i = 0; i < 10; i++) {
+			if (i == 3)
+				continue;
+			spa_scnprintf(key, sizeof(key), "key.%u", i);
+			pwtest_ptr_notnull(pw_properties_get(props, key));
+			pwtest_int_eq(pw_properties_set(props, key, "new"), 1);
+			pwtest_str_eq(pw_properties_get(props, key), "new");
+		}
+		pw_properties_free(props);
+	}
+
+	return PWTEST_PASS;
+}
+
+PWTEST(properties_intern)
+{
+	struct pw_properties *p1, *p2, *p3;
+	char long_value[256];
+	const char *str;
+
+	pw_init(NULL, NULL);
+
+	memset(long_value, 'x', sizeof(long_value) - 1);
+	long_value[sizeof(long_value) - 1] = '\0';
+
+	p1 = pw_properties_new("media.class", "Audio/Sink",
+			"node.name", "foo",
+			"node.description", long_value, NULL);
+	pwtest_ptr_notnull(p1);
+	p2 = pw_properties_new("media.class", "Audio/Sink", NULL);
+	pwtest_ptr_notnull(p2);
+	pwtest_int_eq(pw_properties_setf(p2, "node.name", "%s", "foo"), 1);
+	pwtest_int_eq(pw_properties_set(p2, "node.description", long_value), 1);
+
+	/* keys and short values are shared */
+	pwtest_ptr_eq(p1->dict.items[0].key, p2->dict.items[0].key);
+	pwtest_ptr_eq(pw_properties_get(p1, "media.class"), pw_properties_get(p2, "media.class"));
+	pwtest_ptr_eq(pw_properties_get(p1, "node.name"), pw_properties_get(p2, "node.name"));
+	/* long values are not */
+	pwtest_ptr_ne(pw_properties_get(p1, "node.description"),
+			pw_properties_get(p2, "node.description"));
+	pwtest_str_eq(pw_properties_get(p1, "node.description"), long_value);
+
+	p3 = pw_properties_copy(p1);
+	pwtest_ptr_notnull(p3);
+	pw_properties_free(p1);
+	pwtest_str_eq(pw_properties_get(p3, "media.class"), "Audio/Sink");
+	pwtest_ptr_eq(pw_properties_get(p3, "media.class"), pw_properties_get(p2, "media.class"));
+
+	pwtest_int_eq(pw_properties_set(p2, "media.class", "Audio/Source"), 1);
+	pwtest_str_eq(pw_properties_get(p2, "media.class"), "Audio/Source");
+	pwtest_str_eq(pw_properties_get(p3, "media.class"), "Audio/Sink");
+	str = "{ media.class = Audio/Source node.name = null }";
+	pwtest_int_eq(pw_properties_update_string(p3, str, strlen(str)), 2);
+	pwtest_ptr_eq(pw_properties_get(p3, "media.class"), pw_properties_get(p2, "media.class"));
+	pwtest_ptr_null(pw_properties_get(p3, "node.name"));
+
+	pw_properties_free(p2);
+	pw_properties_free(p3);
+
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
+PWTEST(properties_lookup_benchmark)
+{
+	struct pw_properties *props;
+	struct spa_dict_item items[64];
+	char keys[64][32];
+	struct timespec ts;
+	uint64_t t1, t2, count = 0;
+	uint32_t i, j, n_items;
+
+	for (n_items = 8; n_items <= 64; n_items *= 2) {
+		for (i = 0; i < n_items; i++) {
+			spa_scnprintf(keys[i], sizeof(keys[i]), "node.property.%u", i);
+			items[i] = SPA_DICT_ITEM_INIT(keys[i], "value");
+		}
+		props = pw_properties_new_dict(&SPA_DICT_INIT(items, n_items));
+		pwtest_ptr_notnull(props);
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+		for (j = 0; j < 100000; j++) {
+			for (i = 0; i < n_items; i++)
+				count += pw_properties_get(props, keys[i]) != NULL;
+			count += pw_properties_get(props, "not.there") != NULL;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+		printf("%u items: %f ns/lookup\n", n_items,
+				(t2 - t1) / (100000.0 * (n_items + 1)));
+
+		pw_properties_free(props);
+	}
+	pwtest_int_eq(count, 100000U * (8 + 16 + 32 + 64));
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(properties)
 {
 	pwtest_add(properties_abi, PWTEST_NOARG);
@@ -603,6 +779,10 @@ PWTEST_SUITE(properties)
 	pwtest_add(properties_new_dict, PWTEST_NOARG);
 	pwtest_add(properties_new_json, PWTEST_NOARG);
 	pwtest_add(properties_update, PWTEST_NOARG);
+	pwtest_add(properties_many, PWTEST_NOARG);
+	pwtest_add(properties_intern,
+			PWTEST_ARG_ENV, "PIPEWIRE_INTERN_PROPERTIES", "true");
+	pwtest_add(properties_lookup_benchmark, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
@@ -1065,6 +1065,123 @@ PWTEST(json_data)
 	return PWTEST_PASS;
 }
 
+/* fill buf with c[0] followed by n times c[1], the special sequence x and
+ * then 20 times c[2] and c[3] */
+static int make_run(char *buf, const char *c, int n, const char *x)
+{
+	int len = 0;
+
+	buf[len++] = c[0];
+	memset(&buf[len], c[1], n);
+	len += n;
+	len += sprintf(&buf[len], "%s", x);
+	memset(&buf[len], c[2], 20);
+	len += 20;
+	if (c[3])
+		buf[len++] = c[3];
+	buf[len] = '\0';
+	return len;
+}
+
+PWTEST(json_parse_runs)
+{
+	char buf[128];
+	struct spa_json it;
+	const char *value;
+	int k, len;
+
+	/* The runs of plain characters in strings, bare words and comments
+	 * are skipped 16 bytes at a time, starting from the second character
+	 * of the run. Put the interesting characters at offsets 15, 16 and 17
+	 * of that skip, around the edge of the first block, and check that
+	 * the result matches the byte by byte parsing. */
+	for (k = 15; k <= 17; k++) {
+		/* valid strings, one token */
+		static const char *valid[] = { "\\n", "\\\"", "\xc3\xa9", "\xe2\x82\xac", "\x7f" };
+		/* invalid characters in strings */
+		static const char *invalid[] = { "\x01", "\x1f", "\x80", "\t" };
+		/* invalid characters in bare words */
+		static const char *bare_invalid[] = { "\\", "\xc3\xa9", "\x7f", "\x01" };
+		/* characters that end a bare word */
+		static const char *bare_end[] = { " ", "=", ":", ",", "#" };
+		size_t i;
+
+		for (i = 0; i < SPA_N_ELEMENTS(valid); i++) {
+			len = make_run(buf, "\"ab\"", k + 1, valid[i]);
+			spa_json_init(&it, buf, len);
+			pwtest_int_eq(spa_json_next(&it, &value), len);
+			pwtest_ptr_eq(value, &buf[0]);
+			expect_end(&it);
+		}
+		for (i = 0; i < SPA_N_ELEMENTS(invalid); i++) {
+			len = make_run(buf, "\"ab\"", k + 1, invalid[i]);
+			spa_json_init(&it, buf, len);
+			expect_parse_error(&it, buf, 1, k + 3);
+		}
+
+		/* a string that ends at the offset */
+		len = make_run(buf, "\"ab", k + 1, "\" ");
+		spa_json_init(&it, buf, len);
+		pwtest_int_eq(spa_json_next(&it, &value), k + 3);
+		pwtest_ptr_eq(value, &buf[0]);
+		pwtest_int_eq(spa_json_next(&it, &value), 20);
+		pwtest_ptr_eq(value, buf + k + 4);
+		expect_end(&it);
+
+		for (i = 0; i < SPA_N_ELEMENTS(bare_invalid); i++) {
+			len = make_run(buf, "aab", k + 1, bare_invalid[i]);
+			spa_json_init(&it, buf, len);
+			expect_parse_error(&it, buf, 1, k + 3);
+		}
+		for (i = 0; i < SPA_N_ELEMENTS(bare_end); i++) {
+			len = make_run(buf, "aab", k + 1, bare_end[i]);
+			spa_json_init(&it, buf, len);
+			pwtest_int_eq(spa_json_next(&it, &value), k + 2);
+			pwtest_ptr_eq(value, &buf[0]);
+			/* after # the rest is a comment */
+			if (bare_end[i][0] != '#') {
+				pwtest_int_eq(spa_json_next(&it, &value), 20);
+				pwtest_ptr_eq(value, buf + k + 3);
+			}
+			expect_end(&it);
+		}
+
+		/* a comment that ends at the offset, followed by a value */
+		len = make_run(buf, "#cb", k + 1, "\n");
+		spa_json_init(&it, buf, len);
+		pwtest_int_eq(spa_json_next(&it, &value), 20);
+		pwtest_ptr_eq(value, buf + k + 3);
+		expect_end(&it);
+
+		len = make_run(buf, "#cb", k + 1, "\r");
+		spa_json_init(&it, buf, len);
+		pwtest_int_eq(spa_json_next(&it, &value), 20);
+		pwtest_ptr_eq(value, buf + k + 3);
+		expect_end(&it);
+
+		/* a comment that ends with the input, at the edge of the
+		 * block for k == 16 */
+		make_run(buf, "#cb", k + 1, "");
+		spa_json_init(&it, buf, k + 2);
+		expect_end(&it);
+
+		/* a value after a comment that ends with the block */
+		len = make_run(buf, "#cb", k + 1, "\nfoo ");
+		spa_json_init(&it, buf, len);
+		pwtest_int_eq(spa_json_next(&it, &value), 3);
+		pwtest_ptr_eq(value, buf + k + 3);
+		pwtest_int_eq(spa_json_next(&it, &value), 20);
+		expect_end(&it);
+
+		/* a string that is cut off in the block */
+		make_run(buf, "\"ab", k + 1, "");
+		spa_json_init(&it, buf, k + 2);
+		expect_parse_error(&it, buf, 1, k + 3);
+	}
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(spa_json)
 {
 	pwtest_add(json_abi, PWTEST_NOARG);
@@ -1077,6 +1194,7 @@ PWTEST_SUITE(spa_json)
 	pwtest_add(json_float_check, PWTEST_NOARG);
 	pwtest_add(json_int, PWTEST_NOARG);
 	pwtest_add(json_data, PWTEST_NOARG);
+	pwtest_add(json_parse_runs, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }